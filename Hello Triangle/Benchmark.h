@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+/*
+** Minimal helpers shared by the in-application benchmark modes.
+** Samples are kept in milliseconds and summarized on report().
+*/
+
+class BenchmarkTimer
+{
+public:
+	BenchmarkTimer()
+	{
+		reset();
+	}
+
+	void	reset()
+	{
+		start = std::chrono::high_resolution_clock::now();
+	}
+
+	double	elapsedMs() const
+	{
+		return (std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+	}
+
+private:
+	std::chrono::high_resolution_clock::time_point	start;
+};
+
+class BenchmarkStats
+{
+public:
+	BenchmarkStats(const std::string &name = "") : label(name)
+	{
+	}
+
+	void	add(double ms)
+	{
+		samples.push_back(ms);
+	}
+
+	void	clear()
+	{
+		samples.clear();
+	}
+
+	size_t	count() const
+	{
+		return (samples.size());
+	}
+
+	const std::string	&name() const
+	{
+		return (label);
+	}
+
+	double	mean() const
+	{
+		double	sum;
+
+		sum = 0.0;
+		for (double sample : samples)
+			sum += sample;
+		return (samples.empty() ? 0.0 : sum / samples.size());
+	}
+
+	double	percentile(double p) const
+	{
+		std::vector<double>	sorted;
+
+		if (samples.empty())
+			return (0.0);
+		sorted = samples;
+		std::sort(sorted.begin(), sorted.end());
+		return (sorted[std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5))]);
+	}
+
+	void	report(std::ostream &out = std::cout) const
+	{
+		out << std::fixed << std::setprecision(3)
+			<< std::left << std::setw(28) << label << std::right
+			<< " n=" << std::setw(6) << samples.size()
+			<< " mean=" << std::setw(9) << mean() << "ms"
+			<< " p50=" << std::setw(9) << percentile(0.5) << "ms"
+			<< " p99=" << std::setw(9) << percentile(0.99) << "ms"
+			<< " min=" << std::setw(9) << percentile(0.0) << "ms"
+			<< " max=" << std::setw(9) << percentile(1.0) << "ms"
+			<< std::defaultfloat << std::endl;
+	}
+
+private:
+	std::string			label;
+	std::vector<double>	samples;
+};
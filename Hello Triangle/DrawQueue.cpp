@@ -0,0 +1,50 @@
+#include "DrawQueue.h"
+
+void	DrawQueue::clear()
+{
+	queue.clear();
+}
+
+void	DrawQueue::push(uint64_t key, uint32_t draw)
+{
+	queue.push_back({ key, draw });
+}
+
+void	DrawQueue::sort()
+{
+	size_t		offsets[256];
+	size_t		total;
+	size_t		count;
+	uint64_t	differing;
+
+	if (queue.size() < 2)
+		return;
+	differing = 0;
+	for (const DrawPacket &packet : queue)
+		differing |= packet.key ^ queue[0].key;
+	scratch.resize(queue.size());
+	for (unsigned shift = 0; shift < 64; shift += 8)
+	{
+		if (((differing >> shift) & 0xFF) == 0)
+			continue;
+		for (size_t &offset : offsets)
+			offset = 0;
+		for (const DrawPacket &packet : queue)
+			offsets[(packet.key >> shift) & 0xFF]++;
+		total = 0;
+		for (size_t &offset : offsets)
+		{
+			count = offset;
+			offset = total;
+			total += count;
+		}
+		for (const DrawPacket &packet : queue)
+			scratch[offsets[(packet.key >> shift) & 0xFF]++] = packet;
+		queue.swap(scratch);
+	}
+}
+
+const std::vector<DrawPacket>	&DrawQueue::packets() const
+{
+	return (queue);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/*
+** Draw packets of one recording task: a 64 bit sort key and the index of
+** the draw it stands for. Sorted on their keys, the draws sharing a piece
+** of state follow each other and the recorder binds it once per run. The
+** most expensive state change takes the highest bits:
+**
+**   63  60 59       48 47        32 31             0
+**   | pass | pipeline | mesh       | depth          |
+**
+** pipeline indexes the pipeline to bind, mesh the vertex and index buffers
+** (0: none). depth orders the draws sharing all the rest (front to back for
+** opaque geometry, back to front for blending).
+*/
+
+#define DRAW_KEY_PASS_SHIFT			60
+#define DRAW_KEY_PIPELINE_SHIFT		48
+#define DRAW_KEY_MESH_SHIFT			32
+#define DRAW_KEY_PIPELINE_MASK		0xFFFu
+#define DRAW_KEY_MESH_MASK			0xFFFFu
+
+struct					DrawPacket
+{
+	uint64_t			key;
+	uint32_t			draw;
+};
+
+inline uint64_t		drawKey(uint32_t pass, uint32_t pipeline, uint32_t mesh, uint32_t depth)
+{
+	return ((uint64_t)pass << DRAW_KEY_PASS_SHIFT | (uint64_t)(pipeline & DRAW_KEY_PIPELINE_MASK) << DRAW_KEY_PIPELINE_SHIFT
+		| (uint64_t)(mesh & DRAW_KEY_MESH_MASK) << DRAW_KEY_MESH_SHIFT | depth);
+}
+
+inline uint32_t		drawKeyPipeline(uint64_t key)
+{
+	return ((uint32_t)(key >> DRAW_KEY_PIPELINE_SHIFT) & DRAW_KEY_PIPELINE_MASK);
+}
+
+inline uint32_t		drawKeyMesh(uint64_t key)
+{
+	return ((uint32_t)(key >> DRAW_KEY_MESH_SHIFT) & DRAW_KEY_MESH_MASK);
+}
+
+class DrawQueue
+{
+public:
+	void					clear();
+	void					push(uint64_t key, uint32_t draw);
+
+	/*
+	** LSD radix sort, a byte per pass, stable. The bytes every key has in
+	** common (the pass, most of the pipeline and mesh bits) are skipped:
+	** a frame usually takes 3 or 4 passes instead of 8.
+	*/
+	void					sort();
+
+	const std::vector<DrawPacket>	&packets() const;
+
+private:
+	std::vector<DrawPacket>	queue;
+	std::vector<DrawPacket>	scratch;
+};
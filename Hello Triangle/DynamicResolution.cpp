@@ -0,0 +1,96 @@
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+
+#include "DynamicResolution.h"
+
+const double	DynamicResolution::smoothing = 0.2;
+const double	DynamicResolution::deadBand = 0.08;
+const float		DynamicResolution::maxStep = 0.05f;
+const int		DynamicResolution::settleFrames = 4;
+
+DynamicResolution::DynamicResolution(double targetMs, float minScale, float maxScale) :
+	active(true), target(targetMs), minimum(minScale), maximum(maxScale), current(maxScale),
+	smoothed(0.0), settle(0), frames(0), changes(0), scaleSum(0.0)
+{
+}
+
+void	DynamicResolution::setEnabled(bool enabled)
+{
+	active = enabled;
+	current = maximum;
+	smoothed = 0.0;
+	settle = 0;
+}
+
+bool	DynamicResolution::enabled() const
+{
+	return (active);
+}
+
+void	DynamicResolution::setTargetMs(double targetMs)
+{
+	target = targetMs;
+}
+
+double	DynamicResolution::targetMs() const
+{
+	return (target);
+}
+
+float	DynamicResolution::update(double gpuMs)
+{
+	float		next;
+
+	if (!active || gpuMs <= 0.0)
+		return (current);
+	frames++;
+	scaleSum += current;
+	smoothed = (smoothed <= 0.0) ? gpuMs : smoothed + smoothing * (gpuMs - smoothed);
+	if (settle > 0)
+	{
+		settle--;
+		return (current);
+	}
+	if (std::fabs(smoothed - target) < deadBand * target)
+		return (current);
+
+	next = current * (float)std::sqrt(target / smoothed);
+	next = std::min(std::max(next, current - maxStep), current + maxStep);
+	next = std::min(std::max(next, minimum), maximum);
+	if (std::fabs(next - current) < 0.005f)
+		return (current);
+
+	// Expected time at the new resolution, corrected by the next samples
+	smoothed *= (double)(next * next) / (double)(current * current);
+	current = next;
+	settle = settleFrames;
+	changes++;
+	return (current);
+}
+
+float	DynamicResolution::scale() const
+{
+	return (current);
+}
+
+double	DynamicResolution::smoothedMs() const
+{
+	return (smoothed);
+}
+
+uint32_t	DynamicResolution::scaled(uint32_t size) const
+{
+	return (std::max(1u, (uint32_t)(size * current + 0.5f)));
+}
+
+void	DynamicResolution::report(std::ostream &out) const
+{
+	out << "Dynamic resolution: target " << std::fixed << std::setprecision(2) << target << "ms, ";
+	if (frames == 0)
+		out << "no GPU timing" << std::defaultfloat << std::endl;
+	else
+		out << "mean scale " << std::setprecision(1) << 100.0 * scaleSum / frames << "% over " << frames
+			<< " frames, " << changes << " changes, range " << 100.0f * minimum << "% - " << 100.0f * maximum << "%"
+			<< std::defaultfloat << std::endl;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+/*
+** Dynamic resolution controller.
+**
+** Fed once per frame with the GPU time of the frame (timestamp queries), it
+** returns the resolution scale to render the next one at. The GPU time is
+** smoothed, a dead band around the target keeps the scale still when the
+** frame is close enough, and each step assumes the fragment cost follows the
+** pixel count (scale squared), limited to maxStep per update. After a change
+** the controller waits settleFrames frames so the smoothed time reflects the
+** new resolution before deciding again.
+*/
+
+class DynamicResolution
+{
+public:
+	DynamicResolution(double targetMs, float minScale = 0.5f, float maxScale = 1.0f);
+
+	void		setEnabled(bool enabled);
+	bool		enabled() const;
+	void		setTargetMs(double targetMs);
+	double		targetMs() const;
+
+	/*
+	** gpuMs <= 0 (timing not available) leaves the scale unchanged.
+	*/
+	float		update(double gpuMs);
+	float		scale() const;
+	double		smoothedMs() const;
+
+	/*
+	** Scales one dimension of the output, never below 1 pixel.
+	*/
+	uint32_t	scaled(uint32_t size) const;
+
+	void		report(std::ostream &out) const;
+
+private:
+	static const double		smoothing;
+	static const double		deadBand;
+	static const float		maxStep;
+	static const int		settleFrames;
+
+	bool		active;
+	double		target;
+	float		minimum;
+	float		maximum;
+	float		current;
+	double		smoothed;
+	int			settle;
+	uint64_t	frames;
+	uint64_t	changes;
+	double		scaleSum;
+};
@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+#include "GpuCounters.h"
+
+struct					GpuCounterInfo
+{
+	const char			*name;
+	const char			*help;
+};
+
+static const GpuCounterInfo	counterInfos[GPU_COUNTER_COUNT] =
+{
+	{ "input_primitives", "Primitives assembled by the input assembler." },
+	{ "vertex_invocations", "Vertex shader invocations." },
+	{ "clipping_invocations", "Primitives processed by the clipping stage." },
+	{ "clipping_primitives", "Primitives output by the clipping stage." },
+	{ "fragment_invocations", "Fragment shader invocations." },
+	{ "samples_passed", "Samples that passed the per fragment tests (occlusion query)." }
+};
+
+/*
+** Writes path.tmp and renames it over path. rename() doesn't replace an
+** existing file on Windows: the old one is removed first there.
+*/
+template<typename Writer>
+static bool		replaceFile(const std::string &path, Writer writer)
+{
+	std::string		temporary;
+
+	temporary = path + ".tmp";
+	{
+		std::ofstream	out(temporary, std::ios::binary);
+
+		if (!out.is_open())
+			return (false);
+		writer(out);
+		if (!out.good())
+			return (false);
+	}
+	if (std::rename(temporary.c_str(), path.c_str()) == 0)
+		return (true);
+	std::remove(path.c_str());
+	return (std::rename(temporary.c_str(), path.c_str()) == 0);
+}
+
+GpuCounters::GpuCounters() : totals(), interval(), totalFrames(0), intervalFrames(0), missedFrames(0)
+{
+}
+
+void	GpuCounters::addFrame(const uint64_t values[GPU_COUNTER_COUNT])
+{
+	for (int i = 0; i < GPU_COUNTER_COUNT; i++)
+	{
+		totals[i] += values[i];
+		interval[i] += values[i];
+	}
+	totalFrames++;
+	intervalFrames++;
+}
+
+void	GpuCounters::missFrame()
+{
+	missedFrames++;
+}
+
+uint64_t	GpuCounters::frames() const
+{
+	return (totalFrames);
+}
+
+double	GpuCounters::average(GpuCounter counter) const
+{
+	return (intervalFrames ? (double)interval[counter] / intervalFrames : 0.0);
+}
+
+bool	GpuCounters::writePrometheus(const std::string &path) const
+{
+	return (replaceFile(path, [this](std::ostream &out)
+	{
+		out << std::fixed << std::setprecision(1)
+			<< "# HELP vulkantest_gpu_frames_total Frames whose GPU counters were read back." << std::endl
+			<< "# TYPE vulkantest_gpu_frames_total counter" << std::endl
+			<< "vulkantest_gpu_frames_total " << totalFrames << std::endl
+			<< "# HELP vulkantest_gpu_missed_frames_total Frames whose GPU counters were not available in time." << std::endl
+			<< "# TYPE vulkantest_gpu_missed_frames_total counter" << std::endl
+			<< "vulkantest_gpu_missed_frames_total " << missedFrames << std::endl;
+		for (int i = 0; i < GPU_COUNTER_COUNT; i++)
+		{
+			out << "# HELP vulkantest_gpu_" << counterInfos[i].name << "_total " << counterInfos[i].help << std::endl
+				<< "# TYPE vulkantest_gpu_" << counterInfos[i].name << "_total counter" << std::endl
+				<< "vulkantest_gpu_" << counterInfos[i].name << "_total " << totals[i] << std::endl
+				<< "# HELP vulkantest_gpu_" << counterInfos[i].name << "_per_frame " << counterInfos[i].help << " Average per frame since the last export." << std::endl
+				<< "# TYPE vulkantest_gpu_" << counterInfos[i].name << "_per_frame gauge" << std::endl
+				<< "vulkantest_gpu_" << counterInfos[i].name << "_per_frame " << average((GpuCounter)i) << std::endl;
+		}
+	}));
+}
+
+bool	GpuCounters::writeJson(const std::string &path) const
+{
+	return (replaceFile(path, [this](std::ostream &out)
+	{
+		out << std::fixed << std::setprecision(1)
+			<< "{\"frames\":" << totalFrames << ",\"missedFrames\":" << missedFrames << ",\"totals\":{";
+		for (int i = 0; i < GPU_COUNTER_COUNT; i++)
+			out << (i ? "," : "") << "\"" << counterInfos[i].name << "\":" << totals[i];
+		out << "},\"perFrame\":{";
+		for (int i = 0; i < GPU_COUNTER_COUNT; i++)
+			out << (i ? "," : "") << "\"" << counterInfos[i].name << "\":" << average((GpuCounter)i);
+		out << "}}" << std::endl;
+	}));
+}
+
+bool	GpuCounters::write(const std::string &prometheusPath, const std::string &jsonPath)
+{
+	bool	written;
+
+	written = writePrometheus(prometheusPath);
+	written = writeJson(jsonPath) && written;
+	for (uint64_t &value : interval)
+		value = 0;
+	intervalFrames = 0;
+	return (written);
+}
+
+void	GpuCounters::report(std::ostream &out) const
+{
+	if (totalFrames == 0)
+		return;
+	out << "GPU counters (" << totalFrames << " frames, " << missedFrames << " missed), per frame:" << std::endl << std::fixed << std::setprecision(1);
+	for (int i = 0; i < GPU_COUNTER_COUNT; i++)
+		out << "  " << std::left << std::setw(22) << counterInfos[i].name << std::right << (double)totals[i] / totalFrames << std::endl;
+	out << std::defaultfloat;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <ostream>
+#include <vulkan/vulkan.h>
+
+/*
+** What the GPU did, from queries around the scene draws of every frame:
+** pipeline statistics (GPU_PIPELINE_STATISTICS) and the samples passed of
+** an occlusion query. The post effects and the blit are not counted.
+**
+** The queries of a view go around a ring of GPU_COUNTER_FRAMES slots: a
+** slot is read back, without waiting, just before it is reused, so the
+** results are that many frames late and never stall the CPU. A slot whose
+** results are not available yet is counted as missed instead.
+**
+** The render thread adds the frames, then exports the totals now and then
+** as a Prometheus textfile (node_exporter textfile collector) and as JSON.
+** Both files are written next to their path and renamed over it: a scraper
+** never reads half of one.
+*/
+
+#define GPU_COUNTER_FRAMES		3
+
+/*
+** Vulkan writes the statistics of a query in the order of their bits: the
+** one of the GpuCounter values below GPU_SAMPLES_PASSED.
+*/
+#define GPU_PIPELINE_STATISTICS	(VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT | \
+	VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | \
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT | \
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | \
+	VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT)
+
+enum					GpuCounter
+{
+	GPU_INPUT_PRIMITIVES,
+	GPU_VERTEX_INVOCATIONS,
+	GPU_CLIPPING_INVOCATIONS,
+	GPU_CLIPPING_PRIMITIVES,
+	GPU_FRAGMENT_INVOCATIONS,
+	GPU_SAMPLES_PASSED,		// occlusion query, a non zero "some" without precise occlusion
+	GPU_COUNTER_COUNT
+};
+
+class GpuCounters
+{
+public:
+	GpuCounters();
+
+	void				addFrame(const uint64_t values[GPU_COUNTER_COUNT]);
+	void				missFrame();
+
+	uint64_t			frames() const;
+	/*
+	** Average per frame since the last export.
+	*/
+	double				average(GpuCounter counter) const;
+
+	/*
+	** Writes the totals (counters) and the averages since the last export
+	** (gauges), and starts a new average. Returns false if a file can't be
+	** written.
+	*/
+	bool				write(const std::string &prometheusPath, const std::string &jsonPath);
+	void				report(std::ostream &out) const;
+
+private:
+	uint64_t			totals[GPU_COUNTER_COUNT];
+	uint64_t			interval[GPU_COUNTER_COUNT];
+	uint64_t			totalFrames;
+	uint64_t			intervalFrames;
+	uint64_t			missedFrames;
+
+	bool				writePrometheus(const std::string &path) const;
+	bool				writeJson(const std::string &path) const;
+};
@@ -0,0 +1,296 @@
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+
+#include "HostAllocator.h"
+
+/*
+** Every block starts with a header right before the pointer handed to the
+** driver: it remembers where the block comes from so free and realloc work
+** without a lookup table.
+*/
+struct				HostAllocator::Header
+{
+	void			*base;
+	size_t			size;
+	uint32_t		scope;
+	uint32_t		fromArena;
+	uint64_t		reserved;
+};
+
+static const size_t		minAlignment = 16;
+static const uint64_t	arenaLiveOne = (uint64_t)1 << 32;
+static const uint64_t	arenaOffsetMask = arenaLiveOne - 1;
+static const char		*scopeNames[HOST_ALLOCATION_SCOPE_COUNT] =
+{
+	"command", "object", "cache", "device", "instance"
+};
+
+static inline uintptr_t	alignUp(uintptr_t value, size_t alignment)
+{
+	return ((value + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+static void		updatePeak(std::atomic<int64_t> &peak, int64_t value)
+{
+	int64_t		current;
+
+	current = peak.load(std::memory_order_relaxed);
+	while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+		;
+}
+
+HostAllocator::HostAllocator(size_t frameArenaSize) :
+	totalLive(0), totalPeak(0), arenaSize(std::min<size_t>(frameArenaSize, arenaOffsetMask)), arenaState(0),
+	arenaOverflows(0), skippedResets(0), frameAllocations(0), frameBytes(0),
+	frameArenaAllocations(0), frameArenaBytes(0)
+{
+	for (HostScopeStats &stats : scopes)
+	{
+		stats.allocations = 0;
+		stats.frees = 0;
+		stats.reallocations = 0;
+		stats.totalBytes = 0;
+		stats.liveBytes = 0;
+		stats.peakBytes = 0;
+		stats.internalAllocations = 0;
+		stats.internalBytes = 0;
+	}
+	memset(&previousFrame, 0, sizeof(previousFrame));
+	arena = new uint8_t[arenaSize];
+
+	vkCallbacks.pUserData = this;
+	vkCallbacks.pfnAllocation = HostAllocator::vkAllocation;
+	vkCallbacks.pfnReallocation = HostAllocator::vkReallocation;
+	vkCallbacks.pfnFree = HostAllocator::vkFree;
+	vkCallbacks.pfnInternalAllocation = HostAllocator::vkInternalAllocation;
+	vkCallbacks.pfnInternalFree = HostAllocator::vkInternalFree;
+}
+
+HostAllocator::~HostAllocator()
+{
+	delete[] arena;
+}
+
+const VkAllocationCallbacks	*HostAllocator::callbacks() const
+{
+#ifdef _NO_HOST_ALLOCATOR
+	return (NULL);
+#else
+	return (&vkCallbacks);
+#endif
+}
+
+void	HostAllocator::track(int scope, int64_t bytes)
+{
+	HostScopeStats	&stats = scopes[scope];
+
+	updatePeak(stats.peakBytes, stats.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+	updatePeak(totalPeak, totalLive.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+void	*HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	Header		*header;
+	uint8_t		*base;
+	uintptr_t	user;
+	uint64_t	state;
+	size_t		end;
+
+	if (size == 0)
+		return (NULL);
+	alignment = std::max(alignment, minAlignment);
+	user = 0;
+
+	/*Command scope: bump allocate in the frame arena, counted live at once*/
+	if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+	{
+		state = arenaState.load(std::memory_order_relaxed);
+		do
+		{
+			user = alignUp((uintptr_t)arena + (size_t)(state & arenaOffsetMask) + sizeof(Header), alignment);
+			end = (user - (uintptr_t)arena) + size;
+			if (end > arenaSize)
+			{
+				user = 0;
+				arenaOverflows.fetch_add(1, std::memory_order_relaxed);
+				break;
+			}
+		} while (!arenaState.compare_exchange_weak(state, (state & ~arenaOffsetMask) + arenaLiveOne + end,
+			std::memory_order_acquire, std::memory_order_relaxed));
+	}
+
+	if (user)
+	{
+		header = reinterpret_cast<Header *>(user) - 1;
+		header->base = NULL;
+		header->fromArena = 1;
+		frameArenaAllocations.fetch_add(1, std::memory_order_relaxed);
+		frameArenaBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+	else
+	{
+		base = static_cast<uint8_t *>(malloc(size + alignment + sizeof(Header)));
+		if (base == NULL)
+			return (NULL);
+		user = alignUp((uintptr_t)base + sizeof(Header), alignment);
+		header = reinterpret_cast<Header *>(user) - 1;
+		header->base = base;
+		header->fromArena = 0;
+	}
+	header->size = size;
+	header->scope = (uint32_t)scope;
+
+	scopes[scope].allocations.fetch_add(1, std::memory_order_relaxed);
+	scopes[scope].totalBytes.fetch_add(size, std::memory_order_relaxed);
+	frameAllocations.fetch_add(1, std::memory_order_relaxed);
+	frameBytes.fetch_add(size, std::memory_order_relaxed);
+	track(scope, (int64_t)size);
+	return (reinterpret_cast<void *>(user));
+}
+
+void	HostAllocator::release(void *memory)
+{
+	Header		*header;
+
+	if (memory == NULL)
+		return;
+	header = static_cast<Header *>(memory) - 1;
+	scopes[header->scope].frees.fetch_add(1, std::memory_order_relaxed);
+	track(header->scope, -(int64_t)header->size);
+	if (header->fromArena)
+		arenaState.fetch_sub(arenaLiveOne, std::memory_order_release);
+	else
+		free(header->base);
+}
+
+void	*HostAllocator::reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	Header		*header;
+	void		*memory;
+
+	if (original == NULL)
+		return (allocate(size, alignment, scope));
+	if (size == 0)
+	{
+		release(original);
+		return (NULL);
+	}
+	header = static_cast<Header *>(original) - 1;
+	scopes[scope].reallocations.fetch_add(1, std::memory_order_relaxed);
+	if (size <= header->size && !header->fromArena)
+		return (original);
+	if ((memory = allocate(size, alignment, scope)) == NULL)
+		return (NULL);
+	memcpy(memory, original, std::min(size, header->size));
+	release(original);
+	return (memory);
+}
+
+void	HostAllocator::endFrame()
+{
+	uint64_t	state;
+
+	previousFrame.allocations = frameAllocations.exchange(0, std::memory_order_relaxed);
+	previousFrame.bytes = frameBytes.exchange(0, std::memory_order_relaxed);
+	previousFrame.arenaAllocations = frameArenaAllocations.exchange(0, std::memory_order_relaxed);
+	previousFrame.arenaBytes = frameArenaBytes.exchange(0, std::memory_order_relaxed);
+
+	/*
+	** A command scope block outliving its call would be a driver bug, but
+	** never hand out memory that is still in use: keep bumping instead. The
+	** rewind only succeeds on the state it saw without live blocks, so a
+	** block reserved meanwhile makes it look again.
+	*/
+	state = arenaState.load(std::memory_order_relaxed);
+	do
+	{
+		if (state >> 32)
+		{
+			skippedResets.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	} while (!arenaState.compare_exchange_weak(state, 0, std::memory_order_acq_rel, std::memory_order_relaxed));
+}
+
+const HostScopeStats	&HostAllocator::scope(VkSystemAllocationScope scope) const
+{
+	return (scopes[scope]);
+}
+
+const HostFrameStats	&HostAllocator::lastFrame() const
+{
+	return (previousFrame);
+}
+
+int64_t		HostAllocator::liveBytes() const
+{
+	return (totalLive.load(std::memory_order_relaxed));
+}
+
+int64_t		HostAllocator::peakBytes() const
+{
+	return (totalPeak.load(std::memory_order_relaxed));
+}
+
+void	HostAllocator::reportFrame(std::ostream &out) const
+{
+	out << "host memory: " << liveBytes() / 1024 << " KiB live, "
+		<< peakBytes() / 1024 << " KiB peak, last frame "
+		<< previousFrame.allocations << " allocs / " << previousFrame.bytes << " B ("
+		<< previousFrame.arenaAllocations << " from arena)";
+}
+
+void	HostAllocator::report(std::ostream &out) const
+{
+	out << "Vulkan host allocations per scope:" << std::endl;
+	out << std::left << std::setw(10) << "scope" << std::right
+		<< std::setw(10) << "allocs" << std::setw(10) << "frees" << std::setw(10) << "reallocs"
+		<< std::setw(14) << "total B" << std::setw(12) << "live B" << std::setw(12) << "peak B"
+		<< std::setw(10) << "internal" << std::endl;
+	for (int i = 0; i < HOST_ALLOCATION_SCOPE_COUNT; i++)
+	{
+		out << std::left << std::setw(10) << scopeNames[i] << std::right
+			<< std::setw(10) << scopes[i].allocations.load()
+			<< std::setw(10) << scopes[i].frees.load()
+			<< std::setw(10) << scopes[i].reallocations.load()
+			<< std::setw(14) << scopes[i].totalBytes.load()
+			<< std::setw(12) << scopes[i].liveBytes.load()
+			<< std::setw(12) << scopes[i].peakBytes.load()
+			<< std::setw(10) << scopes[i].internalAllocations.load() << std::endl;
+	}
+	out << "total peak " << peakBytes() << " B, frame arena " << arenaSize << " B, "
+		<< arenaOverflows.load() << " arena overflows, " << skippedResets.load() << " skipped arena resets" << std::endl;
+}
+
+VKAPI_ATTR void		*VKAPI_CALL HostAllocator::vkAllocation(void *userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	return (static_cast<HostAllocator *>(userData)->allocate(size, alignment, scope));
+}
+
+VKAPI_ATTR void		*VKAPI_CALL HostAllocator::vkReallocation(void *userData, void *original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	return (static_cast<HostAllocator *>(userData)->reallocate(original, size, alignment, scope));
+}
+
+VKAPI_ATTR void		VKAPI_CALL HostAllocator::vkFree(void *userData, void *memory)
+{
+	static_cast<HostAllocator *>(userData)->release(memory);
+}
+
+VKAPI_ATTR void		VKAPI_CALL HostAllocator::vkInternalAllocation(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	HostAllocator	*allocator;
+
+	(void)type;
+	allocator = static_cast<HostAllocator *>(userData);
+	allocator->scopes[scope].internalAllocations.fetch_add(1, std::memory_order_relaxed);
+	allocator->scopes[scope].internalBytes.fetch_add((int64_t)size, std::memory_order_relaxed);
+}
+
+VKAPI_ATTR void		VKAPI_CALL HostAllocator::vkInternalFree(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	(void)type;
+	static_cast<HostAllocator *>(userData)->scopes[scope].internalBytes.fetch_sub((int64_t)size, std::memory_order_relaxed);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <vulkan/vulkan.h>
+
+/*
+** Host memory instrumentation for the Vulkan driver.
+**
+** Every create / destroy call receives callbacks() as pAllocator so all the
+** host memory the driver asks for is counted per VkSystemAllocationScope.
+** Command scope allocations only live for the duration of a single Vulkan
+** call: they are served from a bump allocated arena that endFrame() rewinds,
+** which removes most of the per-frame malloc / free churn.
+*/
+
+#define HOST_ALLOCATION_SCOPE_COUNT		5
+
+struct							HostScopeStats
+{
+	std::atomic<uint64_t>		allocations;
+	std::atomic<uint64_t>		frees;
+	std::atomic<uint64_t>		reallocations;
+	std::atomic<uint64_t>		totalBytes;
+	std::atomic<int64_t>		liveBytes;
+	std::atomic<int64_t>		peakBytes;
+	std::atomic<uint64_t>		internalAllocations;
+	std::atomic<int64_t>		internalBytes;
+};
+
+struct							HostFrameStats
+{
+	uint64_t					allocations;
+	uint64_t					bytes;
+	uint64_t					arenaAllocations;
+	uint64_t					arenaBytes;
+};
+
+class HostAllocator
+{
+public:
+	HostAllocator(size_t frameArenaSize = 256 * 1024);
+	~HostAllocator();
+
+	/*
+	** NULL when built with _NO_HOST_ALLOCATOR, so the driver falls back to its
+	** own allocator.
+	*/
+	const VkAllocationCallbacks	*callbacks() const;
+
+	/*
+	** Rewinds the command scope arena and latches the per-frame counters.
+	** The rewind is skipped if an arena allocation is still alive.
+	*/
+	void						endFrame();
+
+	const HostScopeStats		&scope(VkSystemAllocationScope scope) const;
+	const HostFrameStats		&lastFrame() const;
+	int64_t						liveBytes() const;
+	int64_t						peakBytes() const;
+
+	void						reportFrame(std::ostream &out) const;
+	void						report(std::ostream &out) const;
+
+private:
+	struct						Header;
+
+	VkAllocationCallbacks		vkCallbacks;
+	HostScopeStats				scopes[HOST_ALLOCATION_SCOPE_COUNT];
+	std::atomic<int64_t>		totalLive;
+	std::atomic<int64_t>		totalPeak;
+
+	/*
+	** The arena offset (low 32 bits) and the count of live arena blocks
+	** (high 32 bits) share one word: reserving a block and rewinding the
+	** arena are each a single compare and swap of both.
+	*/
+	uint8_t						*arena;
+	size_t						arenaSize;
+	std::atomic<uint64_t>		arenaState;
+	std::atomic<uint64_t>		arenaOverflows;
+	std::atomic<uint64_t>		skippedResets;
+
+	std::atomic<uint64_t>		frameAllocations;
+	std::atomic<uint64_t>		frameBytes;
+	std::atomic<uint64_t>		frameArenaAllocations;
+	std::atomic<uint64_t>		frameArenaBytes;
+	HostFrameStats				previousFrame;
+
+	void						*allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+	void						*reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	void						release(void *memory);
+	void						track(int scope, int64_t bytes);
+
+	static VKAPI_ATTR void		*VKAPI_CALL vkAllocation(void *userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void		*VKAPI_CALL vkReallocation(void *userData, void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void		VKAPI_CALL vkFree(void *userData, void *memory);
+	static VKAPI_ATTR void		VKAPI_CALL vkInternalAllocation(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void		VKAPI_CALL vkInternalFree(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+	HostAllocator(const HostAllocator &);
+	HostAllocator				&operator=(const HostAllocator &);
+};
@@ -0,0 +1,362 @@
+#include <string>
+
+#include "Profiler.h"
+#include "JobSystem.h"
+
+#define JOB_DEQUE_CAPACITY		4096
+#define JOB_IDLE_SPINS			64
+
+/*
+** Chase-Lev deque with a fixed capacity (C11 formulation of Le et al.).
+** push() and pop() are called by the owner only, steal() by anyone. A full
+** deque makes push() fail and the caller runs the task inline.
+*/
+class JobSystem::WorkDeque
+{
+public:
+	WorkDeque() : top(0), bottom(0)
+	{
+		for (std::atomic<Task *> &slot : buffer)
+			slot.store(NULL, std::memory_order_relaxed);
+	}
+
+	bool	push(Task *task)
+	{
+		int64_t		b;
+		int64_t		t;
+
+		b = bottom.load(std::memory_order_relaxed);
+		t = top.load(std::memory_order_acquire);
+		if (b - t >= JOB_DEQUE_CAPACITY)
+			return (false);
+		buffer[b & (JOB_DEQUE_CAPACITY - 1)].store(task, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return (true);
+	}
+
+	Task	*pop()
+	{
+		Task		*task;
+		int64_t		b;
+		int64_t		t;
+
+		b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		t = top.load(std::memory_order_relaxed);
+		if (t > b)
+		{
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return (NULL);
+		}
+		task = buffer[b & (JOB_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (t == b)
+		{
+			// Last task: race the thieves for it
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				task = NULL;
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return (task);
+	}
+
+	Task	*steal()
+	{
+		Task		*task;
+		int64_t		t;
+		int64_t		b;
+
+		t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return (NULL);
+		task = buffer[t & (JOB_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return (NULL);
+		return (task);
+	}
+
+private:
+	std::atomic<int64_t>	top;
+	char					padding[64 - sizeof(std::atomic<int64_t>)];
+	std::atomic<int64_t>	bottom;
+	std::atomic<Task *>		buffer[JOB_DEQUE_CAPACITY];
+};
+
+struct					JobSystem::Worker
+{
+	WorkDeque			deque;
+	std::thread			thread;
+	uint32_t			victim;
+};
+
+/*
+** Which worker of which system the current thread is, if any.
+*/
+static thread_local const JobSystem	*workerSystem = NULL;
+static thread_local int				workerIndex = -1;
+
+/*
+** TaskGraph
+*/
+
+TaskGraph::Task::Task(TaskGraph *owner, const char *name, std::function<void()> &&taskWork) :
+	graph(owner), work(std::move(taskWork)), dependencies(0), pending(0)
+{
+	timing.name = name;
+	timing.worker = -1;
+	timing.startNs = 0;
+	timing.durationNs = 0;
+}
+
+TaskGraph::TaskGraph() : remaining(0), failed(false)
+{
+}
+
+TaskGraph::TaskId	TaskGraph::add(const char *name, std::function<void()> work)
+{
+	tasks.emplace_back(this, name, std::move(work));
+	return ((TaskId)(tasks.size() - 1));
+}
+
+void	TaskGraph::depend(TaskId before, TaskId after)
+{
+	tasks[before].successors.push_back(after);
+	tasks[after].dependencies++;
+}
+
+void	TaskGraph::clear()
+{
+	tasks.clear();
+}
+
+size_t	TaskGraph::size() const
+{
+	return (tasks.size());
+}
+
+bool	TaskGraph::done() const
+{
+	return (remaining.load(std::memory_order_acquire) == 0);
+}
+
+const TaskTiming	&TaskGraph::timing(TaskId id) const
+{
+	return (tasks[id].timing);
+}
+
+/*
+** JobSystem
+*/
+
+JobSystem::JobSystem(unsigned workerCount) :
+	injectedCount(0), queued(0), sleepers(0), stopping(false)
+{
+	for (unsigned i = 0; i < workerCount; i++)
+	{
+		workers.push_back(std::unique_ptr<Worker>(new Worker()));
+		workers.back()->victim = i + 1;
+	}
+	for (unsigned i = 0; i < workerCount; i++)
+		workers[i]->thread = std::thread(&JobSystem::workerLoop, this, (int)i);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex>	lock(sleepMutex);
+
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::unique_ptr<Worker> &worker : workers)
+		worker->thread.join();
+}
+
+unsigned	JobSystem::workerCount() const
+{
+	return ((unsigned)workers.size());
+}
+
+int64_t		JobSystem::clockNs()
+{
+	return (Profiler::nowNs());
+}
+
+int		JobSystem::currentWorker() const
+{
+	return (workerSystem == this ? workerIndex : -1);
+}
+
+void	JobSystem::schedule(Task *task)
+{
+	int		self;
+
+	self = currentWorker();
+	if (self >= 0)
+	{
+		if (!workers[self]->deque.push(task))
+		{
+			runTask(task);
+			return;
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex>	lock(injectMutex);
+
+		injected.push_back(task);
+		injectedCount.fetch_add(1, std::memory_order_release);
+	}
+	/*
+	** queued and sleepers are both seq_cst: either the worker going to sleep
+	** sees the new task, or we see it sleeping and wake it.
+	*/
+	queued.fetch_add(1);
+	if (sleepers.load() > 0)
+	{
+		{
+			std::lock_guard<std::mutex>	lock(sleepMutex);
+		}
+		wake.notify_one();
+	}
+}
+
+JobSystem::Task		*JobSystem::findTask(int self)
+{
+	Task		*task;
+	size_t		count;
+
+	task = NULL;
+	if (self >= 0)
+		task = workers[self]->deque.pop();
+	if (task == NULL && injectedCount.load(std::memory_order_acquire) > 0)
+	{
+		std::lock_guard<std::mutex>	lock(injectMutex);
+
+		if (!injected.empty())
+		{
+			task = injected.front();
+			injected.pop_front();
+			injectedCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+	count = workers.size();
+	for (size_t i = 0; task == NULL && i < count; i++)
+	{
+		uint32_t	victim;
+
+		victim = (self >= 0) ? (workers[self]->victim++ % count) : (uint32_t)i;
+		if ((int)victim != self)
+			task = workers[victim]->deque.steal();
+	}
+	if (task)
+		queued.fetch_sub(1, std::memory_order_relaxed);
+	return (task);
+}
+
+void	JobSystem::runTask(Task *task)
+{
+	TaskGraph	*graph;
+
+	graph = task->graph;
+	task->timing.worker = currentWorker();
+	task->timing.startNs = clockNs();
+	task->timing.durationNs = 0;
+	// Skipped once a task of the run has thrown, successors included
+	if (!graph->failed.load(std::memory_order_acquire))
+	{
+		try
+		{
+			task->work();
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex>	lock(graph->errorMutex);
+
+			if (!graph->error)
+				graph->error = std::current_exception();
+			graph->failed.store(true, std::memory_order_release);
+		}
+		task->timing.durationNs = clockNs() - task->timing.startNs;
+		Profiler::record(task->timing.name, task->timing.startNs, task->timing.startNs + task->timing.durationNs);
+	}
+	for (TaskGraph::TaskId id : task->successors)
+	{
+		if (graph->tasks[id].pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			schedule(&graph->tasks[id]);
+	}
+	// Last: wait() may return and the graph be reused right after
+	graph->remaining.fetch_sub(1, std::memory_order_release);
+}
+
+void	JobSystem::run(TaskGraph &graph)
+{
+	if (graph.tasks.empty())
+		return;
+	graph.error = NULL;
+	graph.failed.store(false, std::memory_order_relaxed);
+	for (Task &task : graph.tasks)
+		task.pending.store(task.dependencies, std::memory_order_relaxed);
+	graph.remaining.store((uint32_t)graph.tasks.size(), std::memory_order_release);
+	for (Task &task : graph.tasks)
+	{
+		if (task.dependencies == 0)
+			schedule(&task);
+	}
+}
+
+void	JobSystem::wait(TaskGraph &graph)
+{
+	Task	*task;
+	int		self;
+
+	self = currentWorker();
+	while (!graph.done())
+	{
+		if ((task = findTask(self)) != NULL)
+			runTask(task);
+		else
+			std::this_thread::yield();
+	}
+	if (graph.error)
+		std::rethrow_exception(graph.error);
+}
+
+void	JobSystem::execute(TaskGraph &graph)
+{
+	run(graph);
+	wait(graph);
+}
+
+void	JobSystem::workerLoop(int index)
+{
+	Task	*task;
+	int		idle;
+
+	workerSystem = this;
+	workerIndex = index;
+	Profiler::setThreadName("worker " + std::to_string(index));
+	idle = 0;
+	while (!stopping.load(std::memory_order_relaxed))
+	{
+		if ((task = findTask(index)) != NULL)
+		{
+			runTask(task);
+			idle = 0;
+		}
+		else if (++idle < JOB_IDLE_SPINS)
+			std::this_thread::yield();
+		else
+		{
+			std::unique_lock<std::mutex>	lock(sleepMutex);
+
+			sleepers.fetch_add(1);
+			wake.wait(lock, [this]() { return (queued.load() > 0 || stopping.load()); });
+			sleepers.fetch_sub(1);
+			idle = 0;
+		}
+	}
+}
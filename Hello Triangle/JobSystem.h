@@ -0,0 +1,143 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+/*
+** Work-stealing job system.
+**
+** Work is described as a TaskGraph: tasks plus "runs after" edges. Each task
+** counts its unfinished dependencies and is scheduled by whichever thread
+** finishes the last one. Every worker owns a Chase-Lev deque: it pushes and
+** pops ready tasks at the bottom (LIFO, cache friendly) while idle workers
+** steal from the top of the others. Threads that are not workers (the render
+** thread) submit through a small shared queue and help executing tasks while
+** they wait() for a graph, so they are never idle during a frame either.
+**
+** A graph is built once and can be run again and again: run() resets the
+** counters, the structure and the std::function objects are reused. The
+** first exception thrown by a task of a run is rethrown by wait(), and the
+** tasks of the run that have not started yet are skipped: their successors
+** are still counted down, but none of them runs on a failed step.
+*/
+
+struct					TaskTiming
+{
+	const char			*name;
+	int					worker;			// -1: a thread that is not a worker (wait())
+	int64_t				startNs;		// since JobSystem::clockNs() origin
+	int64_t				durationNs;
+};
+
+class TaskGraph
+{
+public:
+	typedef uint32_t	TaskId;
+
+	TaskGraph();
+
+	/*
+	** name is also the zone of the task in profiler captures (Profiler.h):
+	** it must outlive the graph.
+	*/
+	TaskId				add(const char *name, std::function<void()> work);
+	/*
+	** "after" is only scheduled once "before" has finished.
+	*/
+	void				depend(TaskId before, TaskId after);
+	void				clear();
+
+	size_t				size() const;
+	bool				done() const;
+	/*
+	** Timing of the last run of a task. Valid once the graph is done.
+	*/
+	const TaskTiming	&timing(TaskId id) const;
+
+private:
+	friend class JobSystem;
+
+	struct						Task
+	{
+		Task(TaskGraph *owner, const char *name, std::function<void()> &&work);
+
+		TaskGraph				*graph;
+		std::function<void()>	work;
+		std::vector<TaskId>		successors;
+		uint32_t				dependencies;
+		std::atomic<uint32_t>	pending;
+		TaskTiming				timing;
+	};
+
+	std::deque<Task>			tasks;
+	std::atomic<uint32_t>		remaining;
+	std::atomic<bool>			failed;
+	std::mutex					errorMutex;
+	std::exception_ptr			error;
+
+	TaskGraph(const TaskGraph &);
+	TaskGraph					&operator=(const TaskGraph &);
+};
+
+class JobSystem
+{
+public:
+	/*
+	** workerCount threads are started, 0 is valid: everything then runs on
+	** the thread calling wait().
+	*/
+	explicit JobSystem(unsigned workerCount);
+	~JobSystem();
+
+	unsigned			workerCount() const;
+
+	/*
+	** Schedules the tasks of graph without dependencies and returns. The
+	** graph must not be modified or run again before it is done.
+	*/
+	void				run(TaskGraph &graph);
+	/*
+	** Executes pending tasks (of any graph) until graph is done.
+	*/
+	void				wait(TaskGraph &graph);
+	void				execute(TaskGraph &graph);
+
+	/*
+	** The clock of Profiler::nowNs(): task timings line up with captures.
+	*/
+	static int64_t		clockNs();
+
+private:
+	typedef TaskGraph::Task	Task;
+	class					WorkDeque;
+	struct					Worker;
+
+	std::vector<std::unique_ptr<Worker>>	workers;
+
+	std::mutex				injectMutex;
+	std::deque<Task *>		injected;
+	std::atomic<uint32_t>	injectedCount;
+
+	std::atomic<int64_t>	queued;
+	std::atomic<int>		sleepers;
+	std::atomic<bool>		stopping;
+	std::mutex				sleepMutex;
+	std::condition_variable	wake;
+
+	int						currentWorker() const;
+	void					schedule(Task *task);
+	void					runTask(Task *task);
+	Task					*findTask(int self);
+	void					workerLoop(int index);
+
+	JobSystem(const JobSystem &);
+	JobSystem				&operator=(const JobSystem &);
+};
@@ -0,0 +1,176 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <iomanip>
+
+#include "Logger.h"
+
+static const char	*severityNames[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+
+static int64_t	nowUs()
+{
+	static const std::chrono::steady_clock::time_point	origin = std::chrono::steady_clock::now();
+
+	return (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count());
+}
+
+static uint64_t	hashMessage(const char *text)
+{
+	uint64_t	hash;
+
+	hash = 14695981039346656037ull;
+	while (*text)
+	{
+		hash ^= (uint8_t)*text++;
+		hash *= 1099511628211ull;
+	}
+	return (hash ? hash : 1);
+}
+
+Logger::Logger(std::ostream &output, LogSeverity severity, double duplicateWindow) :
+	out(output), queue(new Queue()), minSeverity(severity), duplicateWindowUs((int64_t)(duplicateWindow * 1000000.0)),
+	dropped(0), suppressedTotal(0), running(false)
+{
+	for (DuplicateSlot &slot : duplicates)
+	{
+		slot.hash = 0;
+		slot.lastTime = 0;
+		slot.suppressed = 0;
+	}
+	nowUs();
+}
+
+Logger::~Logger()
+{
+	stop();
+}
+
+void	Logger::start()
+{
+	if (running.exchange(true))
+		return;
+	worker = std::thread(&Logger::flushLoop, this);
+}
+
+void	Logger::stop()
+{
+	if (!running.exchange(false))
+	{
+		drain();
+		return;
+	}
+	wake.notify_one();
+	worker.join();
+	drain();
+	if (dropped.load() || suppressedTotal.load())
+		out << "Logger: " << dropped.load() << " messages dropped, " << suppressedTotal.load() << " duplicates suppressed" << std::endl;
+}
+
+void	Logger::setMinSeverity(LogSeverity severity)
+{
+	minSeverity.store(severity, std::memory_order_relaxed);
+}
+
+bool	Logger::enabled(LogSeverity severity) const
+{
+	return (severity >= minSeverity.load(std::memory_order_relaxed));
+}
+
+bool	Logger::filterDuplicate(const char *text, int64_t now, uint32_t *suppressed)
+{
+	DuplicateSlot	*slot;
+	uint64_t		hash;
+
+	hash = hashMessage(text);
+	slot = &duplicates[hash & (LOG_DUPLICATE_SLOTS - 1)];
+	*suppressed = 0;
+	if (slot->hash.load(std::memory_order_relaxed) == hash)
+	{
+		if (now - slot->lastTime.load(std::memory_order_relaxed) < duplicateWindowUs)
+		{
+			slot->suppressed.fetch_add(1, std::memory_order_relaxed);
+			suppressedTotal.fetch_add(1, std::memory_order_relaxed);
+			return (true);
+		}
+		*suppressed = slot->suppressed.exchange(0, std::memory_order_relaxed);
+	}
+	else
+	{
+		slot->hash.store(hash, std::memory_order_relaxed);
+		slot->suppressed.store(0, std::memory_order_relaxed);
+	}
+	slot->lastTime.store(now, std::memory_order_relaxed);
+	return (false);
+}
+
+void	Logger::log(LogSeverity severity, const char *format, ...)
+{
+	va_list		args;
+	char		text[LOG_MESSAGE_SIZE];
+	int64_t		now;
+	uint32_t	suppressed;
+
+	if (!enabled(severity))
+		return;
+	va_start(args, format);
+	vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+
+	now = nowUs();
+	if (filterDuplicate(text, now, &suppressed))
+		return;
+	if (!queue->tryEmplace([&](LogMessage &message)
+		{
+			message.severity = severity;
+			message.time = now / 1000000.0;
+			message.suppressed = suppressed;
+			memcpy(message.text, text, strlen(text) + 1);
+		}))
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	if (severity == LOG_ERROR)
+		wake.notify_one();
+}
+
+void	Logger::drain()
+{
+	LogMessage	message;
+	bool		wrote;
+
+	wrote = false;
+	while (queue->tryPop(message))
+	{
+		out << '[' << std::fixed << std::setprecision(3) << std::setw(10) << message.time << std::defaultfloat << "] "
+			<< severityNames[message.severity] << ": " << message.text;
+		if (message.suppressed)
+			out << " (+" << message.suppressed << " duplicates suppressed)";
+		out << '\n';
+		wrote = true;
+	}
+	if (wrote)
+		out.flush();
+}
+
+void	Logger::flushLoop()
+{
+	std::unique_lock<std::mutex>	lock(wakeMutex);
+
+	while (running.load())
+	{
+		drain();
+		wake.wait_for(lock, std::chrono::milliseconds(5));
+	}
+}
+
+uint64_t	Logger::droppedCount() const
+{
+	return (dropped.load(std::memory_order_relaxed));
+}
+
+uint64_t	Logger::suppressedCount() const
+{
+	return (suppressedTotal.load(std::memory_order_relaxed));
+}
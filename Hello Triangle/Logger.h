@@ -0,0 +1,95 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <ostream>
+#include <condition_variable>
+
+#include "MpscQueue.h"
+
+/*
+** Asynchronous logger.
+**
+** log() formats the message into a slot of a lock-free ring buffer and
+** returns: the validation layer callback and the render loop never touch the
+** console. A background thread drains the ring and writes to the output
+** stream in batches. Messages under the minimum severity are discarded
+** before formatting, and a message identical to one logged less than
+** duplicateWindow seconds ago is only counted; the count is appended the
+** next time it gets through.
+*/
+
+enum					LogSeverity
+{
+	LOG_DEBUG,
+	LOG_INFO,
+	LOG_WARNING,
+	LOG_ERROR
+};
+
+#define LOG_MESSAGE_SIZE		480
+#define LOG_QUEUE_SIZE			1024
+#define LOG_DUPLICATE_SLOTS		256
+
+struct					LogMessage
+{
+	LogSeverity			severity;
+	double				time;
+	uint32_t			suppressed;
+	char				text[LOG_MESSAGE_SIZE];
+};
+
+class Logger
+{
+public:
+	Logger(std::ostream &output, LogSeverity minSeverity = LOG_INFO, double duplicateWindow = 1.0);
+	~Logger();
+
+	void				start();
+	void				stop();
+
+	void				setMinSeverity(LogSeverity severity);
+	bool				enabled(LogSeverity severity) const;
+
+	/*
+	** printf-style. Never blocks: the message is dropped (and counted) if the
+	** ring is full.
+	*/
+	void				log(LogSeverity severity, const char *format, ...);
+
+	uint64_t			droppedCount() const;
+	uint64_t			suppressedCount() const;
+
+private:
+	struct						DuplicateSlot
+	{
+		std::atomic<uint64_t>	hash;
+		std::atomic<int64_t>	lastTime;
+		std::atomic<uint32_t>	suppressed;
+	};
+
+	typedef MpscQueue<LogMessage, LOG_QUEUE_SIZE>	Queue;
+
+	std::ostream				&out;
+	std::unique_ptr<Queue>		queue;
+	std::atomic<int>			minSeverity;
+	int64_t						duplicateWindowUs;
+	DuplicateSlot				duplicates[LOG_DUPLICATE_SLOTS];
+	std::atomic<uint64_t>		dropped;
+	std::atomic<uint64_t>		suppressedTotal;
+
+	std::thread					worker;
+	std::atomic<bool>			running;
+	std::mutex					wakeMutex;
+	std::condition_variable		wake;
+
+	bool						filterDuplicate(const char *text, int64_t now, uint32_t *suppressed);
+	void						flushLoop();
+	void						drain();
+
+	Logger(const Logger &);
+	Logger						&operator=(const Logger &);
+};
@@ -0,0 +1,108 @@
+#ifdef _WIN32
+# define WIN32_LEAN_AND_MEAN
+# define NOMINMAX
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+#include <stdexcept>
+
+#include "MappedFile.h"
+
+MappedFile::MappedFile() : mapping(NULL), length(0)
+#ifdef _WIN32
+	, fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL)
+#else
+	, descriptor(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+void	MappedFile::open(const std::string &path)
+{
+	close();
+#ifdef _WIN32
+	LARGE_INTEGER	fileSize;
+
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(fileHandle, &fileSize))
+	{
+		close();
+		throw std::runtime_error("Failed to open " + path + "!");
+	}
+	length = (size_t)fileSize.QuadPart;
+	if (length)
+	{
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mappingHandle != NULL)
+			mapping = static_cast<const uint8_t *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	struct stat		status;
+	void			*address;
+
+	descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0 || fstat(descriptor, &status) != 0)
+	{
+		close();
+		throw std::runtime_error("Failed to open " + path + "!");
+	}
+	length = (size_t)status.st_size;
+	if (length)
+	{
+		address = mmap(NULL, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		mapping = (address == MAP_FAILED) ? NULL : static_cast<const uint8_t *>(address);
+	}
+#endif
+	if (length && mapping == NULL)
+	{
+		close();
+		throw std::runtime_error("Failed to map " + path + "!");
+	}
+}
+
+void	MappedFile::close()
+{
+#ifdef _WIN32
+	if (mapping)
+		UnmapViewOfFile(mapping);
+	if (mappingHandle != NULL)
+		CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+	mappingHandle = NULL;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (mapping)
+		munmap(const_cast<uint8_t *>(mapping), length);
+	if (descriptor >= 0)
+		::close(descriptor);
+	descriptor = -1;
+#endif
+	mapping = NULL;
+	length = 0;
+}
+
+bool	MappedFile::isOpen() const
+{
+	return (mapping != NULL);
+}
+
+const uint8_t	*MappedFile::data() const
+{
+	return (mapping);
+}
+
+size_t	MappedFile::size() const
+{
+	return (length);
+}
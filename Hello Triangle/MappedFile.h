@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/*
+** Read-only memory mapping of a whole file. The pages are only read from
+** disk (or the page cache) when touched, and belong to the page cache: they
+** are not counted as private memory of the process.
+*/
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	/*
+	** Throws a runtime_error if the file can't be opened or mapped.
+	*/
+	void			open(const std::string &path);
+	void			close();
+
+	bool			isOpen() const;
+	const uint8_t	*data() const;
+	size_t			size() const;
+
+private:
+	const uint8_t	*mapping;
+	size_t			length;
+#ifdef _WIN32
+	void			*fileHandle;
+	void			*mappingHandle;
+#else
+	int				descriptor;
+#endif
+
+	MappedFile(const MappedFile &);
+	MappedFile		&operator=(const MappedFile &);
+};
@@ -0,0 +1,91 @@
+#include <stdexcept>
+
+#include "MeshFile.h"
+
+MeshFile::MeshFile() : fileHeader(NULL)
+{
+}
+
+void	MeshFile::open(const std::string &path)
+{
+	const MeshFileHeader	*header;
+	const MeshSection		*section;
+	const MeshLod			*lod;
+
+	file.open(path);
+	fileHeader = NULL;
+	header = reinterpret_cast<const MeshFileHeader *>(file.data());
+	if (file.size() < sizeof(MeshFileHeader) || header->magic != MESH_FILE_MAGIC)
+	{
+		file.close();
+		throw std::runtime_error(path + " is not a mesh file!");
+	}
+	if (header->version != MESH_FILE_VERSION || header->vertexStride != sizeof(MeshVertex)
+		|| (header->indexSize != 2 && header->indexSize != 4) || header->lodCount == 0 || header->lodCount > MESH_MAX_LODS)
+	{
+		file.close();
+		throw std::runtime_error(path + ": unsupported mesh file version or layout!");
+	}
+	for (int i = 0; i < MESH_SECTION_COUNT; i++)
+	{
+		section = &header->sections[i];
+		if (section->offset % MESH_SECTION_ALIGNMENT || section->offset > file.size() || section->size > file.size() - section->offset)
+		{
+			file.close();
+			throw std::runtime_error(path + ": truncated or corrupted mesh file!");
+		}
+	}
+	if (header->sections[MESH_SECTION_VERTICES].size != (uint64_t)header->vertexCount * sizeof(MeshVertex)
+		|| header->sections[MESH_SECTION_INDICES].size != (uint64_t)header->indexCount * header->indexSize
+		|| header->sections[MESH_SECTION_LODS].size != header->lodCount * sizeof(MeshLod))
+	{
+		file.close();
+		throw std::runtime_error(path + ": inconsistent mesh file sections!");
+	}
+	lod = reinterpret_cast<const MeshLod *>(file.data() + header->sections[MESH_SECTION_LODS].offset);
+	for (uint32_t i = 0; i < header->lodCount; i++)
+	{
+		if (lod[i].indexOffset > header->indexCount || lod[i].indexCount > header->indexCount - lod[i].indexOffset)
+		{
+			file.close();
+			throw std::runtime_error(path + ": LOD out of the index buffer!");
+		}
+	}
+	fileHeader = header;
+}
+
+void	MeshFile::close()
+{
+	file.close();
+	fileHeader = NULL;
+}
+
+const MeshFileHeader	&MeshFile::header() const
+{
+	return (*fileHeader);
+}
+
+const MeshLod	*MeshFile::lods() const
+{
+	return (reinterpret_cast<const MeshLod *>(section(MESH_SECTION_LODS)));
+}
+
+const uint8_t	*MeshFile::section(MeshSectionType type) const
+{
+	return (file.data() + fileHeader->sections[type].offset);
+}
+
+uint64_t	MeshFile::sectionOffset(MeshSectionType type) const
+{
+	return (fileHeader->sections[type].offset);
+}
+
+uint64_t	MeshFile::sectionSize(MeshSectionType type) const
+{
+	return (fileHeader->sections[type].size);
+}
+
+const MappedFile	&MeshFile::mapping() const
+{
+	return (file);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+#include "MappedFile.h"
+#include "MeshFormat.h"
+
+/*
+** Runtime side of the .vkmesh format: maps the file and hands out pointers
+** into the mapping. Opening only checks the header and the section table,
+** nothing is parsed or copied; the sections are read by whoever uploads
+** them (see uploadMesh in main.cpp).
+*/
+
+class MeshFile
+{
+public:
+	MeshFile();
+
+	/*
+	** Throws a runtime_error if the file can't be mapped or isn't a valid
+	** .vkmesh of this version.
+	*/
+	void					open(const std::string &path);
+	void					close();
+
+	const MeshFileHeader	&header() const;
+	const MeshLod			*lods() const;
+
+	const uint8_t			*section(MeshSectionType type) const;
+	uint64_t				sectionOffset(MeshSectionType type) const;
+	uint64_t				sectionSize(MeshSectionType type) const;
+
+	const MappedFile		&mapping() const;
+
+private:
+	MappedFile				file;
+	const MeshFileHeader	*fileHeader;
+};
@@ -0,0 +1,370 @@
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+
+#include "MeshFormat.h"
+
+/*
+** Vertex cache optimizer parameters, the values of the original article.
+*/
+#define FORSYTH_CACHE_SIZE			32
+#define FORSYTH_DECAY_POWER			1.5f
+#define FORSYTH_LAST_TRI_SCORE		0.75f
+#define FORSYTH_VALENCE_SCALE		2.0f
+#define FORSYTH_VALENCE_POWER		0.5f
+
+uint16_t	floatToHalf(float value)
+{
+	uint32_t	bits;
+	uint32_t	sign;
+	uint32_t	mantissa;
+	uint32_t	shift;
+	uint32_t	half;
+	uint32_t	rest;
+	int32_t		exponent;
+
+	memcpy(&bits, &value, sizeof(bits));
+	sign = (bits >> 16) & 0x8000;
+	exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+	mantissa = bits & 0x7FFFFF;
+	if (((bits >> 23) & 0xFF) == 0xFF)
+		return ((uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0)));
+	if (exponent >= 31)
+		return ((uint16_t)(sign | 0x7C00));
+	if (exponent <= 0)
+	{
+		// Subnormal half, or zero
+		if (exponent < -10)
+			return ((uint16_t)sign);
+		mantissa |= 0x800000;
+		shift = (uint32_t)(14 - exponent);
+		half = mantissa >> shift;
+		rest = mantissa & ((1u << shift) - 1);
+		if (rest > (1u << (shift - 1)) || (rest == (1u << (shift - 1)) && (half & 1)))
+			half++;
+		return ((uint16_t)(sign | half));
+	}
+	// Round to nearest even, a carry into the exponent is still correct
+	mantissa += 0xFFF + ((mantissa >> 13) & 1);
+	return ((uint16_t)(sign | (((uint32_t)exponent << 10) + (mantissa >> 13))));
+}
+
+float	halfToFloat(uint16_t value)
+{
+	uint32_t	sign;
+	uint32_t	exponent;
+	uint32_t	mantissa;
+	uint32_t	bits;
+	float		result;
+
+	sign = (uint32_t)(value & 0x8000) << 16;
+	exponent = (value >> 10) & 0x1F;
+	mantissa = value & 0x3FF;
+	if (exponent == 0)
+	{
+		result = std::ldexp((float)mantissa, -24);
+		return (sign ? -result : result);
+	}
+	if (exponent == 31)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	memcpy(&result, &bits, sizeof(result));
+	return (result);
+}
+
+int8_t	floatToSnorm8(float value)
+{
+	value = std::min(std::max(value, -1.0f), 1.0f);
+	return ((int8_t)std::lround(value * 127.0f));
+}
+
+PackedMesh	packMesh(const MeshData &mesh)
+{
+	PackedMesh	packed;
+	MeshVertex	vertex;
+	MeshLod		lod;
+	size_t		count;
+	float		length;
+
+	count = mesh.vertexCount();
+	packed.vertices.resize(count);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		packed.boundsMin[axis] = count ? mesh.positions[axis] : 0.0f;
+		packed.boundsMax[axis] = count ? mesh.positions[axis] : 0.0f;
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			vertex.position[axis] = floatToHalf(mesh.positions[3 * i + axis]);
+			packed.boundsMin[axis] = std::min(packed.boundsMin[axis], mesh.positions[3 * i + axis]);
+			packed.boundsMax[axis] = std::max(packed.boundsMax[axis], mesh.positions[3 * i + axis]);
+		}
+		vertex.position[3] = floatToHalf(1.0f);
+		if (mesh.normals.empty())
+		{
+			vertex.normal[0] = 0;
+			vertex.normal[1] = 0;
+			vertex.normal[2] = 127;
+		}
+		else
+		{
+			length = std::sqrt(mesh.normals[3 * i] * mesh.normals[3 * i] + mesh.normals[3 * i + 1] * mesh.normals[3 * i + 1] + mesh.normals[3 * i + 2] * mesh.normals[3 * i + 2]);
+			length = (length > 0.0f) ? 1.0f / length : 0.0f;
+			for (int axis = 0; axis < 3; axis++)
+				vertex.normal[axis] = floatToSnorm8(mesh.normals[3 * i + axis] * length);
+		}
+		vertex.normal[3] = 0;
+		vertex.texCoord[0] = floatToHalf(mesh.texCoords.empty() ? 0.0f : mesh.texCoords[2 * i]);
+		vertex.texCoord[1] = floatToHalf(mesh.texCoords.empty() ? 0.0f : mesh.texCoords[2 * i + 1]);
+		packed.vertices[i] = vertex;
+	}
+	packed.indices = mesh.indices;
+	lod.indexOffset = 0;
+	lod.indexCount = (uint32_t)mesh.indices.size();
+	lod.error = 0.0f;
+	lod.reserved = 0;
+	packed.lods.push_back(lod);
+	return (packed);
+}
+
+static float	forsythVertexScore(int cachePosition, uint32_t remaining)
+{
+	float	score;
+
+	if (remaining == 0)
+		return (-1.0f);
+	score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+			score = FORSYTH_LAST_TRI_SCORE;
+		else
+			score = std::pow(1.0f - (cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), FORSYTH_DECAY_POWER);
+	}
+	return (score + FORSYTH_VALENCE_SCALE * std::pow((float)remaining, -FORSYTH_VALENCE_POWER));
+}
+
+void	optimizeVertexCache(std::vector<uint32_t> &indices, size_t first, size_t count, size_t vertexCount)
+{
+	std::vector<uint32_t>	remaining(vertexCount, 0);
+	std::vector<uint32_t>	offsets(vertexCount + 1, 0);
+	std::vector<uint32_t>	adjacency(count);
+	std::vector<int>		cachePosition(vertexCount, -1);
+	std::vector<float>		vertexScore(vertexCount);
+	std::vector<float>		triangleScore(count / 3, 0.0f);
+	std::vector<char>		emitted(count / 3, 0);
+	std::vector<uint32_t>	output;
+	std::vector<uint32_t>	cache;
+	std::vector<uint32_t>	nextCache;
+	const uint32_t			*triangle;
+	size_t					triangleCount;
+	size_t					scan;
+	int64_t					best;
+	float					bestScore;
+	float					score;
+
+	triangleCount = count / 3;
+	if (triangleCount == 0)
+		return;
+	for (size_t i = first; i < first + triangleCount * 3; i++)
+		remaining[indices[i]]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+	std::fill(cachePosition.begin(), cachePosition.end(), 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t	v = indices[first + 3 * t + corner];
+
+			adjacency[offsets[v] + cachePosition[v]++] = (uint32_t)t;
+		}
+	}
+	std::fill(cachePosition.begin(), cachePosition.end(), -1);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangle = &indices[first + 3 * t];
+		triangleScore[t] = vertexScore[triangle[0]] + vertexScore[triangle[1]] + vertexScore[triangle[2]];
+	}
+
+	output.reserve(triangleCount * 3);
+	best = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+	scan = 0;
+	while (output.size() < triangleCount * 3)
+	{
+		if (best < 0)
+		{
+			// Nothing left around the cache: next triangle in input order
+			while (emitted[scan])
+				scan++;
+			best = (int64_t)scan;
+		}
+		triangle = &indices[first + 3 * best];
+		emitted[best] = 1;
+		nextCache.clear();
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t	v = triangle[corner];
+			uint32_t	*begin = &adjacency[offsets[v]];
+			uint32_t	*end = begin + remaining[v];
+
+			output.push_back(v);
+			nextCache.push_back(v);
+			// Active triangles of a vertex are kept at the front of its list
+			std::iter_swap(std::find(begin, end, (uint32_t)best), end - 1);
+			remaining[v]--;
+		}
+		for (uint32_t v : cache)
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				nextCache.push_back(v);
+		if (nextCache.size() > FORSYTH_CACHE_SIZE)
+		{
+			for (size_t i = FORSYTH_CACHE_SIZE; i < nextCache.size(); i++)
+			{
+				uint32_t	v = nextCache[i];
+
+				cachePosition[v] = -1;
+				score = forsythVertexScore(-1, remaining[v]);
+				for (uint32_t j = 0; j < remaining[v]; j++)
+					triangleScore[adjacency[offsets[v] + j]] += score - vertexScore[v];
+				vertexScore[v] = score;
+			}
+			nextCache.resize(FORSYTH_CACHE_SIZE);
+		}
+		cache.swap(nextCache);
+
+		best = -1;
+		bestScore = -1.0f;
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			uint32_t	v = cache[i];
+
+			cachePosition[v] = (int)i;
+			score = forsythVertexScore((int)i, remaining[v]);
+			for (uint32_t j = 0; j < remaining[v]; j++)
+			{
+				uint32_t	t = adjacency[offsets[v] + j];
+
+				triangleScore[t] += score - vertexScore[v];
+			}
+			vertexScore[v] = score;
+		}
+		for (uint32_t v : cache)
+		{
+			for (uint32_t j = 0; j < remaining[v]; j++)
+			{
+				uint32_t	t = adjacency[offsets[v] + j];
+
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+	}
+	std::copy(output.begin(), output.end(), indices.begin() + first);
+}
+
+void	optimizeVertexFetch(PackedMesh &mesh)
+{
+	std::vector<uint32_t>	remap(mesh.vertices.size(), ~0u);
+	std::vector<MeshVertex>	vertices;
+
+	vertices.reserve(mesh.vertices.size());
+	for (uint32_t &index : mesh.indices)
+	{
+		if (remap[index] == ~0u)
+		{
+			remap[index] = (uint32_t)vertices.size();
+			vertices.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+	// Unreferenced vertices are dropped
+	mesh.vertices.swap(vertices);
+}
+
+void	optimizeMesh(PackedMesh &mesh)
+{
+	for (const MeshLod &lod : mesh.lods)
+		optimizeVertexCache(mesh.indices, lod.indexOffset, lod.indexCount, mesh.vertices.size());
+	optimizeVertexFetch(mesh);
+}
+
+double	averageCacheMissRatio(const std::vector<uint32_t> &indices, size_t first, size_t count, size_t vertexCount, unsigned cacheSize)
+{
+	std::vector<uint64_t>	insertedAt(vertexCount, 0);
+	uint64_t				misses;
+
+	if (count < 3)
+		return (0.0);
+	// FIFO: a vertex is cached while less than cacheSize misses followed its own
+	misses = 0;
+	for (size_t i = first; i < first + count; i++)
+	{
+		uint32_t	v = indices[i];
+
+		if (insertedAt[v] == 0 || misses - insertedAt[v] >= cacheSize)
+			insertedAt[v] = ++misses;
+	}
+	return ((double)misses / (count / 3));
+}
+
+static void	writePadded(std::ofstream &file, const void *data, uint64_t size)
+{
+	static const char	zeros[MESH_SECTION_ALIGNMENT] = {};
+
+	file.write(static_cast<const char *>(data), (std::streamsize)size);
+	file.write(zeros, (std::streamsize)(meshAlignSection(size) - size));
+}
+
+void	writeMeshFile(const PackedMesh &mesh, const std::string &path)
+{
+	std::ofstream				file(path, std::ios::binary | std::ios::trunc);
+	MeshFileHeader				header;
+	std::vector<uint16_t>		shortIndices;
+	const void					*indexData;
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open " + path + " for writing!");
+	if (mesh.lods.empty() || mesh.lods.size() > MESH_MAX_LODS)
+		throw std::runtime_error("Invalid LOD count!");
+	memset(&header, 0, sizeof(header));
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.vertexCount = (uint32_t)mesh.vertices.size();
+	header.indexCount = (uint32_t)mesh.indices.size();
+	header.indexSize = (mesh.vertices.size() <= 0x10000) ? 2 : 4;
+	header.vertexStride = sizeof(MeshVertex);
+	header.lodCount = (uint32_t)mesh.lods.size();
+	memcpy(header.boundsMin, mesh.boundsMin, sizeof(header.boundsMin));
+	memcpy(header.boundsMax, mesh.boundsMax, sizeof(header.boundsMax));
+
+	header.sections[MESH_SECTION_VERTICES].offset = meshAlignSection(sizeof(header));
+	header.sections[MESH_SECTION_VERTICES].size = mesh.vertices.size() * sizeof(MeshVertex);
+	header.sections[MESH_SECTION_INDICES].offset = header.sections[MESH_SECTION_VERTICES].offset + meshAlignSection(header.sections[MESH_SECTION_VERTICES].size);
+	header.sections[MESH_SECTION_INDICES].size = (uint64_t)mesh.indices.size() * header.indexSize;
+	header.sections[MESH_SECTION_LODS].offset = header.sections[MESH_SECTION_INDICES].offset + meshAlignSection(header.sections[MESH_SECTION_INDICES].size);
+	header.sections[MESH_SECTION_LODS].size = mesh.lods.size() * sizeof(MeshLod);
+
+	indexData = mesh.indices.data();
+	if (header.indexSize == 2)
+	{
+		shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+		indexData = shortIndices.data();
+	}
+	writePadded(file, &header, sizeof(header));
+	writePadded(file, mesh.vertices.data(), header.sections[MESH_SECTION_VERTICES].size);
+	writePadded(file, indexData, header.sections[MESH_SECTION_INDICES].size);
+	writePadded(file, mesh.lods.data(), header.sections[MESH_SECTION_LODS].size);
+	if (!file.good())
+		throw std::runtime_error("Failed to write " + path + "!");
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+** Preprocessed binary mesh (.vkmesh), written offline by MeshConverter and
+** memory mapped by the application (MeshFile.h).
+**
+** Everything the GPU reads is stored exactly as the device buffers expect
+** it: the runtime never parses, converts or copies it on the CPU.
+**
+**   header | vertices | indices | lods
+**
+** Each section starts on a MESH_SECTION_ALIGNMENT boundary and is padded to
+** a multiple of it, so a section of the mapping can be imported as host
+** memory (VK_EXT_external_memory_host) and copied by the GPU directly.
+** Vertices are quantized to 16 bytes (half float position and texture
+** coordinates, snorm8 normal), indices are 16 bit when the vertex count
+** allows it, and their order is optimized for the post-transform vertex
+** cache, then the vertices are reordered by first use. All values are
+** little endian.
+*/
+
+#define MESH_FILE_MAGIC				0x48534D56u		// "VMSH"
+#define MESH_FILE_VERSION			1
+#define MESH_SECTION_ALIGNMENT		4096
+#define MESH_MAX_LODS				8
+#define MESH_CACHE_SIZE				32				// simulated FIFO for the optimizer statistics
+
+enum					MeshSectionType
+{
+	MESH_SECTION_VERTICES,
+	MESH_SECTION_INDICES,
+	MESH_SECTION_LODS,
+	MESH_SECTION_COUNT
+};
+
+struct					MeshSection
+{
+	uint64_t			offset;
+	uint64_t			size;			// payload, without the padding
+};
+
+/*
+** A level of detail is a range of the index buffer drawing the shared
+** vertices. LOD 0 is the full mesh.
+*/
+struct					MeshLod
+{
+	uint32_t			indexOffset;
+	uint32_t			indexCount;
+	float				error;			// object space deviation from LOD 0
+	uint32_t			reserved;
+};
+
+struct					MeshVertex
+{
+	uint16_t			position[4];	// half float, w = 1
+	int8_t				normal[4];		// snorm8, w = 0
+	uint16_t			texCoord[2];	// half float
+};
+
+struct					MeshFileHeader
+{
+	uint32_t			magic;
+	uint32_t			version;
+	uint32_t			vertexCount;
+	uint32_t			indexCount;		// all the LODs
+	uint32_t			indexSize;		// 2 or 4 bytes
+	uint32_t			vertexStride;	// sizeof(MeshVertex)
+	uint32_t			lodCount;
+	uint32_t			flags;
+	float				boundsMin[3];
+	float				boundsMax[3];
+	MeshSection			sections[MESH_SECTION_COUNT];
+};
+
+static_assert(sizeof(MeshVertex) == 16, "MeshVertex must stay 16 bytes");
+static_assert(sizeof(MeshLod) == 16, "MeshLod must stay 16 bytes");
+
+/*
+** Full precision mesh, as read from a source format (MeshSource.h).
+** normals and texCoords are empty when the source has none.
+*/
+struct							MeshData
+{
+	std::vector<float>			positions;		// xyz
+	std::vector<float>			normals;		// xyz
+	std::vector<float>			texCoords;		// uv
+	std::vector<uint32_t>		indices;
+
+	size_t	vertexCount() const
+	{
+		return (positions.size() / 3);
+	}
+};
+
+/*
+** Mesh in its GPU layout, ready to be written or uploaded.
+*/
+struct							PackedMesh
+{
+	std::vector<MeshVertex>		vertices;
+	std::vector<uint32_t>		indices;
+	std::vector<MeshLod>		lods;
+	float						boundsMin[3];
+	float						boundsMax[3];
+};
+
+uint16_t	floatToHalf(float value);
+float		halfToFloat(uint16_t value);
+int8_t		floatToSnorm8(float value);
+
+/*
+** Quantizes the vertices, one LOD covering all the indices.
+*/
+PackedMesh	packMesh(const MeshData &mesh);
+
+/*
+** Reorders the triangles for the post-transform vertex cache (T. Forsyth's
+** linear-speed algorithm), then the vertices in order of first use so the
+** fetches walk the vertex buffer forward. Each LOD range is optimized on
+** its own.
+*/
+void		optimizeVertexCache(std::vector<uint32_t> &indices, size_t first, size_t count, size_t vertexCount);
+void		optimizeVertexFetch(PackedMesh &mesh);
+void		optimizeMesh(PackedMesh &mesh);
+
+/*
+** Average cache miss ratio (transformed vertices per triangle) of a FIFO
+** vertex cache of cacheSize entries: 3 without any reuse, 0.5 at best on
+** a regular grid.
+*/
+double		averageCacheMissRatio(const std::vector<uint32_t> &indices, size_t first, size_t count, size_t vertexCount, unsigned cacheSize = MESH_CACHE_SIZE);
+
+/*
+** Throws a runtime_error if the file can't be written.
+*/
+void		writeMeshFile(const PackedMesh &mesh, const std::string &path);
+
+inline uint64_t	meshAlignSection(uint64_t size)
+{
+	return ((size + MESH_SECTION_ALIGNMENT - 1) & ~(uint64_t)(MESH_SECTION_ALIGNMENT - 1));
+}
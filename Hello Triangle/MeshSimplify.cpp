@@ -0,0 +1,324 @@
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <unordered_set>
+
+#include "MeshSimplify.h"
+
+/*
+** A level stops the chain when it keeps more than this fraction of the
+** previous one, or has less triangles than LOD_MIN_TRIANGLES.
+*/
+#define LOD_MIN_REDUCTION			0.85f
+#define LOD_MIN_TRIANGLES			16
+
+/*
+** Largest deviation of a LOD, relative to the bounding radius of the mesh:
+** past it the silhouette is gone, whatever the screen size.
+*/
+#define LOD_MAX_RELATIVE_ERROR		0.1f
+
+/*
+** Sum of squared distances to a set of planes, weighted by the area of the
+** triangles they come from. error() divides by the total weight: the mean
+** squared distance, so its root is an object space distance.
+*/
+struct			Quadric
+{
+	double		a2, ab, ac, ad;
+	double		b2, bc, bd;
+	double		c2, cd;
+	double		d2;
+	double		weight;
+};
+
+struct			Collapse
+{
+	uint32_t	from;
+	uint32_t	to;
+	double		error;
+};
+
+static void		addPlane(Quadric &q, double a, double b, double c, double d, double weight)
+{
+	q.a2 += weight * a * a;
+	q.ab += weight * a * b;
+	q.ac += weight * a * c;
+	q.ad += weight * a * d;
+	q.b2 += weight * b * b;
+	q.bc += weight * b * c;
+	q.bd += weight * b * d;
+	q.c2 += weight * c * c;
+	q.cd += weight * c * d;
+	q.d2 += weight * d * d;
+	q.weight += weight;
+}
+
+static void		addQuadric(Quadric &q, const Quadric &other)
+{
+	q.a2 += other.a2;
+	q.ab += other.ab;
+	q.ac += other.ac;
+	q.ad += other.ad;
+	q.b2 += other.b2;
+	q.bc += other.bc;
+	q.bd += other.bd;
+	q.c2 += other.c2;
+	q.cd += other.cd;
+	q.d2 += other.d2;
+	q.weight += other.weight;
+}
+
+static double	quadricError(const Quadric &q, const float *p)
+{
+	double		x;
+	double		y;
+	double		z;
+	double		error;
+
+	x = p[0];
+	y = p[1];
+	z = p[2];
+	error = q.a2 * x * x + 2.0 * q.ab * x * y + 2.0 * q.ac * x * z + 2.0 * q.ad * x
+		+ q.b2 * y * y + 2.0 * q.bc * y * z + 2.0 * q.bd * y
+		+ q.c2 * z * z + 2.0 * q.cd * z
+		+ q.d2;
+	return (q.weight > 0.0 ? std::max(0.0, error / q.weight) : 0.0);
+}
+
+static void		triangleNormal(const float *p0, const float *p1, const float *p2, double normal[3])
+{
+	double		e1[3];
+	double		e2[3];
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		e1[axis] = (double)p1[axis] - p0[axis];
+		e2[axis] = (double)p2[axis] - p0[axis];
+	}
+	normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static uint64_t	edgeKey(uint32_t a, uint32_t b)
+{
+	return (a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a));
+}
+
+/*
+** Moving from onto to must keep every other triangle around from facing
+** the same way (and not degenerate).
+*/
+static bool		collapseFlips(const std::vector<float> &positions, const std::vector<uint32_t> &indices,
+	const std::vector<uint32_t> &adjacencyOffsets, const std::vector<uint32_t> &adjacency, uint32_t from, uint32_t to)
+{
+	const float	*corners[3];
+	double		before[3];
+	double		after[3];
+	uint32_t	triangle;
+	bool		collapsed;
+
+	for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++)
+	{
+		triangle = adjacency[i];
+		collapsed = false;
+		for (int corner = 0; corner < 3; corner++)
+			collapsed |= (indices[3 * triangle + corner] == to);
+		if (collapsed)
+			continue;
+		for (int corner = 0; corner < 3; corner++)
+			corners[corner] = &positions[3 * indices[3 * triangle + corner]];
+		triangleNormal(corners[0], corners[1], corners[2], before);
+		for (int corner = 0; corner < 3; corner++)
+			if (indices[3 * triangle + corner] == from)
+				corners[corner] = &positions[3 * to];
+		triangleNormal(corners[0], corners[1], corners[2], after);
+		if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0)
+			return (true);
+	}
+	return (false);
+}
+
+std::vector<uint32_t>	simplifyMesh(const std::vector<float> &positions, const std::vector<uint32_t> &indices, size_t targetIndexCount, float maxError, float *resultError)
+{
+	std::vector<uint32_t>		result(indices);
+	std::vector<Quadric>		quadrics;
+	std::vector<bool>			locked;
+	std::vector<bool>			touched;
+	std::vector<uint32_t>		remap;
+	std::vector<uint32_t>		adjacencyOffsets;
+	std::vector<uint32_t>		adjacency;
+	std::vector<Collapse>		collapses;
+	std::unordered_set<uint64_t>	edges;
+	std::unordered_set<uint64_t>	borderEdges;
+	size_t						vertexCount;
+	size_t						collapseBudget;
+	size_t						write;
+	double						maxQuadricError;
+	double						worstError;
+	double						normal[3];
+	double						length;
+	const float					*p;
+	uint32_t					a;
+	uint32_t					b;
+	uint32_t					c;
+
+	vertexCount = positions.size() / 3;
+	quadrics.assign(vertexCount, Quadric());
+	locked.assign(vertexCount, false);
+	maxQuadricError = (double)maxError * maxError;
+	worstError = 0.0;
+
+	/*Plane quadrics and border edges of the input*/
+	{
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			triangleNormal(&positions[3 * indices[i]], &positions[3 * indices[i + 1]], &positions[3 * indices[i + 2]], normal);
+			length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (length > 0.0)
+			{
+				for (int axis = 0; axis < 3; axis++)
+					normal[axis] /= length;
+				p = &positions[3 * indices[i]];
+				for (int corner = 0; corner < 3; corner++)
+					addPlane(quadrics[indices[i + corner]], normal[0], normal[1], normal[2],
+						-(normal[0] * p[0] + normal[1] * p[1] + normal[2] * p[2]), 0.5 * length);
+			}
+			for (int edge = 0; edge < 3; edge++)
+			{
+				uint64_t	key = edgeKey(indices[i + edge], indices[i + (edge + 1) % 3]);
+
+				// An edge seen twice is interior, once is a border
+				if (!borderEdges.insert(key).second)
+					borderEdges.erase(key);
+			}
+		}
+		for (uint64_t key : borderEdges)
+		{
+			locked[(uint32_t)(key >> 32)] = true;
+			locked[(uint32_t)key] = true;
+		}
+	}
+
+	/*
+	** Passes of independent collapses: the cheapest ones first, each vertex
+	** (and its one ring) involved in one collapse per pass at most, so the
+	** flip test of a collapse never works on stale triangles.
+	*/
+	while (result.size() > targetIndexCount)
+	{
+		adjacencyOffsets.assign(vertexCount + 1, 0);
+		for (uint32_t index : result)
+			adjacencyOffsets[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		adjacency.resize(result.size());
+		remap.assign(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			adjacency[remap[result[i]]++] = (uint32_t)(i / 3);
+
+		edges.clear();
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int edge = 0; edge < 3; edge++)
+			{
+				Quadric		q;
+				Collapse	collapse;
+				double		error;
+
+				a = result[i + edge];
+				b = result[i + (edge + 1) % 3];
+				if ((locked[a] && locked[b]) || !edges.insert(edgeKey(a, b)).second)
+					continue;
+				q = quadrics[a];
+				addQuadric(q, quadrics[b]);
+				collapse = { a, b, DBL_MAX };
+				if (!locked[a])
+					collapse = { a, b, quadricError(q, &positions[3 * b]) };
+				if (!locked[b] && (error = quadricError(q, &positions[3 * a])) < collapse.error)
+					collapse = { b, a, error };
+				if (collapse.error <= maxQuadricError)
+					collapses.push_back(collapse);
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return (x.error < y.error); });
+
+		// Each collapse removes about two triangles
+		collapseBudget = (result.size() - targetIndexCount) / 6 + 1;
+		touched.assign(vertexCount, false);
+		for (size_t v = 0; v < vertexCount; v++)
+			remap[v] = (uint32_t)v;
+		write = 0;
+		for (const Collapse &collapse : collapses)
+		{
+			if (write >= collapseBudget)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+			if (collapseFlips(positions, result, adjacencyOffsets, adjacency, collapse.from, collapse.to))
+				continue;
+			remap[collapse.from] = collapse.to;
+			addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			worstError = std::max(worstError, collapse.error);
+			for (uint32_t i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1]; i++)
+				for (int corner = 0; corner < 3; corner++)
+					touched[result[3 * adjacency[i] + corner]] = true;
+			write++;
+		}
+		if (write == 0)
+			break;
+
+		// Apply the pass, the collapsed triangles degenerate and are dropped
+		write = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			a = remap[result[i]];
+			b = remap[result[i + 1]];
+			c = remap[result[i + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+	if (resultError)
+		*resultError = (float)std::sqrt(worstError);
+	return (result);
+}
+
+void	buildLodChain(const MeshData &mesh, PackedMesh &packed, size_t maxLods, float ratio)
+{
+	std::vector<uint32_t>	lodIndices;
+	std::vector<uint32_t>	base;
+	MeshLod					lod;
+	float					error;
+	float					radius;
+	size_t					target;
+
+	base.assign(packed.indices.begin() + packed.lods[0].indexOffset, packed.indices.begin() + packed.lods[0].indexOffset + packed.lods[0].indexCount);
+	target = base.size();
+	radius = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+		radius += 0.25f * (packed.boundsMax[axis] - packed.boundsMin[axis]) * (packed.boundsMax[axis] - packed.boundsMin[axis]);
+	radius = std::sqrt(radius);
+	while (packed.lods.size() < maxLods)
+	{
+		target = (size_t)(target / 3 * ratio) * 3;
+		if (target / 3 < LOD_MIN_TRIANGLES)
+			break;
+		lodIndices = simplifyMesh(mesh.positions, base, target, LOD_MAX_RELATIVE_ERROR * radius, &error);
+		if (lodIndices.size() > packed.lods.back().indexCount * LOD_MIN_REDUCTION)
+			break;
+		lod.indexOffset = (uint32_t)packed.indices.size();
+		lod.indexCount = (uint32_t)lodIndices.size();
+		// Selection assumes the error grows with the level
+		lod.error = std::max(error, packed.lods.back().error);
+		lod.reserved = 0;
+		packed.indices.insert(packed.indices.end(), lodIndices.begin(), lodIndices.end());
+		packed.lods.push_back(lod);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "MeshFormat.h"
+
+/*
+** Offline mesh simplification for the LOD chain of a .vkmesh.
+**
+** Edge collapses ordered by quadric error (Garland & Heckbert), restricted
+** to the existing vertices: a vertex is only ever moved onto one of its
+** neighbours, so every LOD is a new index list over the vertex buffer of
+** LOD 0 and the LODs share it on the GPU. Border vertices (edges of a
+** single triangle, which includes the attribute seams) never move, and a
+** collapse that would flip a triangle is rejected.
+*/
+
+/*
+** Simplifies the triangles of indices down to targetIndexCount indices or
+** until the next collapse would deviate more than maxError (object space
+** distance) from the original surface. resultError receives the deviation
+** of the result, when not NULL.
+*/
+std::vector<uint32_t>	simplifyMesh(const std::vector<float> &positions, const std::vector<uint32_t> &indices, size_t targetIndexCount, float maxError, float *resultError);
+
+/*
+** Appends the coarser LODs to packed (right after packMesh, before
+** optimizeMesh): LOD i aims at ratio^i of the triangles of LOD 0, and is
+** simplified from LOD 0 so the errors don't accumulate. Stops at maxLods or
+** once a level can't remove enough triangles anymore.
+*/
+void	buildLodChain(const MeshData &mesh, PackedMesh &packed, size_t maxLods = MESH_MAX_LODS, float ratio = 0.5f);
@@ -0,0 +1,797 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+
+#include "MeshSource.h"
+
+static std::vector<char>	readSourceFile(const std::string &path)
+{
+	std::ifstream		file(path, std::ios::ate | std::ios::binary);
+	std::vector<char>	buffer;
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open " + path + "!");
+	buffer.resize((size_t)file.tellg());
+	file.seekg(0);
+	file.read(buffer.data(), buffer.size());
+	return (buffer);
+}
+
+static std::string	directoryOf(const std::string &path)
+{
+	size_t	slash;
+
+	slash = path.find_last_of("/\\");
+	return ((slash == std::string::npos) ? "" : path.substr(0, slash + 1));
+}
+
+static std::string	extensionOf(const std::string &path)
+{
+	std::string		extension;
+	size_t			dot;
+
+	dot = path.find_last_of('.');
+	if (dot == std::string::npos)
+		return ("");
+	extension = path.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return (extension);
+}
+
+/*
+** Vertex deduplication: one output vertex per distinct attribute set.
+*/
+struct					VertexKey
+{
+	uint32_t			attributes[3];
+
+	bool	operator==(const VertexKey &other) const
+	{
+		return (attributes[0] == other.attributes[0] && attributes[1] == other.attributes[1] && attributes[2] == other.attributes[2]);
+	}
+};
+
+struct					VertexKeyHash
+{
+	size_t	operator()(const VertexKey &key) const
+	{
+		return ((size_t)key.attributes[0] * 73856093u ^ (size_t)key.attributes[1] * 19349663u ^ (size_t)key.attributes[2] * 83492791u);
+	}
+};
+
+/*
+** OBJ
+*/
+
+static const char	*skipSpaces(const char *text, const char *end)
+{
+	while (text < end && (*text == ' ' || *text == '\t'))
+		text++;
+	return (text);
+}
+
+static void	parseObjFloats(const char *text, int count, std::vector<float> &values)
+{
+	char	*after;
+
+	for (int i = 0; i < count; i++)
+	{
+		values.push_back(strtof(text, &after));
+		text = after;
+	}
+}
+
+static int64_t	parseObjIndex(const char *&text, const char *end, size_t count)
+{
+	char		*after;
+	long		value;
+
+	if (text >= end || *text == '/' || *text == ' ' || *text == '\t' || *text == '\r' || *text == '\n')
+		return (-1);
+	value = strtol(text, &after, 10);
+	if (after == text)
+		throw std::runtime_error("Malformed OBJ face!");
+	text = after;
+	if (value < 0)
+		value += (long)count + 1;
+	if (value < 1 || (size_t)value > count)
+		throw std::runtime_error("OBJ face index out of range!");
+	return (value - 1);
+}
+
+MeshData	loadObj(const std::string &path)
+{
+	std::vector<char>			file;
+	std::vector<float>			positions;
+	std::vector<float>			normals;
+	std::vector<float>			texCoords;
+	std::vector<uint32_t>		face;
+	std::unordered_map<VertexKey, uint32_t, VertexKeyHash>	vertices;
+	MeshData					mesh;
+	VertexKey					key;
+	const char					*text;
+	const char					*line;
+	const char					*end;
+	int64_t						index;
+	bool						hasNormals;
+	bool						hasTexCoords;
+
+	file = readSourceFile(path);
+	file.push_back('\n');
+	text = file.data();
+	end = text + file.size();
+	hasNormals = true;
+	hasTexCoords = true;
+	while (text < end)
+	{
+		line = skipSpaces(text, end);
+		text = static_cast<const char *>(memchr(line, '\n', end - line)) + 1;
+		if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t'))
+			parseObjFloats(line + 1, 3, positions);
+		else if (line[0] == 'v' && line[1] == 'n')
+			parseObjFloats(line + 2, 3, normals);
+		else if (line[0] == 'v' && line[1] == 't')
+			parseObjFloats(line + 2, 2, texCoords);
+		else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t'))
+		{
+			face.clear();
+			line = skipSpaces(line + 1, text);
+			while (line < text && *line != '\r' && *line != '\n')
+			{
+				if ((index = parseObjIndex(line, text, positions.size() / 3)) < 0)
+					throw std::runtime_error("Malformed OBJ face!");
+				key.attributes[0] = (uint32_t)index;
+				key.attributes[1] = ~0u;
+				key.attributes[2] = ~0u;
+				if (*line == '/')
+				{
+					line++;
+					index = parseObjIndex(line, text, texCoords.size() / 2);
+					key.attributes[1] = (uint32_t)index;
+					if (*line == '/')
+					{
+						line++;
+						index = parseObjIndex(line, text, normals.size() / 3);
+						key.attributes[2] = (uint32_t)index;
+					}
+				}
+				hasTexCoords = hasTexCoords && key.attributes[1] != ~0u;
+				hasNormals = hasNormals && key.attributes[2] != ~0u;
+				auto inserted = vertices.insert(std::make_pair(key, (uint32_t)mesh.vertexCount()));
+				if (inserted.second)
+				{
+					mesh.positions.insert(mesh.positions.end(), &positions[3 * key.attributes[0]], &positions[3 * key.attributes[0]] + 3);
+					if (key.attributes[1] != ~0u)
+						mesh.texCoords.insert(mesh.texCoords.end(), &texCoords[2 * key.attributes[1]], &texCoords[2 * key.attributes[1]] + 2);
+					else
+						mesh.texCoords.insert(mesh.texCoords.end(), 2, 0.0f);
+					if (key.attributes[2] != ~0u)
+						mesh.normals.insert(mesh.normals.end(), &normals[3 * key.attributes[2]], &normals[3 * key.attributes[2]] + 3);
+					else
+						mesh.normals.insert(mesh.normals.end(), 3, 0.0f);
+				}
+				face.push_back(inserted.first->second);
+				line = skipSpaces(line, text);
+			}
+			if (face.size() < 3)
+				throw std::runtime_error("OBJ face with less than 3 vertices!");
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				mesh.indices.push_back(face[0]);
+				mesh.indices.push_back(face[i - 1]);
+				mesh.indices.push_back(face[i]);
+			}
+		}
+	}
+	if (!hasNormals)
+		mesh.normals.clear();
+	if (!hasTexCoords)
+		mesh.texCoords.clear();
+	return (mesh);
+}
+
+/*
+** Just enough JSON for glTF: values are parsed into a tree, numbers as
+** doubles.
+*/
+namespace
+{
+	struct									JsonValue
+	{
+		enum Type { NONE, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+		Type								type = NONE;
+		double								number = 0.0;
+		std::string							string;
+		std::vector<JsonValue>				array;
+		std::vector<std::pair<std::string, JsonValue> >	members;
+
+		const JsonValue	&operator[](const char *name) const
+		{
+			static const JsonValue	none;
+
+			for (const std::pair<std::string, JsonValue> &member : members)
+				if (member.first == name)
+					return (member.second);
+			return (none);
+		}
+
+		const JsonValue	&operator[](size_t index) const
+		{
+			static const JsonValue	none;
+
+			return ((index < array.size()) ? array[index] : none);
+		}
+
+		bool	has(const char *name) const
+		{
+			return ((*this)[name].type != NONE);
+		}
+
+		size_t	integer(size_t fallback = 0) const
+		{
+			return ((type == NUMBER) ? (size_t)number : fallback);
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		JsonParser(const char *begin, const char *end) : text(begin), end(end)
+		{
+		}
+
+		JsonValue	parse()
+		{
+			JsonValue	value;
+
+			value = parseValue();
+			skip();
+			if (text != end)
+				fail();
+			return (value);
+		}
+
+	private:
+		const char	*text;
+		const char	*end;
+
+		void	fail()
+		{
+			throw std::runtime_error("Malformed glTF JSON!");
+		}
+
+		void	skip()
+		{
+			while (text < end && (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n'))
+				text++;
+		}
+
+		void	expect(char c)
+		{
+			skip();
+			if (text >= end || *text != c)
+				fail();
+			text++;
+		}
+
+		std::string	parseString()
+		{
+			std::string	result;
+
+			expect('"');
+			while (text < end && *text != '"')
+			{
+				if (*text == '\\' && text + 1 < end)
+				{
+					text++;
+					switch (*text)
+					{
+					case 'n': result += '\n'; break;
+					case 't': result += '\t'; break;
+					case 'r': result += '\r'; break;
+					case 'b': result += '\b'; break;
+					case 'f': result += '\f'; break;
+					case 'u':
+						// Names and URIs of the files we read are ASCII
+						if (end - text < 5)
+							fail();
+						result += (char)strtol(std::string(text + 1, text + 5).c_str(), NULL, 16);
+						text += 4;
+						break;
+					default: result += *text; break;
+					}
+					text++;
+				}
+				else
+					result += *text++;
+			}
+			expect('"');
+			return (result);
+		}
+
+		JsonValue	parseValue()
+		{
+			JsonValue	value;
+			char		*after;
+
+			skip();
+			if (text >= end)
+				fail();
+			if (*text == '{')
+			{
+				value.type = JsonValue::OBJECT;
+				text++;
+				skip();
+				if (text < end && *text == '}')
+					return (text++, value);
+				do
+				{
+					std::string	name = parseString();
+
+					expect(':');
+					value.members.push_back(std::make_pair(name, parseValue()));
+					skip();
+				} while (text < end && *text == ',' && ++text);
+				expect('}');
+			}
+			else if (*text == '[')
+			{
+				value.type = JsonValue::ARRAY;
+				text++;
+				skip();
+				if (text < end && *text == ']')
+					return (text++, value);
+				do
+				{
+					value.array.push_back(parseValue());
+					skip();
+				} while (text < end && *text == ',' && ++text);
+				expect(']');
+			}
+			else if (*text == '"')
+			{
+				value.type = JsonValue::STRING;
+				value.string = parseString();
+			}
+			else if (end - text >= 4 && !strncmp(text, "true", 4))
+			{
+				value.type = JsonValue::BOOLEAN;
+				value.number = 1.0;
+				text += 4;
+			}
+			else if (end - text >= 5 && !strncmp(text, "false", 5))
+			{
+				value.type = JsonValue::BOOLEAN;
+				text += 5;
+			}
+			else if (end - text >= 4 && !strncmp(text, "null", 4))
+				text += 4;
+			else
+			{
+				value.type = JsonValue::NUMBER;
+				value.number = strtod(text, &after);
+				if (after == text)
+					fail();
+				text = after;
+			}
+			return (value);
+		}
+	};
+}
+
+static std::vector<uint8_t>	decodeBase64(const std::string &text)
+{
+	std::vector<uint8_t>	data;
+	uint32_t				bits;
+	int						count;
+	int						value;
+
+	bits = 0;
+	count = 0;
+	for (char c : text)
+	{
+		if (c >= 'A' && c <= 'Z')
+			value = c - 'A';
+		else if (c >= 'a' && c <= 'z')
+			value = c - 'a' + 26;
+		else if (c >= '0' && c <= '9')
+			value = c - '0' + 52;
+		else if (c == '+' || c == '-')
+			value = 62;
+		else if (c == '/' || c == '_')
+			value = 63;
+		else
+			continue;
+		bits = (bits << 6) | (uint32_t)value;
+		if ((count += 6) >= 8)
+		{
+			count -= 8;
+			data.push_back((uint8_t)(bits >> count));
+		}
+	}
+	return (data);
+}
+
+/*
+** Reads element i of an accessor as floats (normalized integers are
+** converted, plain integers are converted as is).
+*/
+struct						GltfAccessor
+{
+	const uint8_t			*data;
+	size_t					count;
+	size_t					stride;
+	size_t					components;
+	uint32_t				componentType;
+	bool					normalized;
+
+	float	get(size_t i, size_t component) const
+	{
+		const uint8_t	*element = data + i * stride;
+
+		switch (componentType)
+		{
+		case 5126:
+		{
+			float	value;
+
+			memcpy(&value, element + 4 * component, sizeof(value));
+			return (value);
+		}
+		case 5121:
+			return (normalized ? element[component] / 255.0f : (float)element[component]);
+		case 5123:
+		{
+			uint16_t	value;
+
+			memcpy(&value, element + 2 * component, sizeof(value));
+			return (normalized ? value / 65535.0f : (float)value);
+		}
+		case 5125:
+		{
+			uint32_t	value;
+
+			memcpy(&value, element + 4 * component, sizeof(value));
+			return ((float)value);
+		}
+		}
+		return (0.0f);
+	}
+
+	uint32_t	index(size_t i) const
+	{
+		const uint8_t	*element = data + i * stride;
+		uint32_t		value;
+
+		if (componentType == 5121)
+			return (element[0]);
+		if (componentType == 5123)
+		{
+			uint16_t	value16;
+
+			memcpy(&value16, element, sizeof(value16));
+			return (value16);
+		}
+		memcpy(&value, element, sizeof(value));
+		return (value);
+	}
+};
+
+static GltfAccessor	gltfAccessor(const JsonValue &root, const std::vector<std::vector<uint8_t> > &buffers, size_t index)
+{
+	static const char	*typeNames[] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+	const JsonValue		&accessor = root["accessors"][index];
+	const JsonValue		&view = root["bufferViews"][accessor["bufferView"].integer(~(size_t)0)];
+	GltfAccessor		result;
+	size_t				componentSize;
+	size_t				offset;
+	size_t				buffer;
+
+	if (accessor.type != JsonValue::OBJECT || view.type != JsonValue::OBJECT || accessor.has("sparse"))
+		throw std::runtime_error("Unsupported glTF accessor!");
+	result.componentType = (uint32_t)accessor["componentType"].integer();
+	result.normalized = accessor["normalized"].number != 0.0;
+	result.count = accessor["count"].integer();
+	result.components = 0;
+	for (size_t i = 0; i < 4; i++)
+		if (accessor["type"].string == typeNames[i])
+			result.components = i + 1;
+	switch (result.componentType)
+	{
+	case 5121: componentSize = 1; break;
+	case 5123: componentSize = 2; break;
+	case 5125: case 5126: componentSize = 4; break;
+	default: throw std::runtime_error("Unsupported glTF component type!");
+	}
+	if (result.components == 0)
+		throw std::runtime_error("Unsupported glTF accessor type!");
+	result.stride = view["byteStride"].integer(componentSize * result.components);
+	buffer = view["buffer"].integer(~(size_t)0);
+	offset = view["byteOffset"].integer() + accessor["byteOffset"].integer();
+	if (buffer >= buffers.size() || (result.count && offset + (result.count - 1) * result.stride + componentSize * result.components > buffers[buffer].size()))
+		throw std::runtime_error("glTF accessor out of its buffer!");
+	result.data = buffers[buffer].data() + offset;
+	return (result);
+}
+
+MeshData	loadGltf(const std::string &path)
+{
+	std::vector<char>					file;
+	std::vector<std::vector<uint8_t> >	buffers;
+	JsonValue							root;
+	MeshData							mesh;
+	const char							*json;
+	size_t								jsonSize;
+	std::vector<uint8_t>				binChunk;
+	uint32_t							chunkLength;
+	uint32_t							chunkType;
+	bool								hasNormals;
+	bool								hasTexCoords;
+
+	file = readSourceFile(path);
+	json = file.data();
+	jsonSize = file.size();
+	if (file.size() >= 20 && !memcmp(file.data(), "glTF", 4))
+	{
+		// GLB: 12 byte header, JSON chunk, optional BIN chunk
+		memcpy(&chunkLength, &file[12], 4);
+		memcpy(&chunkType, &file[16], 4);
+		if (chunkType != 0x4E4F534A || 20 + (size_t)chunkLength > file.size())
+			throw std::runtime_error("Malformed GLB file!");
+		json = &file[20];
+		jsonSize = chunkLength;
+		if (20 + (size_t)chunkLength + 8 <= file.size())
+		{
+			size_t	bin = 20 + chunkLength;
+
+			memcpy(&chunkLength, &file[bin], 4);
+			memcpy(&chunkType, &file[bin + 4], 4);
+			if (chunkType == 0x004E4942 && bin + 8 + chunkLength <= file.size())
+				binChunk.assign(&file[bin + 8], &file[bin + 8] + chunkLength);
+		}
+	}
+	root = JsonParser(json, json + jsonSize).parse();
+
+	for (const JsonValue &buffer : root["buffers"].array)
+	{
+		const std::string	&uri = buffer["uri"].string;
+		std::vector<char>	content;
+
+		if (!buffer.has("uri"))
+			buffers.push_back(binChunk);
+		else if (uri.compare(0, 5, "data:") == 0)
+			buffers.push_back(decodeBase64(uri.substr(uri.find(',') + 1)));
+		else
+		{
+			content = readSourceFile(directoryOf(path) + uri);
+			buffers.push_back(std::vector<uint8_t>(content.begin(), content.end()));
+		}
+	}
+
+	hasNormals = true;
+	hasTexCoords = true;
+	for (const JsonValue &gltfMesh : root["meshes"].array)
+	{
+		for (const JsonValue &primitive : gltfMesh["primitives"].array)
+		{
+			const JsonValue		&attributes = primitive["attributes"];
+			GltfAccessor		positions;
+			size_t				base;
+
+			if (primitive["mode"].integer(4) != 4 || !attributes.has("POSITION"))
+				continue;
+			base = mesh.vertexCount();
+			positions = gltfAccessor(root, buffers, attributes["POSITION"].integer());
+			for (size_t i = 0; i < positions.count; i++)
+				for (size_t c = 0; c < 3; c++)
+					mesh.positions.push_back(positions.get(i, c));
+			if (attributes.has("NORMAL"))
+			{
+				GltfAccessor	normals = gltfAccessor(root, buffers, attributes["NORMAL"].integer());
+
+				for (size_t i = 0; i < positions.count; i++)
+					for (size_t c = 0; c < 3; c++)
+						mesh.normals.push_back(i < normals.count ? normals.get(i, c) : 0.0f);
+			}
+			else
+			{
+				hasNormals = false;
+				mesh.normals.resize(mesh.positions.size(), 0.0f);
+			}
+			if (attributes.has("TEXCOORD_0"))
+			{
+				GltfAccessor	texCoords = gltfAccessor(root, buffers, attributes["TEXCOORD_0"].integer());
+
+				for (size_t i = 0; i < positions.count; i++)
+					for (size_t c = 0; c < 2; c++)
+						mesh.texCoords.push_back(i < texCoords.count ? texCoords.get(i, c) : 0.0f);
+			}
+			else
+			{
+				hasTexCoords = false;
+				mesh.texCoords.resize(2 * mesh.vertexCount(), 0.0f);
+			}
+			if (primitive.has("indices"))
+			{
+				GltfAccessor	indices = gltfAccessor(root, buffers, primitive["indices"].integer());
+
+				for (size_t i = 0; i < indices.count; i++)
+				{
+					if (indices.index(i) >= positions.count)
+						throw std::runtime_error("glTF index out of range!");
+					mesh.indices.push_back((uint32_t)(base + indices.index(i)));
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < positions.count; i++)
+					mesh.indices.push_back((uint32_t)(base + i));
+			}
+		}
+	}
+	if (mesh.indices.empty())
+		throw std::runtime_error("No triangles in " + path + "!");
+	if (!hasNormals)
+		mesh.normals.clear();
+	if (!hasTexCoords)
+		mesh.texCoords.clear();
+	return (mesh);
+}
+
+MeshData	loadMeshSource(const std::string &path)
+{
+	std::string		extension;
+
+	extension = extensionOf(path);
+	if (extension == "obj")
+		return (loadObj(path));
+	if (extension == "gltf" || extension == "glb")
+		return (loadGltf(path));
+	throw std::runtime_error("Unknown mesh format: " + path + "!");
+}
+
+void	generateNormals(MeshData &mesh)
+{
+	const float		*a;
+	const float		*b;
+	const float		*c;
+	float			normal[3];
+
+	mesh.normals.assign(mesh.positions.size(), 0.0f);
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		a = &mesh.positions[3 * mesh.indices[i]];
+		b = &mesh.positions[3 * mesh.indices[i + 1]];
+		c = &mesh.positions[3 * mesh.indices[i + 2]];
+		// Cross product length is twice the area: larger faces weigh more
+		normal[0] = (b[1] - a[1]) * (c[2] - a[2]) - (b[2] - a[2]) * (c[1] - a[1]);
+		normal[1] = (b[2] - a[2]) * (c[0] - a[0]) - (b[0] - a[0]) * (c[2] - a[2]);
+		normal[2] = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+		for (int corner = 0; corner < 3; corner++)
+			for (int axis = 0; axis < 3; axis++)
+				mesh.normals[3 * mesh.indices[i + corner] + axis] += normal[axis];
+	}
+}
+
+MeshData	makeSphere(uint32_t rings, uint32_t segments)
+{
+	const float		pi = 3.14159265358979f;
+	MeshData		mesh;
+	float			theta;
+	float			phi;
+	uint32_t		row;
+
+	for (uint32_t ring = 0; ring <= rings; ring++)
+	{
+		theta = pi * ring / rings;
+		for (uint32_t segment = 0; segment <= segments; segment++)
+		{
+			phi = 2.0f * pi * segment / segments;
+			mesh.positions.push_back(std::sin(theta) * std::cos(phi));
+			mesh.positions.push_back(std::cos(theta));
+			mesh.positions.push_back(std::sin(theta) * std::sin(phi));
+			mesh.normals.insert(mesh.normals.end(), mesh.positions.end() - 3, mesh.positions.end());
+			mesh.texCoords.push_back((float)segment / segments);
+			mesh.texCoords.push_back((float)ring / rings);
+		}
+	}
+	row = segments + 1;
+	for (uint32_t ring = 0; ring < rings; ring++)
+	{
+		for (uint32_t segment = 0; segment < segments; segment++)
+		{
+			uint32_t	v = ring * row + segment;
+			uint32_t	quad[6] = { v, v + 1, v + row, v + 1, v + row + 1, v + row };
+
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+	return (mesh);
+}
+
+void	saveObj(const MeshData &mesh, const std::string &path)
+{
+	FILE	*file;
+
+	if ((file = fopen(path.c_str(), "w")) == NULL)
+		throw std::runtime_error("Failed to open " + path + " for writing!");
+	for (size_t i = 0; i < mesh.vertexCount(); i++)
+		fprintf(file, "v %.6f %.6f %.6f\n", mesh.positions[3 * i], mesh.positions[3 * i + 1], mesh.positions[3 * i + 2]);
+	for (size_t i = 0; i < mesh.texCoords.size() / 2; i++)
+		fprintf(file, "vt %.6f %.6f\n", mesh.texCoords[2 * i], mesh.texCoords[2 * i + 1]);
+	for (size_t i = 0; i < mesh.normals.size() / 3; i++)
+		fprintf(file, "vn %.6f %.6f %.6f\n", mesh.normals[3 * i], mesh.normals[3 * i + 1], mesh.normals[3 * i + 2]);
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		fprintf(file, "f");
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t	v = mesh.indices[i + corner] + 1;
+
+			if (!mesh.texCoords.empty() && !mesh.normals.empty())
+				fprintf(file, " %u/%u/%u", v, v, v);
+			else if (!mesh.normals.empty())
+				fprintf(file, " %u//%u", v, v);
+			else
+				fprintf(file, " %u", v);
+		}
+		fprintf(file, "\n");
+	}
+	if (fclose(file) != 0)
+		throw std::runtime_error("Failed to write " + path + "!");
+}
+
+void	saveGltf(const MeshData &mesh, const std::string &path)
+{
+	std::ofstream		json(path, std::ios::trunc);
+	std::ofstream		bin;
+	std::string			binPath;
+	std::string			binName;
+	size_t				sizes[4];
+	size_t				offset;
+	int					accessor;
+
+	binPath = path.substr(0, path.find_last_of('.')) + ".bin";
+	binName = binPath.substr(binPath.find_last_of("/\\") + 1);
+	bin.open(binPath, std::ios::binary | std::ios::trunc);
+	if (!json.is_open() || !bin.is_open())
+		throw std::runtime_error("Failed to open " + path + " for writing!");
+	sizes[0] = mesh.positions.size() * sizeof(float);
+	sizes[1] = mesh.normals.size() * sizeof(float);
+	sizes[2] = mesh.texCoords.size() * sizeof(float);
+	sizes[3] = mesh.indices.size() * sizeof(uint32_t);
+	bin.write(reinterpret_cast<const char *>(mesh.positions.data()), sizes[0]);
+	bin.write(reinterpret_cast<const char *>(mesh.normals.data()), sizes[1]);
+	bin.write(reinterpret_cast<const char *>(mesh.texCoords.data()), sizes[2]);
+	bin.write(reinterpret_cast<const char *>(mesh.indices.data()), sizes[3]);
+
+	json << "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"uri\":\"" << binName << "\",\"byteLength\":"
+		<< sizes[0] + sizes[1] + sizes[2] + sizes[3] << "}],\"bufferViews\":[";
+	offset = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		json << (i ? "," : "") << "{\"buffer\":0,\"byteOffset\":" << offset << ",\"byteLength\":" << sizes[i] << "}";
+		offset += sizes[i];
+	}
+	json << "],\"accessors\":["
+		<< "{\"bufferView\":0,\"componentType\":5126,\"count\":" << mesh.vertexCount() << ",\"type\":\"VEC3\"}"
+		<< ",{\"bufferView\":1,\"componentType\":5126,\"count\":" << mesh.normals.size() / 3 << ",\"type\":\"VEC3\"}"
+		<< ",{\"bufferView\":2,\"componentType\":5126,\"count\":" << mesh.texCoords.size() / 2 << ",\"type\":\"VEC2\"}"
+		<< ",{\"bufferView\":3,\"componentType\":5125,\"count\":" << mesh.indices.size() << ",\"type\":\"SCALAR\"}"
+		<< "],\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0";
+	accessor = 1;
+	if (!mesh.normals.empty())
+		json << ",\"NORMAL\":" << accessor;
+	accessor++;
+	if (!mesh.texCoords.empty())
+		json << ",\"TEXCOORD_0\":" << accessor;
+	json << "},\"indices\":3}]}]}" << std::endl;
+	if (!json.good() || !bin.good())
+		throw std::runtime_error("Failed to write " + path + "!");
+}
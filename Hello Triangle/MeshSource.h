@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include "MeshFormat.h"
+
+/*
+** Source mesh formats, read by MeshConverter and by the mesh benchmark,
+** which compares them with loading the preprocessed format.
+**
+** Wavefront OBJ: v / vt / vn / f, polygons are triangulated as fans,
+** negative indices are supported, materials and groups are ignored.
+** glTF 2.0 (.gltf with external or data URI buffers, or .glb): every
+** triangle primitive of every mesh, node transforms and sparse accessors
+** are not supported.
+**
+** Vertices are deduplicated on their full attribute set. All the loaders
+** throw a runtime_error on malformed or unsupported input.
+*/
+
+MeshData	loadObj(const std::string &path);
+MeshData	loadGltf(const std::string &path);
+
+/*
+** Picks the loader from the file extension.
+*/
+MeshData	loadMeshSource(const std::string &path);
+
+/*
+** Area weighted vertex normals, for sources without them.
+*/
+void		generateNormals(MeshData &mesh);
+
+/*
+** Test geometry: UV sphere of radius 1 with normals and texture
+** coordinates, 2 * rings * segments triangles.
+*/
+MeshData	makeSphere(uint32_t rings, uint32_t segments);
+
+void		saveObj(const MeshData &mesh, const std::string &path);
+
+/*
+** Writes path and its buffer next to it (path with a .bin extension).
+*/
+void		saveGltf(const MeshData &mesh, const std::string &path);
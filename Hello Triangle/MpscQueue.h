@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+** Bounded lock-free multi-producer / single-consumer ring buffer.
+**
+** Each cell carries a sequence number telling whether it is free for the
+** producer of a given ticket or holds a value for the consumer (D. Vyukov's
+** bounded queue). Producers never block: tryPush() fails when the ring is
+** full and the caller decides what to drop. Capacity must be a power of two.
+*/
+
+template <typename T, size_t Capacity>
+class MpscQueue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "MpscQueue capacity must be a power of two");
+
+public:
+	MpscQueue() : head(0), tail(0)
+	{
+		for (size_t i = 0; i < Capacity; i++)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	/*
+	** Reserves a cell, lets fill() write the value in place and publishes it.
+	** Used to avoid building large values twice.
+	*/
+	template <typename F>
+	bool	tryEmplace(F fill)
+	{
+		Cell		*cell;
+		size_t		pos;
+		intptr_t	diff;
+
+		pos = tail.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &cells[pos & (Capacity - 1)];
+			diff = (intptr_t)cell->sequence.load(std::memory_order_acquire) - (intptr_t)pos;
+			if (diff == 0)
+			{
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return (false);
+			else
+				pos = tail.load(std::memory_order_relaxed);
+		}
+		fill(cell->value);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return (true);
+	}
+
+	bool	tryPush(const T &value)
+	{
+		return (tryEmplace([&value](T &slot) { slot = value; }));
+	}
+
+	/*
+	** Single consumer only.
+	*/
+	bool	tryPop(T &value)
+	{
+		Cell		*cell;
+		size_t		pos;
+
+		pos = head.load(std::memory_order_relaxed);
+		cell = &cells[pos & (Capacity - 1)];
+		if ((intptr_t)cell->sequence.load(std::memory_order_acquire) - (intptr_t)(pos + 1) < 0)
+			return (false);
+		value = cell->value;
+		cell->sequence.store(pos + Capacity, std::memory_order_release);
+		head.store(pos + 1, std::memory_order_relaxed);
+		return (true);
+	}
+
+	bool	empty() const
+	{
+		return (head.load(std::memory_order_relaxed) == tail.load(std::memory_order_relaxed));
+	}
+
+private:
+	struct						Cell
+	{
+		std::atomic<size_t>		sequence;
+		T						value;
+	};
+
+	/*
+	** head and tail on separate cache lines: consumer and producers don't
+	** invalidate each other.
+	*/
+	Cell						cells[Capacity];
+	std::atomic<size_t>			head;
+	char						padding[64 - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t>			tail;
+};
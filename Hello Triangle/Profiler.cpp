@@ -0,0 +1,185 @@
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+
+#include "Profiler.h"
+
+/*
+** Events of one thread. events and count are only written by the owner,
+** the other fields under tracksMutex.
+*/
+struct								ProfileThread
+{
+	std::vector<ProfileEvent>		events;
+	std::atomic<size_t>				count;
+	std::atomic<size_t>				dropped;
+	std::atomic<uint32_t>			epoch;
+	uint32_t						track;
+};
+
+std::atomic<bool>		Profiler::active(false);
+std::atomic<uint32_t>	Profiler::epoch(0);
+
+static std::mutex									tracksMutex;
+static std::vector<std::string>						trackNames;
+static std::vector<std::unique_ptr<ProfileThread>>	threads;
+static thread_local ProfileThread					*currentThread = NULL;
+
+static uint32_t		newTrack(const std::string &name)
+{
+	trackNames.push_back(name);
+	return ((uint32_t)trackNames.size() - 1);
+}
+
+/*
+** Registered on first use and never freed: the trace may still need the
+** events of a thread that has exited (job systems are recreated).
+*/
+static ProfileThread	*threadBuffer()
+{
+	std::lock_guard<std::mutex>	lock(tracksMutex);
+
+	if (!currentThread)
+	{
+		threads.emplace_back(new ProfileThread());
+		currentThread = threads.back().get();
+		currentThread->count = 0;
+		currentThread->dropped = 0;
+		currentThread->epoch = ~0u;
+		currentThread->track = newTrack("thread " + std::to_string(threads.size() - 1));
+	}
+	return (currentThread);
+}
+
+void	Profiler::start()
+{
+	epoch.fetch_add(1);
+	active = true;
+}
+
+void	Profiler::stop()
+{
+	active = false;
+}
+
+int64_t		Profiler::nowNs()
+{
+	static const std::chrono::steady_clock::time_point	origin = std::chrono::steady_clock::now();
+
+	return (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count());
+}
+
+void	Profiler::setThreadName(const std::string &name)
+{
+	ProfileThread	*thread;
+
+	thread = currentThread ? currentThread : threadBuffer();
+	std::lock_guard<std::mutex>	lock(tracksMutex);
+	trackNames[thread->track] = name;
+}
+
+uint32_t	Profiler::addTrack(const std::string &name)
+{
+	std::lock_guard<std::mutex>	lock(tracksMutex);
+
+	return (newTrack(name));
+}
+
+void	Profiler::record(const char *name, int64_t startNs, int64_t endNs)
+{
+	ProfileThread	*thread;
+
+	if (!enabled())
+		return;
+	thread = currentThread ? currentThread : threadBuffer();
+	record(name, startNs, endNs, thread->track);
+}
+
+void	Profiler::record(const char *name, int64_t startNs, int64_t endNs, uint32_t track)
+{
+	ProfileThread	*thread;
+	size_t			index;
+	uint32_t		current;
+
+	if (!enabled())
+		return;
+	thread = currentThread ? currentThread : threadBuffer();
+	current = epoch.load(std::memory_order_relaxed);
+	if (thread->epoch.load(std::memory_order_relaxed) != current)
+	{
+		// First event of this thread in the capture
+		if (thread->events.empty())
+			thread->events.resize(PROFILER_THREAD_EVENTS);
+		thread->count.store(0, std::memory_order_relaxed);
+		thread->dropped.store(0, std::memory_order_relaxed);
+		thread->epoch.store(current, std::memory_order_release);
+	}
+	index = thread->count.load(std::memory_order_relaxed);
+	if (index == thread->events.size())
+	{
+		thread->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	thread->events[index] = { name, startNs, endNs - startNs, track };
+	thread->count.store(index + 1, std::memory_order_release);
+}
+
+static void		writeString(std::ostream &out, const std::string &text)
+{
+	out << '"';
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			out << '\\';
+		out << c;
+	}
+	out << '"';
+}
+
+size_t	Profiler::write(const std::string &path, size_t *dropped)
+{
+	std::ofstream		out(path, std::ios::binary);
+	std::lock_guard<std::mutex>	lock(tracksMutex);
+	uint32_t			current;
+	size_t				written;
+	size_t				count;
+	char				times[64];
+
+	if (dropped)
+		*dropped = 0;
+	if (!out.is_open())
+		return (0);
+	current = epoch.load();
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	for (size_t track = 0; track < trackNames.size(); track++)
+	{
+		out << (track ? ",\n" : "") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track << ",\"args\":{\"name\":";
+		writeString(out, trackNames[track]);
+		out << "}},{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track << ",\"args\":{\"sort_index\":" << track << "}}";
+	}
+	written = 0;
+	for (const std::unique_ptr<ProfileThread> &thread : threads)
+	{
+		if (thread->epoch.load(std::memory_order_acquire) != current)
+			continue;
+		count = thread->count.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; i++)
+		{
+			const ProfileEvent	&event = thread->events[i];
+
+			// Microseconds, with the nanoseconds as decimals
+			snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", event.startNs / 1000.0, event.durationNs / 1000.0);
+			out << ",\n{\"name\":";
+			writeString(out, event.name);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.track << "," << times << "}";
+		}
+		written += count;
+		if (dropped)
+			*dropped += thread->dropped.load(std::memory_order_relaxed);
+	}
+	out << "\n]}\n";
+	return (out.good() ? written : 0);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+/*
+** Timeline profiler, exported as Chrome trace JSON (chrome://tracing,
+** ui.perfetto.dev).
+**
+** PROFILE_ZONE(name) times the rest of the enclosing scope on the calling
+** thread. Outside of a capture a zone costs one relaxed atomic load, and
+** compiling with _NO_PROFILER removes them altogether. Each thread records
+** into its own fixed size buffer that only it writes, publishing its event
+** count with a release store: recording never takes a lock. A capture is
+** an epoch: start() bumps it, and a thread drops its previous events the
+** first time it records in the new one, so nothing is cleared behind the
+** back of a thread still finishing a zone.
+**
+** Zones can also be recorded on a named track of their own (GPU queues:
+** see record()), timed with the clock of nowNs().
+**
+** name must outlive the capture: zones take string literals.
+*/
+
+#define PROFILER_THREAD_EVENTS		65536
+
+struct					ProfileEvent
+{
+	const char			*name;
+	int64_t				startNs;
+	int64_t				durationNs;
+	uint32_t			track;
+};
+
+class Profiler
+{
+public:
+	static void			start();
+	static void			stop();
+	static bool			enabled()
+	{
+		return (active.load(std::memory_order_relaxed));
+	}
+
+	static int64_t		nowNs();
+
+	/*
+	** Name of the calling thread's track in the trace.
+	*/
+	static void			setThreadName(const std::string &name);
+	/*
+	** A track that doesn't belong to a thread, for events recorded with
+	** record(..., track).
+	*/
+	static uint32_t		addTrack(const std::string &name);
+
+	/*
+	** Records [startNs, endNs) on the calling thread's track, or on track.
+	** Does nothing outside of a capture.
+	*/
+	static void			record(const char *name, int64_t startNs, int64_t endNs);
+	static void			record(const char *name, int64_t startNs, int64_t endNs, uint32_t track);
+
+	/*
+	** Writes the events of the last capture (call after stop()). Returns the
+	** number of events written, 0 if path can't be written. dropped receives
+	** the events lost to full buffers when not NULL.
+	*/
+	static size_t		write(const std::string &path, size_t *dropped = NULL);
+
+private:
+	static std::atomic<bool>		active;
+	static std::atomic<uint32_t>	epoch;
+};
+
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char *zoneName) : name(zoneName), startNs(Profiler::enabled() ? Profiler::nowNs() : -1)
+	{
+	}
+
+	~ProfileZone()
+	{
+		if (startNs >= 0)
+			Profiler::record(name, startNs, Profiler::nowNs());
+	}
+
+private:
+	const char			*name;
+	int64_t				startNs;
+
+	ProfileZone(const ProfileZone &);
+	ProfileZone			&operator=(const ProfileZone &);
+};
+
+#define PROFILE_CONCAT_(a, b)		a##b
+#define PROFILE_CONCAT(a, b)		PROFILE_CONCAT_(a, b)
+
+#ifdef _NO_PROFILER
+# define PROFILE_ZONE(name)
+#else
+# define PROFILE_ZONE(name)			ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#include "MpscQueue.h"
+
+/*
+** Messages from the window thread (GLFW callbacks) to the render thread.
+** The callbacks only timestamp and push them, the render thread drains the
+** queue before each frame, so OS event handling never runs inside a frame
+** and a blocked event loop never stalls rendering.
+*/
+
+enum					RenderEventType
+{
+	RENDER_EVENT_RESIZE,
+	RENDER_EVENT_ICONIFY,
+	RENDER_EVENT_KEY,
+	RENDER_EVENT_MOUSE_BUTTON,
+	RENDER_EVENT_CURSOR,
+	RENDER_EVENT_SCROLL
+};
+
+struct					RenderEvent
+{
+	RenderEventType		type;
+	int32_t				view;		// index of the window in the views
+	int32_t				width;		// resize
+	int32_t				height;		// resize
+	int32_t				code;		// key / mouse button, iconified flag
+	int32_t				action;		// GLFW_PRESS / GLFW_RELEASE / GLFW_REPEAT
+	int32_t				mods;
+	double				x;			// cursor position / scroll offset
+	double				y;
+	double				time;		// glfwGetTime() when the callback ran
+};
+
+typedef MpscQueue<RenderEvent, 256>	RenderEventQueue;
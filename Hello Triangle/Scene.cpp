@@ -0,0 +1,452 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <immintrin.h>
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+#include "Scene.h"
+
+/*
+** MSVC lets any intrinsic be used anywhere, GCC and clang only in functions
+** compiled for the matching target.
+*/
+#if defined(__GNUC__) && !defined(_MSC_VER)
+# define SCENE_TARGET_AVX2		__attribute__((target("avx2,fma")))
+#else
+# define SCENE_TARGET_AVX2
+#endif
+
+#define SCENE_ALIGNMENT			64				// a cache line
+
+SceneFrustum	sceneFrustum(const glm::mat4 &viewProjection)
+{
+	SceneFrustum	frustum;
+	float			rows[4][4];
+	float			length;
+
+	for (int row = 0; row < 4; row++)
+		for (int column = 0; column < 4; column++)
+			rows[row][column] = viewProjection[column][row];
+	for (int axis = 0; axis < 4; axis++)
+	{
+		frustum.planes[0][axis] = rows[3][axis] + rows[0][axis];
+		frustum.planes[1][axis] = rows[3][axis] - rows[0][axis];
+		frustum.planes[2][axis] = rows[3][axis] + rows[1][axis];
+		frustum.planes[3][axis] = rows[3][axis] - rows[1][axis];
+		frustum.planes[4][axis] = rows[2][axis];
+		frustum.planes[5][axis] = rows[3][axis] - rows[2][axis];
+	}
+	for (float *plane : frustum.planes)
+	{
+		length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 0.0f)
+			for (int axis = 0; axis < 4; axis++)
+				plane[axis] /= length;
+	}
+	return (frustum);
+}
+
+const char	*sceneSimdName(SceneSimd simd)
+{
+	switch (simd)
+	{
+	case SCENE_SIMD_SSE:
+		return ("SSE");
+	case SCENE_SIMD_AVX2:
+		return ("AVX2");
+	default:
+		return ("scalar");
+	}
+}
+
+/*
+** Batch kernels, one set per instruction set. f is the field table of the
+** scene: f[SCENE_POSITION_X][i] is the x position of object i. The vector
+** loops leave the last (end - begin) % width objects to the scalar kernel.
+*/
+
+static void		updateWorldScalar(float *const *f, size_t begin, size_t end)
+{
+	float		x, y, z, w;
+	float		s;
+
+	for (size_t i = begin; i < end; i++)
+	{
+		x = f[SCENE_ROTATION_X][i];
+		y = f[SCENE_ROTATION_Y][i];
+		z = f[SCENE_ROTATION_Z][i];
+		w = f[SCENE_ROTATION_W][i];
+		s = f[SCENE_SCALE][i];
+		f[SCENE_WORLD_00][i] = (1.0f - 2.0f * (y * y + z * z)) * s;
+		f[SCENE_WORLD_01][i] = 2.0f * (x * y - w * z) * s;
+		f[SCENE_WORLD_02][i] = 2.0f * (x * z + w * y) * s;
+		f[SCENE_WORLD_03][i] = f[SCENE_POSITION_X][i];
+		f[SCENE_WORLD_10][i] = 2.0f * (x * y + w * z) * s;
+		f[SCENE_WORLD_11][i] = (1.0f - 2.0f * (x * x + z * z)) * s;
+		f[SCENE_WORLD_12][i] = 2.0f * (y * z - w * x) * s;
+		f[SCENE_WORLD_13][i] = f[SCENE_POSITION_Y][i];
+		f[SCENE_WORLD_20][i] = 2.0f * (x * z - w * y) * s;
+		f[SCENE_WORLD_21][i] = 2.0f * (y * z + w * x) * s;
+		f[SCENE_WORLD_22][i] = (1.0f - 2.0f * (x * x + y * y)) * s;
+		f[SCENE_WORLD_23][i] = f[SCENE_POSITION_Z][i];
+		for (int row = 0; row < 3; row++)
+			f[SCENE_SPHERE_X + row][i] = f[SCENE_WORLD_00 + 4 * row][i] * f[SCENE_BOUNDS_X][i]
+				+ f[SCENE_WORLD_01 + 4 * row][i] * f[SCENE_BOUNDS_Y][i]
+				+ f[SCENE_WORLD_02 + 4 * row][i] * f[SCENE_BOUNDS_Z][i]
+				+ f[SCENE_WORLD_03 + 4 * row][i];
+		f[SCENE_SPHERE_RADIUS][i] = f[SCENE_BOUNDS_RADIUS][i] * std::fabs(s);
+	}
+}
+
+static size_t	cullScalar(float *const *f, uint8_t *flags, const SceneFrustum &frustum, size_t begin, size_t end, std::vector<uint32_t> *visible)
+{
+	size_t		count;
+	bool		inside;
+
+	count = 0;
+	for (size_t i = begin; i < end; i++)
+	{
+		inside = true;
+		for (const float *plane : frustum.planes)
+			inside &= (plane[0] * f[SCENE_SPHERE_X][i] + plane[1] * f[SCENE_SPHERE_Y][i] + plane[2] * f[SCENE_SPHERE_Z][i] + plane[3]
+				>= -f[SCENE_SPHERE_RADIUS][i]);
+		flags[i] = inside;
+		count += inside;
+		if (inside && visible)
+			visible->push_back((uint32_t)i);
+	}
+	return (count);
+}
+
+/*
+** Stores the visibility bits of width objects from i, returns how many are
+** set.
+*/
+static size_t	storeVisibility(unsigned mask, int width, uint8_t *flags, size_t i, std::vector<uint32_t> *visible)
+{
+	unsigned	bits;
+	size_t		count;
+	int			bit;
+
+	for (bit = 0; bit < width; bit++)
+		flags[i + bit] = (mask >> bit) & 1;
+	count = 0;
+	for (bits = mask; bits; bits &= bits - 1)
+	{
+		for (bit = 0; !(bits & (1u << bit)); bit++)
+			;
+		if (visible)
+			visible->push_back((uint32_t)(i + bit));
+		count++;
+	}
+	return (count);
+}
+
+static size_t	updateWorldSse(float *const *f, size_t begin, size_t end)
+{
+	const __m128	one = _mm_set1_ps(1.0f);
+	const __m128	two = _mm_set1_ps(2.0f);
+	const __m128	absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128			x, y, z, w, s;
+	__m128			m[3][4];
+	__m128			bounds[3];
+	size_t			i;
+
+	for (i = begin; i + 4 <= end; i += 4)
+	{
+		x = _mm_loadu_ps(f[SCENE_ROTATION_X] + i);
+		y = _mm_loadu_ps(f[SCENE_ROTATION_Y] + i);
+		z = _mm_loadu_ps(f[SCENE_ROTATION_Z] + i);
+		w = _mm_loadu_ps(f[SCENE_ROTATION_W] + i);
+		s = _mm_loadu_ps(f[SCENE_SCALE] + i);
+		m[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z)))), s);
+		m[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(x, y), _mm_mul_ps(w, z))), s);
+		m[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(x, z), _mm_mul_ps(w, y))), s);
+		m[0][3] = _mm_loadu_ps(f[SCENE_POSITION_X] + i);
+		m[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(x, y), _mm_mul_ps(w, z))), s);
+		m[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(z, z)))), s);
+		m[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(y, z), _mm_mul_ps(w, x))), s);
+		m[1][3] = _mm_loadu_ps(f[SCENE_POSITION_Y] + i);
+		m[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(x, z), _mm_mul_ps(w, y))), s);
+		m[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(y, z), _mm_mul_ps(w, x))), s);
+		m[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)))), s);
+		m[2][3] = _mm_loadu_ps(f[SCENE_POSITION_Z] + i);
+		for (int axis = 0; axis < 3; axis++)
+			bounds[axis] = _mm_loadu_ps(f[SCENE_BOUNDS_X + axis] + i);
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 4; column++)
+				_mm_storeu_ps(f[SCENE_WORLD_00 + 4 * row + column] + i, m[row][column]);
+			_mm_storeu_ps(f[SCENE_SPHERE_X + row] + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[row][0], bounds[0]), _mm_mul_ps(m[row][1], bounds[1])),
+				_mm_add_ps(_mm_mul_ps(m[row][2], bounds[2]), m[row][3])));
+		}
+		_mm_storeu_ps(f[SCENE_SPHERE_RADIUS] + i, _mm_mul_ps(_mm_loadu_ps(f[SCENE_BOUNDS_RADIUS] + i), _mm_and_ps(s, absMask)));
+	}
+	return (i);
+}
+
+static size_t	cullSse(float *const *f, uint8_t *flags, const SceneFrustum &frustum, size_t begin, size_t end, std::vector<uint32_t> *visible, size_t &count)
+{
+	__m128		center[3];
+	__m128		negativeRadius;
+	__m128		inside;
+	__m128		distance;
+	size_t		i;
+
+	for (i = begin; i + 4 <= end; i += 4)
+	{
+		for (int axis = 0; axis < 3; axis++)
+			center[axis] = _mm_loadu_ps(f[SCENE_SPHERE_X + axis] + i);
+		negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(f[SCENE_SPHERE_RADIUS] + i));
+		inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const float *plane : frustum.planes)
+		{
+			distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), center[0]), _mm_mul_ps(_mm_set1_ps(plane[1]), center[1])),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), center[2]), _mm_set1_ps(plane[3])));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+		count += storeVisibility((unsigned)_mm_movemask_ps(inside), 4, flags, i, visible);
+	}
+	return (i);
+}
+
+SCENE_TARGET_AVX2
+static size_t	updateWorldAvx2(float *const *f, size_t begin, size_t end)
+{
+	const __m256	two = _mm256_set1_ps(2.0f);
+	const __m256	absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256			x, y, z, w, s, s2;
+	__m256			m[3][4];
+	__m256			bounds[3];
+	__m256			sphere;
+	size_t			i;
+
+	for (i = begin; i + 8 <= end; i += 8)
+	{
+		x = _mm256_loadu_ps(f[SCENE_ROTATION_X] + i);
+		y = _mm256_loadu_ps(f[SCENE_ROTATION_Y] + i);
+		z = _mm256_loadu_ps(f[SCENE_ROTATION_Z] + i);
+		w = _mm256_loadu_ps(f[SCENE_ROTATION_W] + i);
+		s = _mm256_loadu_ps(f[SCENE_SCALE] + i);
+		s2 = _mm256_mul_ps(two, s);
+		m[0][0] = _mm256_fnmadd_ps(s2, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z)), s);
+		m[0][1] = _mm256_mul_ps(s2, _mm256_fmsub_ps(x, y, _mm256_mul_ps(w, z)));
+		m[0][2] = _mm256_mul_ps(s2, _mm256_fmadd_ps(x, z, _mm256_mul_ps(w, y)));
+		m[0][3] = _mm256_loadu_ps(f[SCENE_POSITION_X] + i);
+		m[1][0] = _mm256_mul_ps(s2, _mm256_fmadd_ps(x, y, _mm256_mul_ps(w, z)));
+		m[1][1] = _mm256_fnmadd_ps(s2, _mm256_fmadd_ps(x, x, _mm256_mul_ps(z, z)), s);
+		m[1][2] = _mm256_mul_ps(s2, _mm256_fmsub_ps(y, z, _mm256_mul_ps(w, x)));
+		m[1][3] = _mm256_loadu_ps(f[SCENE_POSITION_Y] + i);
+		m[2][0] = _mm256_mul_ps(s2, _mm256_fmsub_ps(x, z, _mm256_mul_ps(w, y)));
+		m[2][1] = _mm256_mul_ps(s2, _mm256_fmadd_ps(y, z, _mm256_mul_ps(w, x)));
+		m[2][2] = _mm256_fnmadd_ps(s2, _mm256_fmadd_ps(x, x, _mm256_mul_ps(y, y)), s);
+		m[2][3] = _mm256_loadu_ps(f[SCENE_POSITION_Z] + i);
+		for (int axis = 0; axis < 3; axis++)
+			bounds[axis] = _mm256_loadu_ps(f[SCENE_BOUNDS_X + axis] + i);
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 4; column++)
+				_mm256_storeu_ps(f[SCENE_WORLD_00 + 4 * row + column] + i, m[row][column]);
+			sphere = _mm256_fmadd_ps(m[row][0], bounds[0], m[row][3]);
+			sphere = _mm256_fmadd_ps(m[row][1], bounds[1], sphere);
+			sphere = _mm256_fmadd_ps(m[row][2], bounds[2], sphere);
+			_mm256_storeu_ps(f[SCENE_SPHERE_X + row] + i, sphere);
+		}
+		_mm256_storeu_ps(f[SCENE_SPHERE_RADIUS] + i, _mm256_mul_ps(_mm256_loadu_ps(f[SCENE_BOUNDS_RADIUS] + i), _mm256_and_ps(s, absMask)));
+	}
+	return (i);
+}
+
+SCENE_TARGET_AVX2
+static size_t	cullAvx2(float *const *f, uint8_t *flags, const SceneFrustum &frustum, size_t begin, size_t end, std::vector<uint32_t> *visible, size_t &count)
+{
+	__m256		center[3];
+	__m256		negativeRadius;
+	__m256		inside;
+	__m256		distance;
+	size_t		i;
+
+	for (i = begin; i + 8 <= end; i += 8)
+	{
+		for (int axis = 0; axis < 3; axis++)
+			center[axis] = _mm256_loadu_ps(f[SCENE_SPHERE_X + axis] + i);
+		negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(f[SCENE_SPHERE_RADIUS] + i));
+		inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const float *plane : frustum.planes)
+		{
+			distance = _mm256_fmadd_ps(_mm256_set1_ps(plane[0]), center[0], _mm256_set1_ps(plane[3]));
+			distance = _mm256_fmadd_ps(_mm256_set1_ps(plane[1]), center[1], distance);
+			distance = _mm256_fmadd_ps(_mm256_set1_ps(plane[2]), center[2], distance);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+		}
+		count += storeVisibility((unsigned)_mm256_movemask_ps(inside), 8, flags, i, visible);
+	}
+	return (i);
+}
+
+Scene::Scene() : fields(NULL), flags(NULL), count(0), stride(0), kernels(supportedSimd())
+{
+}
+
+template <typename T>
+static T	*alignStorage(std::vector<T> &storage)
+{
+	uintptr_t	address;
+
+	address = reinterpret_cast<uintptr_t>(storage.data());
+	return (reinterpret_cast<T *>((address + SCENE_ALIGNMENT - 1) & ~(uintptr_t)(SCENE_ALIGNMENT - 1)));
+}
+
+void	Scene::resize(size_t newCount)
+{
+	std::vector<float>		newStorage;
+	std::vector<uint8_t>	newFlagStorage;
+	float					*newFields;
+	uint8_t					*newFlags;
+	size_t					newStride;
+
+	newStride = (newCount + SCENE_CHUNK_OBJECTS - 1) / SCENE_CHUNK_OBJECTS * SCENE_CHUNK_OBJECTS;
+	if (newStride != stride)
+	{
+		// Strides of SCENE_CHUNK_OBJECTS floats (and flags) keep every array and chunk aligned
+		newStorage.assign(SCENE_FIELD_COUNT * newStride + SCENE_ALIGNMENT / sizeof(float), 0.0f);
+		newFlagStorage.assign(newStride + SCENE_ALIGNMENT, 0);
+		newFields = alignStorage(newStorage);
+		newFlags = alignStorage(newFlagStorage);
+		if (fields != NULL)
+		{
+			for (int i = 0; i < SCENE_FIELD_COUNT; i++)
+				memcpy(newFields + i * newStride, fields + i * stride, std::min(count, newCount) * sizeof(float));
+			memcpy(newFlags, flags, std::min(count, newCount));
+		}
+		storage.swap(newStorage);
+		flagStorage.swap(newFlagStorage);
+		fields = newFields;
+		flags = newFlags;
+		stride = newStride;
+	}
+	for (size_t i = count; i < newCount; i++)
+	{
+		setTransform(i, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), 1.0f);
+		setBounds(i, glm::vec3(0.0f), 0.0f);
+	}
+	count = newCount;
+}
+
+size_t	Scene::size() const
+{
+	return (count);
+}
+
+void	Scene::setTransform(size_t index, const glm::vec3 &position, const glm::quat &rotation, float scale)
+{
+	field(SCENE_POSITION_X)[index] = position.x;
+	field(SCENE_POSITION_Y)[index] = position.y;
+	field(SCENE_POSITION_Z)[index] = position.z;
+	field(SCENE_ROTATION_X)[index] = rotation.x;
+	field(SCENE_ROTATION_Y)[index] = rotation.y;
+	field(SCENE_ROTATION_Z)[index] = rotation.z;
+	field(SCENE_ROTATION_W)[index] = rotation.w;
+	field(SCENE_SCALE)[index] = scale;
+}
+
+void	Scene::setBounds(size_t index, const glm::vec3 &center, float radius)
+{
+	field(SCENE_BOUNDS_X)[index] = center.x;
+	field(SCENE_BOUNDS_Y)[index] = center.y;
+	field(SCENE_BOUNDS_Z)[index] = center.z;
+	field(SCENE_BOUNDS_RADIUS)[index] = radius;
+}
+
+float	*Scene::field(SceneField field)
+{
+	return (fields + field * stride);
+}
+
+const float	*Scene::field(SceneField field) const
+{
+	return (fields + field * stride);
+}
+
+const uint8_t	*Scene::visibility() const
+{
+	return (flags);
+}
+
+glm::mat4	Scene::worldMatrix(size_t index) const
+{
+	glm::mat4	world(1.0f);
+
+	for (int row = 0; row < 3; row++)
+		for (int column = 0; column < 4; column++)
+			world[column][row] = field((SceneField)(SCENE_WORLD_00 + 4 * row + column))[index];
+	return (world);
+}
+
+SceneSimd	Scene::supportedSimd()
+{
+#ifdef _MSC_VER
+	int			info[4];
+	bool		avx;
+
+	__cpuid(info, 1);
+	// AVX and FMA, with the ymm state saved by the OS (OSXSAVE + XCR0)
+	avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (info[2] & (1 << 12)) && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	if (avx && (info[1] & (1 << 5)))
+		return (SCENE_SIMD_AVX2);
+#else
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return (SCENE_SIMD_AVX2);
+#endif
+	return (SCENE_SIMD_SSE);
+}
+
+void	Scene::setSimd(SceneSimd simd)
+{
+	kernels = std::min(simd, supportedSimd());
+}
+
+SceneSimd	Scene::simd() const
+{
+	return (kernels);
+}
+
+void	Scene::chunkRange(size_t chunk, size_t chunkCount, size_t &begin, size_t &end) const
+{
+	size_t		blocks;
+
+	blocks = (count + SCENE_CHUNK_OBJECTS - 1) / SCENE_CHUNK_OBJECTS;
+	begin = std::min(count, blocks * chunk / chunkCount * SCENE_CHUNK_OBJECTS);
+	end = std::min(count, blocks * (chunk + 1) / chunkCount * SCENE_CHUNK_OBJECTS);
+}
+
+void	Scene::updateWorld(size_t begin, size_t end)
+{
+	float		*table[SCENE_FIELD_COUNT];
+
+	for (int i = 0; i < SCENE_FIELD_COUNT; i++)
+		table[i] = field((SceneField)i);
+	if (kernels == SCENE_SIMD_AVX2)
+		begin = updateWorldAvx2(table, begin, end);
+	else if (kernels == SCENE_SIMD_SSE)
+		begin = updateWorldSse(table, begin, end);
+	updateWorldScalar(table, begin, end);
+}
+
+size_t	Scene::cull(const SceneFrustum &frustum, size_t begin, size_t end, std::vector<uint32_t> *visible)
+{
+	float		*table[SCENE_FIELD_COUNT];
+	size_t		visibleCount;
+
+	for (int i = 0; i < SCENE_FIELD_COUNT; i++)
+		table[i] = field((SceneField)i);
+	visibleCount = 0;
+	if (kernels == SCENE_SIMD_AVX2)
+		begin = cullAvx2(table, flags, frustum, begin, end, visible, visibleCount);
+	else if (kernels == SCENE_SIMD_SSE)
+		begin = cullSse(table, flags, frustum, begin, end, visible, visibleCount);
+	return (visibleCount + cullScalar(table, flags, frustum, begin, end, visible));
+}
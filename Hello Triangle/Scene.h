@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+/*
+** Scene transforms and bounds in structure of arrays layout.
+**
+** Every per object value lives in its own float array (SceneField), so the
+** batch kernels load 4 (SSE) or 8 (AVX2) objects per instruction without
+** any gather: updateWorld() composes the world matrices (translation *
+** rotation * uniform scale, stored as 3x4 rows) and the world bounding
+** spheres, cull() tests the spheres against a frustum and writes one
+** visibility flag per object.
+**
+** The arrays are 64 byte (cache line) aligned and chunkRange() cuts the
+** scene on SCENE_CHUNK_OBJECTS boundaries: threads working on different
+** chunks never write to the same cache line, even in the byte sized
+** visibility flags.
+** Different chunks can be updated and culled concurrently.
+*/
+
+#define SCENE_CHUNK_OBJECTS		64
+
+enum					SceneField
+{
+	SCENE_POSITION_X,
+	SCENE_POSITION_Y,
+	SCENE_POSITION_Z,
+	SCENE_ROTATION_X,
+	SCENE_ROTATION_Y,
+	SCENE_ROTATION_Z,
+	SCENE_ROTATION_W,
+	SCENE_SCALE,
+	// Local bounding sphere
+	SCENE_BOUNDS_X,
+	SCENE_BOUNDS_Y,
+	SCENE_BOUNDS_Z,
+	SCENE_BOUNDS_RADIUS,
+	// World matrix, row major 3x4 (the last row is 0 0 0 1)
+	SCENE_WORLD_00, SCENE_WORLD_01, SCENE_WORLD_02, SCENE_WORLD_03,
+	SCENE_WORLD_10, SCENE_WORLD_11, SCENE_WORLD_12, SCENE_WORLD_13,
+	SCENE_WORLD_20, SCENE_WORLD_21, SCENE_WORLD_22, SCENE_WORLD_23,
+	// World bounding sphere
+	SCENE_SPHERE_X,
+	SCENE_SPHERE_Y,
+	SCENE_SPHERE_Z,
+	SCENE_SPHERE_RADIUS,
+	SCENE_FIELD_COUNT
+};
+
+enum					SceneSimd
+{
+	SCENE_SIMD_SCALAR,
+	SCENE_SIMD_SSE,
+	SCENE_SIMD_AVX2
+};
+
+/*
+** Normalized planes (xyz . p + w >= 0 inside) of a Vulkan clip volume:
+** -w <= x, y <= w and 0 <= z <= w.
+*/
+struct					SceneFrustum
+{
+	float				planes[6][4];
+};
+
+SceneFrustum			sceneFrustum(const glm::mat4 &viewProjection);
+const char				*sceneSimdName(SceneSimd simd);
+
+class Scene
+{
+public:
+	Scene();
+
+	/*
+	** New objects get an identity transform and empty bounds.
+	*/
+	void				resize(size_t count);
+	size_t				size() const;
+
+	void				setTransform(size_t index, const glm::vec3 &position, const glm::quat &rotation, float scale);
+	void				setBounds(size_t index, const glm::vec3 &center, float radius);
+
+	float				*field(SceneField field);
+	const float			*field(SceneField field) const;
+	const uint8_t		*visibility() const;
+	glm::mat4			worldMatrix(size_t index) const;
+
+	/*
+	** Kernels used by updateWorld() and cull(): the best one of the CPU by
+	** default, setSimd() is clamped to what the CPU supports.
+	*/
+	static SceneSimd	supportedSimd();
+	void				setSimd(SceneSimd simd);
+	SceneSimd			simd() const;
+
+	/*
+	** Objects [begin, end) of chunk out of chunkCount, on SCENE_CHUNK_OBJECTS
+	** boundaries (the last chunk takes the rest).
+	*/
+	void				chunkRange(size_t chunk, size_t chunkCount, size_t &begin, size_t &end) const;
+
+	void				updateWorld(size_t begin, size_t end);
+	/*
+	** Returns the number of visible objects in [begin, end) and appends their
+	** indices to visible when not NULL.
+	*/
+	size_t				cull(const SceneFrustum &frustum, size_t begin, size_t end, std::vector<uint32_t> *visible = NULL);
+
+private:
+	std::vector<float>		storage;
+	std::vector<uint8_t>	flagStorage;
+	float					*fields;
+	uint8_t					*flags;
+	size_t					count;
+	size_t					stride;
+	SceneSimd				kernels;
+
+	Scene(const Scene &);
+	Scene					&operator=(const Scene &);
+};
@@ -1,3 +1,6 @@
-C:\VulkanSDK\1.0.51.0\Bin\glslangValidator.exe -V ..\shader.vert
-C:\VulkanSDK\1.0.51.0\Bin\glslangValidator.exe -V ..\shader.frag
+%VULKAN_SDK%\Bin\glslangValidator.exe -V ..\shader.vert
+%VULKAN_SDK%\Bin\glslangValidator.exe -V ..\shader.frag
+%VULKAN_SDK%\Bin\glslangValidator.exe -V ..\mesh.vert -o mesh_vert.spv
+%VULKAN_SDK%\Bin\glslangValidator.exe -V ..\post.vert -o post_vert.spv
+%VULKAN_SDK%\Bin\glslangValidator.exe -V ..\post.frag -o post_frag.spv
 PAUSE
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/*
+** Typed specialization constants.
+**
+** A constant block is a plain struct whose members mirror the
+** "layout(constant_id = N) const" declarations of the shaders. Its layout is
+** declared once with SPECIALIZATION_LAYOUT, which builds the
+** VkSpecializationMapEntry table at compile time, and SpecializationInfo<T>
+** turns a value of that struct into the VkSpecializationInfo a shader stage
+** expects:
+**
+**	SPECIALIZATION_LAYOUT(MyConstants,
+**		SPECIALIZATION_CONSTANT(MyConstants, 0, scale),
+**		SPECIALIZATION_CONSTANT(MyConstants, 1, mode)
+**	)
+**
+**	SpecializationInfo<MyConstants>	spec(constants);
+**	stageInfo.pSpecializationInfo = spec.get();
+*/
+
+template <typename T>
+struct SpecializationLayout;
+
+/*
+** SPIR-V specialization constants can only be booleans, 32 bit integers,
+** floats or doubles: anything else is rejected at compile time.
+*/
+template <typename M>
+constexpr size_t	specializationConstantSize()
+{
+	static_assert(std::is_same<M, VkBool32>::value || std::is_same<M, int32_t>::value
+		|| std::is_same<M, float>::value || std::is_same<M, double>::value,
+		"Specialization constants must be VkBool32, int32_t, uint32_t, float or double");
+	return (sizeof(M));
+}
+
+#define SPECIALIZATION_CONSTANT(type, id, member) \
+	{ (id), static_cast<uint32_t>(offsetof(type, member)), specializationConstantSize<decltype(type::member)>() }
+
+#define SPECIALIZATION_LAYOUT(type, ...) \
+	template <> \
+	struct SpecializationLayout<type> \
+	{ \
+		static_assert(std::is_standard_layout<type>::value, #type " must be a standard layout struct"); \
+		static const VkSpecializationMapEntry	*entries(uint32_t *count) \
+		{ \
+			static const VkSpecializationMapEntry	table[] = { __VA_ARGS__ }; \
+			*count = static_cast<uint32_t>(sizeof(table) / sizeof(table[0])); \
+			return (table); \
+		} \
+	};
+
+template <typename T>
+class SpecializationInfo
+{
+public:
+	SpecializationInfo(const T &constants = T()) : data(constants)
+	{
+		info.pMapEntries = SpecializationLayout<T>::entries(&info.mapEntryCount);
+		info.dataSize = sizeof(T);
+		info.pData = &data;
+	}
+
+	/*
+	** The returned pointer refers to this object: keep it alive until the
+	** pipeline using it has been created.
+	*/
+	const VkSpecializationInfo	*get() const
+	{
+		return (&info);
+	}
+
+	const T						&constants() const
+	{
+		return (data);
+	}
+
+private:
+	T						data;
+	VkSpecializationInfo	info;
+
+	SpecializationInfo(const SpecializationInfo &);
+	SpecializationInfo		&operator=(const SpecializationInfo &);
+};
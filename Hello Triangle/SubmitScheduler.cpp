@@ -0,0 +1,246 @@
+#include <stdexcept>
+
+#include "SubmitScheduler.h"
+
+void	SubmitBatch::clear()
+{
+	commandBuffers.clear();
+	waits.clear();
+	waitStages.clear();
+	binaryWaits.clear();
+	binaryWaitStages.clear();
+	binarySignals.clear();
+}
+
+void	SubmitBatch::wait(SubmitPoint point, VkPipelineStageFlags stage)
+{
+	if (point.value == 0)
+		return;
+	waits.push_back(point);
+	waitStages.push_back(stage);
+}
+
+SubmitScheduler::SubmitScheduler()
+	: device(VK_NULL_HANDLE), allocator(NULL), waitTimelines(NULL), getCounterValue(NULL)
+{
+	resetStats();
+}
+
+void	SubmitScheduler::create(VkDevice device, const VkAllocationCallbacks *allocator)
+{
+	this->device = device;
+	this->allocator = allocator;
+	waitTimelines = (PFN_vkWaitSemaphores)vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+	getCounterValue = (PFN_vkGetSemaphoreCounterValue)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+	if (waitTimelines == NULL || getCounterValue == NULL)
+		throw std::runtime_error("Failed to load the timeline semaphore functions!");
+}
+
+void	SubmitScheduler::destroy()
+{
+	for (Timeline &timeline : timelines)
+		vkDestroySemaphore(device, timeline.semaphore, allocator);
+	timelines.clear();
+}
+
+uint32_t	SubmitScheduler::addQueue(VkQueue queue)
+{
+	std::lock_guard<std::mutex>		lock(mutex);
+	VkSemaphoreTypeCreateInfo		typeInfo = {};
+	VkSemaphoreCreateInfo			semaphoreInfo = {};
+	Timeline						timeline;
+
+	for (uint32_t i = 0; i < timelines.size(); i++)
+		if (timelines[i].queue == queue)
+			return (i);
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+	if (vkCreateSemaphore(device, &semaphoreInfo, allocator, &timeline.semaphore) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create timeline semaphore!");
+	timeline.queue = queue;
+	timeline.enqueued = 0;
+	timeline.submitted = 0;
+	timeline.completed = 0;
+	timelines.push_back(timeline);
+	return ((uint32_t)timelines.size() - 1);
+}
+
+VkSemaphore		SubmitScheduler::semaphore(uint32_t queue) const
+{
+	return (timelines[queue].semaphore);
+}
+
+SubmitPoint		SubmitScheduler::enqueue(uint32_t queue, const SubmitBatch &batch)
+{
+	std::lock_guard<std::mutex>		lock(mutex);
+	Timeline						&timeline = timelines[queue];
+	SubmitPoint						point;
+
+	timeline.pending.push_back(batch);
+	counters.batches++;
+	point.queue = queue;
+	point.value = ++timeline.enqueued;
+	return (point);
+}
+
+void	SubmitScheduler::flush()
+{
+	std::lock_guard<std::mutex>		lock(mutex);
+
+	flushLocked();
+}
+
+/*
+** The arrays are sized for the whole flush before any VkSubmitInfo points
+** into them. A batch signals its queue's timeline after its own binary
+** semaphores; the values of the binary semaphores are ignored.
+*/
+void	SubmitScheduler::flushLocked()
+{
+	size_t		waitCount;
+	size_t		signalCount;
+	size_t		firstWait;
+	size_t		firstSignal;
+	uint64_t	value;
+
+	for (Timeline &timeline : timelines)
+	{
+		if (timeline.pending.empty())
+			continue;
+		waitCount = 0;
+		signalCount = 0;
+		for (const SubmitBatch &batch : timeline.pending)
+		{
+			waitCount += batch.binaryWaits.size() + batch.waits.size();
+			signalCount += batch.binarySignals.size() + 1;
+		}
+		submits.resize(timeline.pending.size());
+		timelineInfos.resize(timeline.pending.size());
+		waitSemaphores.clear();
+		waitValues.clear();
+		waitStages.clear();
+		signalSemaphores.clear();
+		signalValues.clear();
+		waitSemaphores.reserve(waitCount);
+		waitValues.reserve(waitCount);
+		waitStages.reserve(waitCount);
+		signalSemaphores.reserve(signalCount);
+		signalValues.reserve(signalCount);
+
+		value = timeline.submitted;
+		for (size_t i = 0; i < timeline.pending.size(); i++)
+		{
+			const SubmitBatch	&batch = timeline.pending[i];
+
+			firstWait = waitSemaphores.size();
+			for (size_t j = 0; j < batch.binaryWaits.size(); j++)
+			{
+				waitSemaphores.push_back(batch.binaryWaits[j]);
+				waitValues.push_back(0);
+				waitStages.push_back(batch.binaryWaitStages[j]);
+			}
+			for (size_t j = 0; j < batch.waits.size(); j++)
+			{
+				waitSemaphores.push_back(timelines[batch.waits[j].queue].semaphore);
+				waitValues.push_back(batch.waits[j].value);
+				waitStages.push_back(batch.waitStages[j]);
+			}
+			firstSignal = signalSemaphores.size();
+			for (VkSemaphore semaphore : batch.binarySignals)
+			{
+				signalSemaphores.push_back(semaphore);
+				signalValues.push_back(0);
+			}
+			signalSemaphores.push_back(timeline.semaphore);
+			signalValues.push_back(++value);
+
+			timelineInfos[i] = {};
+			timelineInfos[i].sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			timelineInfos[i].waitSemaphoreValueCount = (uint32_t)(waitSemaphores.size() - firstWait);
+			timelineInfos[i].pWaitSemaphoreValues = waitValues.data() + firstWait;
+			timelineInfos[i].signalSemaphoreValueCount = (uint32_t)(signalSemaphores.size() - firstSignal);
+			timelineInfos[i].pSignalSemaphoreValues = signalValues.data() + firstSignal;
+			submits[i] = {};
+			submits[i].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submits[i].pNext = &timelineInfos[i];
+			submits[i].waitSemaphoreCount = timelineInfos[i].waitSemaphoreValueCount;
+			submits[i].pWaitSemaphores = waitSemaphores.data() + firstWait;
+			submits[i].pWaitDstStageMask = waitStages.data() + firstWait;
+			submits[i].commandBufferCount = (uint32_t)batch.commandBuffers.size();
+			submits[i].pCommandBuffers = batch.commandBuffers.data();
+			submits[i].signalSemaphoreCount = timelineInfos[i].signalSemaphoreValueCount;
+			submits[i].pSignalSemaphores = signalSemaphores.data() + firstSignal;
+		}
+		if (vkQueueSubmit(timeline.queue, (uint32_t)submits.size(), submits.data(), VK_NULL_HANDLE) != VK_SUCCESS)
+			throw std::runtime_error("Failed to submit command buffers!");
+		counters.submits++;
+		timeline.submitted = value;
+		timeline.pending.clear();
+	}
+}
+
+void	SubmitScheduler::wait(SubmitPoint point)
+{
+	std::unique_lock<std::mutex>	lock(mutex);
+	VkSemaphoreWaitInfo				waitInfo = {};
+	VkSemaphore						semaphore;
+
+	if (reachedLocked(point))
+		return;
+	if (point.value > timelines[point.queue].submitted)
+		flushLocked();
+	semaphore = timelines[point.queue].semaphore;
+	counters.cpuWaits++;
+	lock.unlock();
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &semaphore;
+	waitInfo.pValues = &point.value;
+	if (waitTimelines(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+		throw std::runtime_error("Failed to wait for timeline semaphore!");
+	lock.lock();
+	if (timelines[point.queue].completed < point.value)
+		timelines[point.queue].completed = point.value;
+}
+
+bool	SubmitScheduler::reached(SubmitPoint point)
+{
+	std::lock_guard<std::mutex>		lock(mutex);
+
+	return (reachedLocked(point));
+}
+
+/*
+** Asks the driver only when the last value read is too old.
+*/
+bool	SubmitScheduler::reachedLocked(SubmitPoint point)
+{
+	Timeline	&timeline = timelines[point.queue];
+	uint64_t	value;
+
+	if (point.value <= timeline.completed)
+		return (true);
+	if (getCounterValue(device, timeline.semaphore, &value) != VK_SUCCESS)
+		throw std::runtime_error("Failed to read timeline semaphore!");
+	timeline.completed = value;
+	return (point.value <= value);
+}
+
+SubmitStats		SubmitScheduler::stats()
+{
+	std::lock_guard<std::mutex>		lock(mutex);
+
+	return (counters);
+}
+
+void	SubmitScheduler::resetStats()
+{
+	std::lock_guard<std::mutex>		lock(mutex);
+
+	counters.batches = 0;
+	counters.submits = 0;
+	counters.cpuWaits = 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+/*
+** Queue submissions ordered by timeline semaphores (VK_KHR_timeline_semaphore,
+** core in Vulkan 1.2): one semaphore per queue, its value counts the batches
+** the queue has completed. A batch is named by its SubmitPoint, the value
+** its queue signals once it is done. Another batch waits for it on the GPU,
+** the CPU waits for it before reusing what the batch reads: no fence, no
+** semaphore per dependency, no vkQueueWaitIdle.
+**
+** Batches are queued and go to the GPU with flush(), one vkQueueSubmit per
+** queue for all of its pending batches. Binary semaphores are only taken for
+** the swapchain: acquire and present can't use timelines.
+*/
+
+struct					SubmitPoint
+{
+	uint32_t			queue;
+	uint64_t			value;			// 0: nothing to wait for
+};
+
+struct									SubmitBatch
+{
+	std::vector<VkCommandBuffer>		commandBuffers;
+	std::vector<SubmitPoint>			waits;
+	std::vector<VkPipelineStageFlags>	waitStages;
+	std::vector<VkSemaphore>			binaryWaits;		// swapchain acquires
+	std::vector<VkPipelineStageFlags>	binaryWaitStages;
+	std::vector<VkSemaphore>			binarySignals;		// waited by the present
+
+	void	clear();
+	void	wait(SubmitPoint point, VkPipelineStageFlags stage);
+};
+
+struct					SubmitStats
+{
+	uint64_t			batches;
+	uint64_t			submits;		// vkQueueSubmit calls
+	uint64_t			cpuWaits;		// waits that blocked
+};
+
+class SubmitScheduler
+{
+public:
+	SubmitScheduler();
+
+	/*
+	** Loads the timeline entry points of device, which must have
+	** VK_KHR_timeline_semaphore enabled. Throws a runtime_error without them.
+	*/
+	void				create(VkDevice device, const VkAllocationCallbacks *allocator);
+	void				destroy();
+
+	/*
+	** The timeline of queue, created on its first call: a queue added again
+	** (transfers without a queue of their own) keeps the one it has.
+	*/
+	uint32_t			addQueue(VkQueue queue);
+	VkSemaphore			semaphore(uint32_t queue) const;
+
+	SubmitPoint			enqueue(uint32_t queue, const SubmitBatch &batch);
+	void				flush();
+	/*
+	** Blocks until point is reached, flushing it first when it is pending.
+	*/
+	void				wait(SubmitPoint point);
+	bool				reached(SubmitPoint point);
+
+	SubmitStats			stats();
+	void				resetStats();
+
+private:
+	struct						Timeline
+	{
+		VkQueue					queue;
+		VkSemaphore				semaphore;
+		uint64_t				enqueued;
+		uint64_t				submitted;
+		uint64_t				completed;
+		std::vector<SubmitBatch>	pending;
+	};
+
+	std::mutex					mutex;
+	VkDevice					device;
+	const VkAllocationCallbacks	*allocator;
+	PFN_vkWaitSemaphores		waitTimelines;
+	PFN_vkGetSemaphoreCounterValue	getCounterValue;
+	std::vector<Timeline>		timelines;
+	SubmitStats					counters;
+
+	//Arrays of the VkSubmitInfos of one flush
+	std::vector<VkSubmitInfo>	submits;
+	std::vector<VkTimelineSemaphoreSubmitInfo>	timelineInfos;
+	std::vector<VkSemaphore>	waitSemaphores;
+	std::vector<uint64_t>		waitValues;
+	std::vector<VkPipelineStageFlags>	waitStages;
+	std::vector<VkSemaphore>	signalSemaphores;
+	std::vector<uint64_t>		signalValues;
+
+	void				flushLocked();
+	bool				reachedLocked(SubmitPoint point);
+
+	SubmitScheduler(const SubmitScheduler &);
+	SubmitScheduler		&operator=(const SubmitScheduler &);
+};
@@ -0,0 +1,550 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "Trace.h"
+
+/*
+** Handles of the create infos as trace ids: pointers on 64 bit builds,
+** uint64_t (the non-dispatchable ones) on 32 bit builds.
+*/
+static uint64_t		handleId(uint64_t handle)
+{
+	return (handle);
+}
+
+template <typename T>
+static uint64_t		handleId(T *handle)
+{
+	return ((uint64_t)(uintptr_t)handle);
+}
+
+template <typename T>
+static void		putArray(TraceStream &stream, uint32_t count, const T *values)
+{
+	stream.put(count);
+	if (count)
+		stream.bytes(values, count * sizeof(T));
+}
+
+void	TraceStream::bytes(const void *data, size_t size)
+{
+	buffer.insert(buffer.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+}
+
+void	TraceStream::append(const TraceStream &other)
+{
+	buffer.insert(buffer.end(), other.buffer.begin(), other.buffer.end());
+}
+
+void	TraceStream::clear()
+{
+	buffer.clear();
+}
+
+const uint8_t	*TraceStream::data() const
+{
+	return (buffer.data());
+}
+
+size_t	TraceStream::size() const
+{
+	return (buffer.size());
+}
+
+TraceCursor::TraceCursor(const uint8_t *data, size_t size) : current(data), end(data + size)
+{
+}
+
+void	TraceCursor::bytes(void *data, size_t size)
+{
+	memcpy(data, skip(size), size);
+}
+
+const uint8_t	*TraceCursor::skip(size_t size)
+{
+	const uint8_t	*data;
+
+	if ((size_t)(end - current) < size)
+		throw std::runtime_error("Truncated trace record!");
+	data = current;
+	current += size;
+	return (data);
+}
+
+bool	TraceCursor::atEnd() const
+{
+	return (current == end);
+}
+
+void	TraceCommands::beginRenderPass(const VkRenderPassBeginInfo &beginInfo)
+{
+	commands.put((uint8_t)TRACE_CMD_BEGIN_RENDER_PASS);
+	commands.put(handleId(beginInfo.renderPass));
+	commands.put(handleId(beginInfo.framebuffer));
+	commands.put(beginInfo.renderArea);
+	putArray(commands, beginInfo.clearValueCount, beginInfo.pClearValues);
+}
+
+void	TraceCommands::nextSubpass()
+{
+	commands.put((uint8_t)TRACE_CMD_NEXT_SUBPASS);
+}
+
+void	TraceCommands::endRenderPass()
+{
+	commands.put((uint8_t)TRACE_CMD_END_RENDER_PASS);
+}
+
+void	TraceCommands::bindPipeline(uint64_t pipeline)
+{
+	commands.put((uint8_t)TRACE_CMD_BIND_PIPELINE);
+	commands.put(pipeline);
+}
+
+void	TraceCommands::bindDescriptorSet(uint64_t layout, uint64_t set)
+{
+	commands.put((uint8_t)TRACE_CMD_BIND_DESCRIPTOR_SET);
+	commands.put(layout);
+	commands.put(set);
+}
+
+void	TraceCommands::bindVertexBuffer(uint64_t buffer, VkDeviceSize offset)
+{
+	commands.put((uint8_t)TRACE_CMD_BIND_VERTEX_BUFFER);
+	commands.put(buffer);
+	commands.put(offset);
+}
+
+void	TraceCommands::bindIndexBuffer(uint64_t buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+	commands.put((uint8_t)TRACE_CMD_BIND_INDEX_BUFFER);
+	commands.put(buffer);
+	commands.put(offset);
+	commands.put(indexType);
+}
+
+void	TraceCommands::setViewport(const VkViewport &viewport)
+{
+	commands.put((uint8_t)TRACE_CMD_SET_VIEWPORT);
+	commands.put(viewport);
+}
+
+void	TraceCommands::setScissor(const VkRect2D &scissor)
+{
+	commands.put((uint8_t)TRACE_CMD_SET_SCISSOR);
+	commands.put(scissor);
+}
+
+void	TraceCommands::pushConstants(uint64_t layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void *values)
+{
+	commands.put((uint8_t)TRACE_CMD_PUSH_CONSTANTS);
+	commands.put(layout);
+	commands.put(stages);
+	commands.put(offset);
+	commands.put(size);
+	commands.bytes(values, size);
+}
+
+void	TraceCommands::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+	commands.put((uint8_t)TRACE_CMD_DRAW);
+	commands.put(vertexCount);
+	commands.put(instanceCount);
+	commands.put(firstVertex);
+	commands.put(firstInstance);
+}
+
+void	TraceCommands::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+	commands.put((uint8_t)TRACE_CMD_DRAW_INDEXED);
+	commands.put(indexCount);
+	commands.put(instanceCount);
+	commands.put(firstIndex);
+	commands.put(vertexOffset);
+	commands.put(firstInstance);
+}
+
+void	TraceCommands::execute(const TraceCommands &secondary)
+{
+	commands.append(secondary.commands);
+}
+
+void	TraceCommands::clear()
+{
+	commands.clear();
+}
+
+const TraceStream	&TraceCommands::stream() const
+{
+	return (commands);
+}
+
+TraceWriter::TraceWriter() : active(false), frameCount(0), written(0)
+{
+}
+
+void	TraceWriter::open(const std::string &path, const VkPhysicalDeviceProperties &device)
+{
+	TraceFileHeader		header;
+
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open " + path + " for writing!");
+	memset(&header, 0, sizeof(header));
+	header.magic = TRACE_FILE_MAGIC;
+	header.version = TRACE_FILE_VERSION;
+	header.vendorID = device.vendorID;
+	header.deviceID = device.deviceID;
+	header.driverVersion = device.driverVersion;
+	memcpy(header.deviceName, device.deviceName, sizeof(header.deviceName));
+	file.write((const char *)&header, sizeof(header));
+	frameCount = 0;
+	written = sizeof(header);
+	active = true;
+}
+
+bool	TraceWriter::close()
+{
+	std::lock_guard<std::mutex>	lock(mutex);
+	bool						good;
+
+	if (!active)
+		return (false);
+	active = false;
+	good = file.good();
+	file.close();
+	return (good);
+}
+
+bool	TraceWriter::capturing() const
+{
+	return (active.load(std::memory_order_relaxed));
+}
+
+uint64_t	TraceWriter::frames() const
+{
+	return (frameCount);
+}
+
+uint64_t	TraceWriter::bytesWritten() const
+{
+	return (written);
+}
+
+void	TraceWriter::write(TraceRecordType type, const TraceStream &record)
+{
+	std::lock_guard<std::mutex>	lock(mutex);
+	TraceRecordHeader			header;
+
+	if (!active)
+		return;
+	header.type = type;
+	header.size = (uint32_t)record.size();
+	file.write((const char *)&header, sizeof(header));
+	file.write((const char *)record.data(), record.size());
+	written += sizeof(header) + record.size();
+}
+
+void	TraceWriter::shader(uint64_t id, const VkShaderModuleCreateInfo &createInfo)
+{
+	TraceStream		record;
+
+	if (!capturing())
+		return;
+	record.put(id);
+	record.put((uint64_t)createInfo.codeSize);
+	record.bytes(createInfo.pCode, createInfo.codeSize);
+	write(TRACE_SHADER, record);
+}
+
+void	TraceWriter::buffer(uint64_t id, VkDeviceSize size, VkBufferUsageFlags usage, const void *contents, VkDeviceSize contentsSize)
+{
+	TraceStream		record;
+
+	if (!capturing())
+		return;
+	record.put(id);
+	record.put(size);
+	record.put(usage);
+	record.put(contents ? contentsSize : 0);
+	if (contents)
+		record.bytes(contents, (size_t)contentsSize);
+	write(TRACE_BUFFER, record);
+}
+
+void	TraceWriter::image(uint64_t id, const VkImageCreateInfo &createInfo)
+{
+	TraceStream		record;
+
+	if (!capturing())
+		return;
+	record.put(id);
+	record.put(createInfo.imageType);
+	record.put(createInfo.format);
+	record.put(createInfo.extent);
+	record.put(createInfo.mipLevels);
+	record.put(createInfo.arrayLayers);
+	record.put(createInfo.samples);
+	record.put(createInfo.tiling);
+	record.put(createInfo.usage);
+	write(TRACE_IMAGE, record);
+}
+
+void	TraceWriter::imageView(uint64_t id, const VkImageViewCreateInfo &createInfo)
+{
+	TraceStream		record;
+
+	if (!capturing())
+		return;
+	record.put(id);
+	record.put(handleId(createInfo.image));
+	record.put(createInfo.viewType);
+	record.put(createInfo.format);
+	record.put(createInfo.components);
+	record.put(createInfo.subresourceRange);
+	write(TRACE_IMAGE_VIEW, record);
+}
+
+void	TraceWriter::renderPass(uint64_t id, const VkRenderPassCreateInfo &createInfo)
+{
+	TraceStream		record;
+
+	if (!capturing())
+		return;
+	record.put(id);
+	putArray(record, createInfo.attachmentCount, createInfo.pAttachments);
+	record.put(createInfo.subpassCount);
+	for (uint32_t i = 0; i < createInfo.subpassCount; i++)
+	{
+		const VkSubpassDescription	&subpass = createInfo.pSubpasses[i];
+
+		putArray(record, subpass.inputAttachmentCount, subpass.pInputAttachments);
+		putArray(record, subpass.colorAttachmentCount, subpass.pColorAttachments);
+		putArray(record, subpass.pResolveAttachments ? subpass.colorAttachmentCount : 0, subpass.pResolveAttachments);
+		putArray(record, subpass.pDepthStencilAttachment ? 1 : 0, subpass.pDepthStencilAttachment);
+		putArray(record, subpass.preserveAttachmentCount, subpass.pPreserveAttachments);
+	}
+	putArray(record, createInfo.dependencyCount, createInfo.pDependencies);
+	write(TRACE_RENDER_PASS, record);
+}
+
+void	TraceWriter::framebuffer(uint64_t id, const VkFramebufferCreateInfo &createInfo)
+{
+	TraceStream		record;
+
+	if (!capturing())
+		return;
+	record.put(id);
+	record.put(handleId(createInfo.renderPass));
+	record.put(createInfo.width);
+	record.put(createInfo.height);
+	record.put(createInfo.layers);
+	record.put(createInfo.attachmentCount);
+	for (uint32_t i = 0; i < createInfo.attachmentCount; i++)
+		record.put(handleId(createInfo.pAttachments[i]));
+	write(TRACE_FRAMEBUFFER, record);
+}
+
+void	TraceWriter::setLayout(uint64_t id, const VkDescriptorSetLayoutCreateInfo &createInfo)
+{
+	TraceStream		record;
+
+	if (!capturing())
+		return;
+	record.put(id);
+	record.put(createInfo.bindingCount);
+	for (uint32_t i = 0; i < createInfo.bindingCount; i++)
+	{
+		const VkDescriptorSetLayoutBinding	&binding = createInfo.pBindings[i];
+
+		if (binding.pImmutableSamplers)
+			throw std::runtime_error("Immutable samplers can't be traced!");
+		record.put(binding.binding);
+		record.put(binding.descriptorType);
+		record.put(binding.descriptorCount);
+		record.put(binding.stageFlags);
+	}
+	write(TRACE_SET_LAYOUT, record);
+}
+
+void	TraceWriter::pipelineLayout(uint64_t id, const VkPipelineLayoutCreateInfo &createInfo)
+{
+	TraceStream		record;
+
+	if (!capturing())
+		return;
+	record.put(id);
+	record.put(createInfo.setLayoutCount);
+	for (uint32_t i = 0; i < createInfo.setLayoutCount; i++)
+		record.put(handleId(createInfo.pSetLayouts[i]));
+	putArray(record, createInfo.pushConstantRangeCount, createInfo.pPushConstantRanges);
+	write(TRACE_PIPELINE_LAYOUT, record);
+}
+
+/*
+** The state is written in the order of VkGraphicsPipelineCreateInfo, the
+** viewports and scissors only when they are not dynamic.
+*/
+void	TraceWriter::pipeline(uint64_t id, const VkGraphicsPipelineCreateInfo &createInfo)
+{
+	const VkPipelineViewportStateCreateInfo		&viewportState = *createInfo.pViewportState;
+	const VkPipelineRasterizationStateCreateInfo	&rasterizer = *createInfo.pRasterizationState;
+	const VkPipelineMultisampleStateCreateInfo	&multisampling = *createInfo.pMultisampleState;
+	const VkPipelineColorBlendStateCreateInfo	&colorBlending = *createInfo.pColorBlendState;
+	TraceStream									record;
+	uint32_t									nameLength;
+
+	if (!capturing())
+		return;
+	if (createInfo.pDepthStencilState || createInfo.pTessellationState)
+		throw std::runtime_error("Depth, stencil and tessellation states can't be traced!");
+	record.put(id);
+	record.put(handleId(createInfo.layout));
+	record.put(handleId(createInfo.renderPass));
+	record.put(createInfo.subpass);
+	record.put(createInfo.stageCount);
+	for (uint32_t i = 0; i < createInfo.stageCount; i++)
+	{
+		const VkPipelineShaderStageCreateInfo	&stage = createInfo.pStages[i];
+		const VkSpecializationInfo				*specialization = stage.pSpecializationInfo;
+
+		record.put(stage.stage);
+		record.put(handleId(stage.module));
+		nameLength = (uint32_t)strlen(stage.pName);
+		putArray(record, nameLength, stage.pName);
+		record.put(specialization ? specialization->mapEntryCount : 0u);
+		for (uint32_t entry = 0; specialization && entry < specialization->mapEntryCount; entry++)
+		{
+			record.put(specialization->pMapEntries[entry].constantID);
+			record.put(specialization->pMapEntries[entry].offset);
+			record.put((uint32_t)specialization->pMapEntries[entry].size);
+		}
+		putArray(record, specialization ? (uint32_t)specialization->dataSize : 0u, specialization ? (const uint8_t *)specialization->pData : NULL);
+	}
+	putArray(record, createInfo.pVertexInputState->vertexBindingDescriptionCount, createInfo.pVertexInputState->pVertexBindingDescriptions);
+	putArray(record, createInfo.pVertexInputState->vertexAttributeDescriptionCount, createInfo.pVertexInputState->pVertexAttributeDescriptions);
+	record.put(createInfo.pInputAssemblyState->topology);
+	record.put(createInfo.pInputAssemblyState->primitiveRestartEnable);
+	record.put(viewportState.viewportCount);
+	record.put(viewportState.scissorCount);
+	putArray(record, viewportState.pViewports ? viewportState.viewportCount : 0, viewportState.pViewports);
+	putArray(record, viewportState.pScissors ? viewportState.scissorCount : 0, viewportState.pScissors);
+	record.put(rasterizer.depthClampEnable);
+	record.put(rasterizer.rasterizerDiscardEnable);
+	record.put(rasterizer.polygonMode);
+	record.put(rasterizer.cullMode);
+	record.put(rasterizer.frontFace);
+	record.put(rasterizer.lineWidth);
+	record.put(multisampling.rasterizationSamples);
+	record.put(multisampling.sampleShadingEnable);
+	record.put(multisampling.minSampleShading);
+	record.put(multisampling.alphaToCoverageEnable);
+	record.put(colorBlending.logicOpEnable);
+	record.put(colorBlending.logicOp);
+	putArray(record, colorBlending.attachmentCount, colorBlending.pAttachments);
+	record.put(colorBlending.blendConstants);
+	putArray(record, createInfo.pDynamicState ? createInfo.pDynamicState->dynamicStateCount : 0, createInfo.pDynamicState ? createInfo.pDynamicState->pDynamicStates : NULL);
+	write(TRACE_PIPELINE, record);
+}
+
+void	TraceWriter::descriptorSet(uint64_t id, uint64_t layout)
+{
+	TraceStream		record;
+
+	if (!capturing())
+		return;
+	record.put(id);
+	record.put(layout);
+	write(TRACE_DESCRIPTOR_SET, record);
+}
+
+void	TraceWriter::descriptorWrite(const VkWriteDescriptorSet &descriptorWrite)
+{
+	TraceStream		record;
+
+	if (!capturing())
+		return;
+	if (!descriptorWrite.pImageInfo || descriptorWrite.descriptorType != VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT)
+		throw std::runtime_error("Only input attachment descriptors can be traced!");
+	record.put(handleId(descriptorWrite.dstSet));
+	record.put(descriptorWrite.dstBinding);
+	record.put(descriptorWrite.dstArrayElement);
+	record.put(descriptorWrite.descriptorType);
+	record.put(descriptorWrite.descriptorCount);
+	for (uint32_t i = 0; i < descriptorWrite.descriptorCount; i++)
+	{
+		record.put(handleId(descriptorWrite.pImageInfo[i].imageView));
+		record.put(descriptorWrite.pImageInfo[i].imageLayout);
+	}
+	write(TRACE_DESCRIPTOR_WRITE, record);
+}
+
+void	TraceWriter::submit(uint64_t frame, const std::vector<const TraceCommands *> &commandBuffers)
+{
+	TraceStream		record;
+
+	if (!capturing())
+		return;
+	record.put(frame);
+	record.put((uint32_t)commandBuffers.size());
+	for (const TraceCommands *commands : commandBuffers)
+	{
+		record.put((uint64_t)commands->stream().size());
+		record.append(commands->stream());
+	}
+	write(TRACE_SUBMIT, record);
+	frameCount++;
+}
+
+TraceReader::TraceReader() : fileHeader(), offset(0)
+{
+}
+
+void	TraceReader::open(const std::string &path)
+{
+	std::ifstream	file(path, std::ios::binary | std::ios::ate);
+	size_t			size;
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open " + path + "!");
+	size = (size_t)file.tellg();
+	if (size < sizeof(fileHeader))
+		throw std::runtime_error(path + " is not a trace!");
+	contents.resize(size);
+	file.seekg(0);
+	file.read((char *)contents.data(), size);
+	if (!file.good())
+		throw std::runtime_error("Failed to read " + path + "!");
+	memcpy(&fileHeader, contents.data(), sizeof(fileHeader));
+	if (fileHeader.magic != TRACE_FILE_MAGIC)
+		throw std::runtime_error(path + " is not a trace!");
+	if (fileHeader.version != TRACE_FILE_VERSION)
+		throw std::runtime_error(path + ": unsupported trace version " + std::to_string(fileHeader.version) + "!");
+	rewind();
+}
+
+const TraceFileHeader	&TraceReader::header() const
+{
+	return (fileHeader);
+}
+
+bool	TraceReader::next(TraceRecordType &type, TraceCursor &payload)
+{
+	TraceRecordHeader	header;
+
+	if (contents.size() - offset < sizeof(header))
+		return (false);
+	memcpy(&header, contents.data() + offset, sizeof(header));
+	offset += sizeof(header);
+	if (contents.size() - offset < header.size || header.type >= TRACE_RECORD_COUNT)
+		throw std::runtime_error("Corrupted trace record!");
+	type = (TraceRecordType)header.type;
+	payload = TraceCursor(contents.data() + offset, header.size);
+	offset += header.size;
+	return (true);
+}
+
+void	TraceReader::rewind()
+{
+	offset = sizeof(fileHeader);
+}
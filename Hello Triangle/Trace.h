@@ -0,0 +1,247 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <vulkan/vulkan.h>
+
+/*
+** Command stream trace (.vktrace): the objects the application created and
+** the command buffers it submitted, captured with _CAPTURE_TRACE and
+** re-executed headless by TraceReplayer.
+**
+**   TraceFileHeader | record | record | ...
+**
+** A record is a TraceRecordHeader followed by its payload, in the order the
+** calls were made: every object a record refers to was defined by an earlier
+** one. Objects are named by the handle they had in the application; a
+** handle reused after a destroy simply redefines its object. Submissions
+** carry one stream of TraceCommandType commands per command buffer, with
+** the secondary command buffers flattened into their primary.
+**
+** Only what this application uses is described: graphics pipelines without
+** depth or stencil state, input attachment descriptors, and buffers filled
+** once at creation. The swapchain is not part of the trace: the upscale
+** blit, the queries and the presentation are left out, a replayed frame
+** ends in the render target. Values are written as the host lays them out
+** (little endian, the structures of the Vulkan headers): a trace is read on
+** the platform that wrote it.
+*/
+
+#define TRACE_FILE_MAGIC		0x43525456u		// "VTRC"
+#define TRACE_FILE_VERSION		1
+
+enum					TraceRecordType
+{
+	TRACE_SHADER,				// id, SPIR-V
+	TRACE_BUFFER,				// id, size, usage, contents
+	TRACE_IMAGE,				// id, VkImageCreateInfo values
+	TRACE_IMAGE_VIEW,			// id, image, VkImageViewCreateInfo values
+	TRACE_RENDER_PASS,			// id, attachments, subpasses, dependencies
+	TRACE_FRAMEBUFFER,			// id, render pass, extent, image views
+	TRACE_SET_LAYOUT,			// id, bindings
+	TRACE_PIPELINE_LAYOUT,		// id, set layouts, push constant ranges
+	TRACE_PIPELINE,				// id, graphics pipeline state
+	TRACE_DESCRIPTOR_SET,		// id, set layout
+	TRACE_DESCRIPTOR_WRITE,		// set, binding, type, image view, layout
+	TRACE_SUBMIT,				// frame, command streams
+	TRACE_RECORD_COUNT
+};
+
+enum					TraceCommandType
+{
+	TRACE_CMD_BEGIN_RENDER_PASS,
+	TRACE_CMD_NEXT_SUBPASS,
+	TRACE_CMD_END_RENDER_PASS,
+	TRACE_CMD_BIND_PIPELINE,
+	TRACE_CMD_BIND_DESCRIPTOR_SET,
+	TRACE_CMD_BIND_VERTEX_BUFFER,
+	TRACE_CMD_BIND_INDEX_BUFFER,
+	TRACE_CMD_SET_VIEWPORT,
+	TRACE_CMD_SET_SCISSOR,
+	TRACE_CMD_PUSH_CONSTANTS,
+	TRACE_CMD_DRAW,
+	TRACE_CMD_DRAW_INDEXED,
+	TRACE_CMD_COUNT
+};
+
+struct					TraceFileHeader
+{
+	uint32_t			magic;
+	uint32_t			version;
+	uint32_t			vendorID;		// device of the capture, for the report
+	uint32_t			deviceID;
+	uint32_t			driverVersion;
+	char				deviceName[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+};
+
+struct					TraceRecordHeader
+{
+	uint32_t			type;
+	uint32_t			size;			// payload
+};
+
+/*
+** Appends values to a byte stream. Commands are a one byte TraceCommandType
+** and their arguments, unaligned: a draw takes a few tens of bytes.
+*/
+class TraceStream
+{
+public:
+	template <typename T>
+	void				put(const T &value)
+	{
+		bytes(&value, sizeof(value));
+	}
+
+	void				bytes(const void *data, size_t size);
+	void				append(const TraceStream &other);
+	void				clear();
+
+	const uint8_t		*data() const;
+	size_t				size() const;
+
+private:
+	std::vector<uint8_t>	buffer;
+};
+
+/*
+** Reads values back from a payload. Throws a runtime_error past the end.
+*/
+class TraceCursor
+{
+public:
+	TraceCursor(const uint8_t *data = NULL, size_t size = 0);
+
+	template <typename T>
+	T					get()
+	{
+		T		value;
+
+		bytes(&value, sizeof(value));
+		return (value);
+	}
+
+	void				bytes(void *data, size_t size);
+	const uint8_t		*skip(size_t size);
+	bool				atEnd() const;
+
+private:
+	const uint8_t		*current;
+	const uint8_t		*end;
+};
+
+/*
+** Command buffer contents, one call per vkCmd* the application records.
+*/
+class TraceCommands
+{
+public:
+	void				beginRenderPass(const VkRenderPassBeginInfo &beginInfo);
+	void				nextSubpass();
+	void				endRenderPass();
+	void				bindPipeline(uint64_t pipeline);
+	void				bindDescriptorSet(uint64_t layout, uint64_t set);
+	void				bindVertexBuffer(uint64_t buffer, VkDeviceSize offset);
+	void				bindIndexBuffer(uint64_t buffer, VkDeviceSize offset, VkIndexType indexType);
+	void				setViewport(const VkViewport &viewport);
+	void				setScissor(const VkRect2D &scissor);
+	void				pushConstants(uint64_t layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void *values);
+	void				draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+	void				drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
+
+	/*
+	** Inlines a secondary command buffer.
+	*/
+	void				execute(const TraceCommands &secondary);
+	void				clear();
+
+	const TraceStream	&stream() const;
+
+private:
+	TraceStream			commands;
+};
+
+/*
+** Capture side. Every call does nothing unless a capture is open, and the
+** records can come from several threads (the startup tasks): each one is
+** written whole under a lock.
+*/
+class TraceWriter
+{
+public:
+	TraceWriter();
+
+	/*
+	** Throws a runtime_error if path can't be written.
+	*/
+	void				open(const std::string &path, const VkPhysicalDeviceProperties &device);
+	/*
+	** Returns false if writing failed along the way.
+	*/
+	bool				close();
+	bool				capturing() const;
+	uint64_t			frames() const;
+	uint64_t			bytesWritten() const;
+
+	void				shader(uint64_t id, const VkShaderModuleCreateInfo &createInfo);
+	/*
+	** contents (NULL: left undefined) fill the buffer from offset 0.
+	*/
+	void				buffer(uint64_t id, VkDeviceSize size, VkBufferUsageFlags usage, const void *contents, VkDeviceSize contentsSize);
+	void				image(uint64_t id, const VkImageCreateInfo &createInfo);
+	void				imageView(uint64_t id, const VkImageViewCreateInfo &createInfo);
+	void				renderPass(uint64_t id, const VkRenderPassCreateInfo &createInfo);
+	void				framebuffer(uint64_t id, const VkFramebufferCreateInfo &createInfo);
+	void				setLayout(uint64_t id, const VkDescriptorSetLayoutCreateInfo &createInfo);
+	void				pipelineLayout(uint64_t id, const VkPipelineLayoutCreateInfo &createInfo);
+	void				pipeline(uint64_t id, const VkGraphicsPipelineCreateInfo &createInfo);
+	void				descriptorSet(uint64_t id, uint64_t layout);
+	void				descriptorWrite(const VkWriteDescriptorSet &write);
+	/*
+	** The command buffers of one vkQueueSubmit, in submission order.
+	*/
+	void				submit(uint64_t frame, const std::vector<const TraceCommands *> &commandBuffers);
+
+private:
+	std::mutex			mutex;
+	std::ofstream		file;
+	std::atomic<bool>	active;
+	uint64_t			frameCount;
+	uint64_t			written;
+
+	void				write(TraceRecordType type, const TraceStream &record);
+
+	TraceWriter(const TraceWriter &);
+	TraceWriter			&operator=(const TraceWriter &);
+};
+
+/*
+** Replay side: loads a whole trace and walks its records.
+*/
+class TraceReader
+{
+public:
+	TraceReader();
+
+	/*
+	** Throws a runtime_error if the file can't be read or isn't a trace.
+	*/
+	void					open(const std::string &path);
+	const TraceFileHeader	&header() const;
+
+	/*
+	** The next record, false at the end. payload reads it.
+	*/
+	bool					next(TraceRecordType &type, TraceCursor &payload);
+	void					rewind();
+
+private:
+	std::vector<uint8_t>	contents;
+	TraceFileHeader			fileHeader;
+	size_t					offset;
+};
+
@@ -0,0 +1,156 @@
+#ifdef _WIN32
+# define WIN32_LEAN_AND_MEAN
+# define NOMINMAX
+# include <windows.h>
+# include <psapi.h>
+#else
+# include <unistd.h>
+# include <sys/time.h>
+# include <sys/resource.h>
+#endif
+
+#include <cstdio>
+#include <iomanip>
+
+#include "Utilization.h"
+
+static const char	*modeNames[RENDER_MODE_COUNT] = { "continuous", "on-demand" };
+
+double	processCpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME		creation;
+	FILETIME		exit;
+	FILETIME		kernel;
+	FILETIME		user;
+	ULARGE_INTEGER	kernelTime;
+	ULARGE_INTEGER	userTime;
+
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return (0.0);
+	kernelTime.LowPart = kernel.dwLowDateTime;
+	kernelTime.HighPart = kernel.dwHighDateTime;
+	userTime.LowPart = user.dwLowDateTime;
+	userTime.HighPart = user.dwHighDateTime;
+	// FILETIME counts 100ns ticks
+	return ((kernelTime.QuadPart + userTime.QuadPart) / 10000000.0);
+#else
+	struct rusage	usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return (0.0);
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0);
+#endif
+}
+
+uint64_t	processPrivateBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS_EX	counters;
+
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS *>(&counters), sizeof(counters)))
+		return (0);
+	return (counters.PrivateUsage);
+#else
+	FILE				*statm;
+	unsigned long long	size;
+	unsigned long long	resident;
+	unsigned long long	shared;
+	int					fields;
+
+	// Resident pages minus the file backed ones
+	if ((statm = fopen("/proc/self/statm", "r")) == NULL)
+		return (0);
+	fields = fscanf(statm, "%llu %llu %llu", &size, &resident, &shared);
+	fclose(statm);
+	if (fields != 3)
+		return (0);
+	return ((resident - shared) * (uint64_t)sysconf(_SC_PAGESIZE));
+#endif
+}
+
+UtilizationMeter::UtilizationMeter() :
+	frames(0), gpuNs(0), gpuTiming(false), lastSample(std::chrono::steady_clock::now()),
+	lastCpuSeconds(processCpuSeconds())
+{
+	for (Totals &total : totals)
+	{
+		total.seconds = 0.0;
+		total.cpuSeconds = 0.0;
+		total.frames = 0;
+		total.gpuNs = 0;
+	}
+}
+
+void	UtilizationMeter::setGpuTimingSupported(bool supported)
+{
+	gpuTiming.store(supported, std::memory_order_relaxed);
+}
+
+void	UtilizationMeter::addFrame(uint64_t frameGpuNs)
+{
+	frames.fetch_add(1, std::memory_order_relaxed);
+	gpuNs.fetch_add(frameGpuNs, std::memory_order_relaxed);
+}
+
+UtilizationSample	UtilizationMeter::sample(RenderMode mode)
+{
+	UtilizationSample						result;
+	std::chrono::steady_clock::time_point	now;
+	double									cpuSeconds;
+	uint64_t								intervalGpuNs;
+
+	now = std::chrono::steady_clock::now();
+	cpuSeconds = processCpuSeconds();
+	result.seconds = std::chrono::duration<double>(now - lastSample).count();
+	result.frames = frames.exchange(0, std::memory_order_relaxed);
+	intervalGpuNs = gpuNs.exchange(0, std::memory_order_relaxed);
+	result.cpuPercent = (result.seconds > 0.0) ? 100.0 * (cpuSeconds - lastCpuSeconds) / result.seconds : 0.0;
+	result.gpuPercent = -1.0;
+	if (gpuTiming.load(std::memory_order_relaxed) && result.seconds > 0.0)
+		result.gpuPercent = 100.0 * (intervalGpuNs / 1000000000.0) / result.seconds;
+
+	totals[mode].seconds += result.seconds;
+	totals[mode].cpuSeconds += cpuSeconds - lastCpuSeconds;
+	totals[mode].frames += result.frames;
+	totals[mode].gpuNs += intervalGpuNs;
+	lastSample = now;
+	lastCpuSeconds = cpuSeconds;
+	return (result);
+}
+
+void	UtilizationMeter::report(std::ostream &out) const
+{
+	out << "Utilization per render mode (CPU in % of one core):" << std::endl;
+	out << std::left << std::setw(12) << "mode" << std::right
+		<< std::setw(10) << "seconds" << std::setw(10) << "frames" << std::setw(10) << "FPS"
+		<< std::setw(10) << "CPU %" << std::setw(10) << "GPU %" << std::setw(14) << "CPU ms/frame" << std::endl;
+	out << std::fixed << std::setprecision(2);
+	for (int i = 0; i < RENDER_MODE_COUNT; i++)
+	{
+		const Totals	&total = totals[i];
+
+		if (total.seconds <= 0.0)
+			continue;
+		out << std::left << std::setw(12) << modeNames[i] << std::right
+			<< std::setw(10) << total.seconds
+			<< std::setw(10) << total.frames
+			<< std::setw(10) << total.frames / total.seconds
+			<< std::setw(10) << 100.0 * total.cpuSeconds / total.seconds;
+		if (gpuTiming.load(std::memory_order_relaxed))
+			out << std::setw(10) << 100.0 * (total.gpuNs / 1000000000.0) / total.seconds;
+		else
+			out << std::setw(10) << "n/a";
+		if (total.frames)
+			out << std::setw(14) << 1000.0 * total.cpuSeconds / total.frames;
+		else
+			out << std::setw(14) << "-";
+		out << std::endl;
+	}
+	out << std::defaultfloat;
+}
+
+const char	*UtilizationMeter::modeName(RenderMode mode)
+{
+	return (modeNames[mode]);
+}
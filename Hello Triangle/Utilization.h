@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/*
+** CPU / GPU utilization of the process, per render mode.
+**
+** The render thread calls addFrame() with the GPU time of each presented
+** frame (timestamp queries around the render pass). The window thread calls
+** sample() once per report interval: it closes the interval, measures the
+** process CPU time spent in it and adds everything to the totals of the
+** render mode that was active, report() compares the modes at exit.
+*/
+
+enum					RenderMode
+{
+	RENDER_CONTINUOUS,
+	RENDER_ON_DEMAND,
+	RENDER_MODE_COUNT
+};
+
+struct					UtilizationSample
+{
+	double				seconds;
+	uint64_t			frames;
+	double				cpuPercent;		// of one core, all threads of the process
+	double				gpuPercent;		// negative when timestamps are not supported
+};
+
+/*
+** User + kernel time of every thread of the process, in seconds.
+*/
+double	processCpuSeconds();
+
+/*
+** Memory private to the process (heap, stacks, driver allocations), in
+** bytes. File mappings are not counted: their pages belong to the page cache.
+*/
+uint64_t	processPrivateBytes();
+
+class UtilizationMeter
+{
+public:
+	UtilizationMeter();
+
+	void				setGpuTimingSupported(bool supported);
+	void				addFrame(uint64_t gpuNs);
+
+	UtilizationSample	sample(RenderMode mode);
+	void				report(std::ostream &out) const;
+
+	static const char	*modeName(RenderMode mode);
+
+private:
+	struct				Totals
+	{
+		double			seconds;
+		double			cpuSeconds;
+		uint64_t		frames;
+		uint64_t		gpuNs;
+	};
+
+	std::atomic<uint64_t>	frames;
+	std::atomic<uint64_t>	gpuNs;
+	std::atomic<bool>		gpuTiming;
+
+	std::chrono::steady_clock::time_point	lastSample;
+	double					lastCpuSeconds;
+	Totals					totals[RENDER_MODE_COUNT];
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "Trace.h"
+#include "GpuCounters.h"
+
+struct GLFWwindow;
+
+/*
+** One window of the application and everything presenting to it: surface,
+** swapchain and its per-image resources, the offscreen render target,
+** acquire / present semaphores and the timestamp queries. Device, render
+** pass, pipeline and the frame tasks are shared by all the views.
+**
+** window is created on the window thread, the surface and the swapchain
+** resources by the startup tasks (see initVulkan), then everything but the
+** window is owned by the render thread.
+*/
+struct								View
+{
+	uint32_t						index;
+	std::string						name;
+
+	//window (GLFW)
+	GLFWwindow						*window;
+	VkExtent2D						windowExtent;
+	bool							iconified;
+	bool							minimized;
+	bool							resized;
+
+	//Vulkan surface and swapchain. Formats and present modes are queried
+	//once, when the device is picked
+	VkSurfaceKHR					surface;
+	std::vector<VkSurfaceFormatKHR>	surfaceFormats;
+	std::vector<VkPresentModeKHR>	presentModes;
+	VkSwapchainKHR					swapChain;
+	std::vector<VkImage>			swapChainImages;
+	VkFormat						swapChainImageFormat;
+	VkExtent2D						swapChainExtent;
+
+	//Offscreen target, as large as the swapchain: frames are rendered in its
+	//renderExtent top left corner and upscaled into the swapchain image
+	VkImage							targetImage;
+	VkDeviceMemory					targetMemory;
+	VkImageView						targetImageView;
+	VkFramebuffer					targetFramebuffer;
+	VkExtent2D						renderExtent;
+
+	//Post-processing chain (see createPostTargets): the two HDR images it
+	//ping-pongs between, their input attachment sets and, for separate post
+	//passes, one framebuffer per effect. postLazyMemory when the images are
+	//in lazily allocated memory
+	VkImage							postImages[2];
+	VkDeviceMemory					postMemory[2];
+	VkImageView						postImageViews[2];
+	VkDescriptorSet					postInputs[2];
+	std::vector<VkFramebuffer>		postFramebuffers;
+	bool							postLazyMemory;
+
+	//Multisampled scene color (see createMultisampleTarget), VK_NULL_HANDLE
+	//without MSAA. msaaMemorySize is its allocation, msaaLazyMemory when it
+	//is lazily allocated
+	VkImage							msaaImage;
+	VkDeviceMemory					msaaMemory;
+	VkImageView						msaaImageView;
+	VkDeviceSize					msaaMemorySize;
+	bool							msaaLazyMemory;
+
+	//Primary command buffer per swapchain image, and the contents of the
+	//current one while a trace is captured
+	std::vector<VkCommandBuffer>	commandBuffers;
+	TraceCommands					traceCommands;
+
+	//Vulkan semaphores, renderFinished one per swapchain image: the frame
+	//of an image only signals it again once the image is acquired again,
+	//after its previous present. Kept across swapchain recreations
+	VkSemaphore						imageAvailableSemaphore;
+	std::vector<VkSemaphore>		renderFinishedSemaphores;
+
+	//Two timestamps per swapchain image, VK_NULL_HANDLE if not supported,
+	//shown on profileTrack in profiler captures
+	VkQueryPool						timestampPool;
+	uint32_t						profileTrack;
+
+	//Ring of GPU_COUNTER_FRAMES counter slots (see readGpuCounters),
+	//VK_NULL_HANDLE when disabled. A slot holds counterChunks queries, one
+	//per frame chunk, slotChunks of them used by the frame written in it.
+	//counterSlot is the current frame's
+	VkQueryPool						statisticsPool;
+	VkQueryPool						occlusionPool;
+	uint64_t						counterFrames;
+	uint32_t						counterSlot;
+	uint32_t						counterChunks;
+	uint32_t						slotChunks[GPU_COUNTER_FRAMES];
+
+	//Current frame: set by the acquire, read by the recording tasks
+	bool							acquired;
+	uint32_t						imageIndex;
+};
+
+/*
+** Arrays handed to the single vkQueueSubmit / vkQueuePresentKHR of a frame,
+** one entry per acquired view. Kept between frames to avoid reallocating.
+*/
+struct									FrameSubmission
+{
+	std::vector<VkSemaphore>			renderFinished;
+	std::vector<VkSwapchainKHR>			swapChains;
+	std::vector<uint32_t>				imageIndices;
+	std::vector<VkResult>				results;
+	std::vector<View *>					views;
+
+	void	clear()
+	{
+		renderFinished.clear();
+		swapChains.clear();
+		imageIndices.clear();
+		results.clear();
+		views.clear();
+	}
+};
@@ -12,10 +12,58 @@
 # define ENABLE_VALIDATION_LAYER true
 #endif
 
+#define DYNAMIC_RESOLUTION_ENABLE true
+
+/*
+** Pipeline statistics and occlusion queries around every frame, exported
+** as metrics (see GpuCounters.h). Off by default: the queries cost a bit of
+** GPU time.
+*/
+#ifdef _GPU_COUNTERS
+# define GPU_COUNTERS_ENABLE true
+#else
+# define GPU_COUNTERS_ENABLE false
+#endif
+
+/*
+** Benchmark modes measure uncapped, continuously rendered frames at full
+** resolution.
+*/
+#if defined(_SPECIALIZATION_BENCHMARK) || defined(_JOB_BENCHMARK) || defined(_VIEW_BENCHMARK) || defined(_MESH_BENCHMARK) || defined(_LOD_BENCHMARK) \
+	|| defined(_POST_BENCHMARK) || defined(_DRAW_SORT_BENCHMARK) || defined(_MSAA_BENCHMARK) \
+	|| defined(_SUBMIT_BENCHMARK)
+# undef FRAME_CAP_ENABLE
+# define FRAME_CAP_ENABLE false
+# undef DYNAMIC_RESOLUTION_ENABLE
+# define DYNAMIC_RESOLUTION_ENABLE false
+# ifndef _CONTINUOUS_RENDERING
+#  define _CONTINUOUS_RENDERING
+# endif
+#endif
+
+/*
+** Number of windows (views) of the process. The view benchmark opens the
+** maximum it measures and renders a growing subset of them.
+*/
+#ifndef VIEW_COUNT
+# ifdef _VIEW_BENCHMARK
+#  define VIEW_COUNT 8
+# else
+#  define VIEW_COUNT 1
+# endif
+#endif
+
+#include "MeshFormat.h"
+#include "Specialization.h"
+#include "Trace.h"
+#include "DrawQueue.h"
+#include "SubmitScheduler.h"
+
 struct		QueueFamilyIndices
 {
 	int		graphicsFamily = -1;
 	int		presentFamily = -1;
+	int		transferFamily = -1;	// transfer only, for uploads (-1: on the graphics queue)
 
 	bool	isComplete()
 	{
@@ -28,4 +76,149 @@ struct							SwapChainSupportDetails
 	VkSurfaceCapabilitiesKHR		capabilities;
 	std::vector<VkSurfaceFormatKHR>	formats;
 	std::vector<VkPresentModeKHR>	presentModes;
+};
+
+/*
+** Mirrors the "layout(constant_id = N)" declarations of shader.vert and
+** shader.frag.
+*/
+struct			ShaderConstants
+{
+	float		vertexScale = 1.0f;
+	int32_t		colorMode = 0;
+	VkBool32	dynamicColorMode = VK_FALSE;
+};
+
+SPECIALIZATION_LAYOUT(ShaderConstants,
+	SPECIALIZATION_CONSTANT(ShaderConstants, 0, vertexScale),
+	SPECIALIZATION_CONSTANT(ShaderConstants, 1, colorMode),
+	SPECIALIZATION_CONSTANT(ShaderConstants, 2, dynamicColorMode)
+)
+
+/*
+** Per draw push constants: the vertex stage places the triangle, the
+** fragment stage only reads colorMode in the dynamicColorMode variant.
+*/
+struct			ShaderPushConstants
+{
+	float		offset[2];
+	float		scale;
+	int32_t		colorMode;
+};
+
+/*
+** Post-processing chain run after the scene (see createRenderPass): as
+** extra subpasses of the scene render pass, reading the previous result
+** through input attachments, or as one render pass per effect storing every
+** intermediate image, for comparison.
+*/
+enum			PostMode
+{
+	POST_NONE,
+	POST_SUBPASSES,
+	POST_SEPARATE,
+	POST_MODE_COUNT
+};
+
+enum			PostEffect
+{
+	POST_TONEMAP,
+	POST_COLOR_GRADE,
+	POST_VIGNETTE,
+	POST_EFFECT_COUNT
+};
+
+/*
+** Mirrors post.frag: one pipeline per effect.
+*/
+struct			PostConstants
+{
+	int32_t		effect = POST_TONEMAP;
+};
+
+SPECIALIZATION_LAYOUT(PostConstants,
+	SPECIALIZATION_CONSTANT(PostConstants, 0, effect)
+)
+
+struct			PostPushConstants
+{
+	float		inverseExtent[2];
+};
+
+/*
+** Simulated by the frame tasks, drawn as one triangle (or scene mesh) each.
+** The transform and the bounds live in the Scene (structure of arrays),
+** this is the rest of the per object state of the renderer. lod is the
+** mesh LOD of the previous frame, kept for the hysteresis. material picks
+** the pipeline the object is drawn with (see materialPipeline).
+*/
+struct			SceneObject
+{
+	float		velocity[2];
+	uint32_t	lod;
+	uint32_t	material;
+};
+
+/*
+** One draw of the scene: its push constants and the index range of the
+** selected mesh LOD (the 3 vertices of the triangle without a mesh).
+*/
+struct					SceneDraw
+{
+	ShaderPushConstants	constants;
+	uint32_t			firstIndex;
+	uint32_t			indexCount;
+};
+
+/*
+** A frame's worth of culled draws, one list per recording task, and the
+** order to record them in (queues, the same chunks). Double buffered: frame
+** N is recorded from one while frame N + 1 is simulated into the other.
+*/
+struct									FrameState
+{
+	std::vector<std::vector<SceneDraw>>	draws;
+	std::vector<DrawQueue>				queues;
+	std::vector<size_t>					objectOrderBinds;	// per chunk: the binds of its draws unsorted
+	size_t								visible;
+	uint64_t							triangles;
+	size_t								lodSwitches;
+};
+
+/*
+** Secondary command buffers recorded by one task, one per view. Each chunk
+** has its own pool, so it can be recorded on whichever worker runs the task.
+*/
+struct							FrameChunk
+{
+	VkCommandPool				commandPool;
+	std::vector<VkCommandBuffer>	commandBuffers;
+	std::vector<TraceCommands>	traceCommands;	// per view, while a trace is captured
+	std::vector<uint32_t>		visible;
+	uint64_t					triangles;
+	size_t						lodSwitches;
+	size_t						binds;			// vkCmdBind* recorded, every view
+	ptrdiff_t					bindsAvoided;	// fewer than in object order, every view
+};
+
+/*
+** Vertices and indices of a .vkmesh in one device local buffer, laid out
+** like the file sections: vertices at 0, indices at indexOffset (see
+** uploadMesh). center and radius come from the bounds, for placement.
+*/
+struct						GpuMesh
+{
+	VkBuffer				buffer = VK_NULL_HANDLE;
+	VkDeviceMemory			memory = VK_NULL_HANDLE;
+	VkDeviceSize			indexOffset = 0;
+	VkIndexType				indexType = VK_INDEX_TYPE_UINT16;
+	uint32_t				vertexCount = 0;
+	std::vector<MeshLod>	lods;
+	float					center[3] = {};
+	float					radius = 1.0f;
+
+	bool	loaded() const
+	{
+		return (buffer != VK_NULL_HANDLE);
+	}
 };
\ No newline at end of file
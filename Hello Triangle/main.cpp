@@ -1,17 +1,56 @@
 #define GLFW_INCLUDE_VULKAN
 //#define _NO_FRAME_CAP
+//#define _CONTINUOUS_RENDERING
+//#define _SPECIALIZATION_BENCHMARK
+//#define _JOB_BENCHMARK
+//#define _VIEW_BENCHMARK
+//#define _MESH_BENCHMARK
+//#define _LOD_BENCHMARK
+//#define _SCENE_BENCHMARK
+//#define _POST_BENCHMARK
+//#define _DRAW_SORT_BENCHMARK
+//#define _MSAA_BENCHMARK
+//#define _SUBMIT_BENCHMARK
+//#define _PROFILE_STARTUP
+//#define _GPU_COUNTERS
+//#define _CAPTURE_TRACE
 #include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
 
+#include <map>
 #include <set>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <memory>
+#include <atomic>
+#include <thread>
 #include <vector>
 #include <cstring>
+#include <sstream>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <exception>
 #include <stdexcept>
 #include <functional>
+#include <condition_variable>
 
 #include "VulkanTest.h"
+#include "Benchmark.h"
+#include "HostAllocator.h"
+#include "Logger.h"
+#include "RenderEvents.h"
+#include "Utilization.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "GpuCounters.h"
+#include "View.h"
+#include "DynamicResolution.h"
+#include "MeshFile.h"
+#include "MeshSource.h"
+#include "MeshSimplify.h"
+#include "Scene.h"
 
 using namespace std;
 
@@ -19,14 +58,56 @@ const int WIDTH = 800;
 const int HEIGHT = 600;
 const bool enableValidationLayers = ENABLE_VALIDATION_LAYER;
 const bool FrameCapEnable = FRAME_CAP_ENABLE;
+const double utilizationReportInterval = 1.0;
+const size_t defaultSceneObjects = 1;
+const size_t jobBenchmarkObjects = 100000;
+const size_t viewCount = VIEW_COUNT;
+const bool dynamicResolutionEnable = DYNAMIC_RESOLUTION_ENABLE;
+const double dynamicResolutionTargetMs = 12.0;	// GPU time per frame, headroom left under 60Hz
+const float dynamicResolutionMinScale = 0.5f;
+const char *sceneMeshPath = "models/scene.vkmesh";	// drawn instead of the triangle when present (see MeshConverter)
+const uint32_t meshBenchmarkRings = 400;
+const uint32_t meshBenchmarkSegments = 800;
+const float lodPixelError = 1.0f;		// screen space error a LOD may show, in pixels
+const float lodHysteresis = 0.25f;		// relative band around lodPixelError
+const size_t lodBenchmarkObjects = 5000;
+const uint32_t lodBenchmarkRings = 64;
+const uint32_t lodBenchmarkSegments = 128;
+const size_t sceneBenchmarkCounts[] = { 10000, 100000, 1000000 };
+const char *profileTracePath = "trace.json";	// P starts and stops a capture
+const char *startupTracePath = "startup_trace.json";
+const uint32_t startupProfileFrames = 120;	// _PROFILE_STARTUP: captured from run() to this frame
+const bool gpuCountersEnable = GPU_COUNTERS_ENABLE;
+const char *gpuCountersPrometheusPath = "gpu_counters.prom";	// rewritten with every render stats report
+const char *gpuCountersJsonPath = "gpu_counters.json";
+const PostMode defaultPostMode = POST_NONE;	// F and _POST_BENCHMARK turn the post chain on
+const VkFormat postColorFormat = VK_FORMAT_R16G16B16A16_SFLOAT;	// scene color and intermediates of the post chain
+const char *postModeNames[POST_MODE_COUNT] = { "no post-processing", "post subpasses", "post passes" };
+const char *postEffectNames[POST_EFFECT_COUNT] = { "tonemap", "colorGrade", "vignette" };
+const size_t postBenchmarkObjects = 1000;
+const char *traceCapturePath = "capture.vktrace";	// replayed by TraceReplayer
+const uint64_t traceCaptureFrames = 600;	// _CAPTURE_TRACE: captured from the device creation to this frame
+const uint32_t sceneMaterialMax = 3;	// one pipeline per color mode
+const size_t drawSortBenchmarkObjects = 100000;
+const VkSampleCountFlagBits defaultMsaaSamples = VK_SAMPLE_COUNT_1_BIT;	// S and _MSAA_BENCHMARK turn MSAA on
+const size_t msaaBenchmarkObjects = 1000;
+const size_t submitBenchmarkUploads = 32;		// copies streamed before every frame
+const VkDeviceSize submitBenchmarkUploadSize = 256 * 1024;
+
+#ifdef _CONTINUOUS_RENDERING
+const RenderMode defaultRenderMode = RENDER_CONTINUOUS;
+#else
+const RenderMode defaultRenderMode = RENDER_ON_DEMAND;
+#endif
 
 const vector<const char *> validationLayers =
 {
-	"VK_LAYER_LUNARG_standard_validation"
+	"VK_LAYER_KHRONOS_validation"
 };
 
 const vector<const char*> deviceExtensions = {
-	VK_KHR_SWAPCHAIN_EXTENSION_NAME
+	VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+	VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME
 };
 
 static vector<char>		readFile(const string filename)
@@ -47,19 +128,34 @@ static vector<char>		readFile(const string filename)
 	return (buffer);
 }
 
-VkResult	CreateDebugReportCallbackEXT(VkInstance instance, const VkDebugReportCallbackCreateInfoEXT *pCreateInfo, const VkAllocationCallbacks *pAllocator, VkDebugReportCallbackEXT *pCallback)
+/*
+** Vulkan handles are pointers on 64 bit builds and uint64_t (non-dispatchable
+** ones) on 32 bit builds: both end up as the uint64_t debug utils expect.
+*/
+static uint64_t		objectHandle(uint64_t handle)
 {
-	auto func = (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT");
+	return (handle);
+}
+
+template <typename T>
+static uint64_t		objectHandle(T *handle)
+{
+	return ((uint64_t)(uintptr_t)handle);
+}
+
+VkResult	CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT *pCreateInfo, const VkAllocationCallbacks *pAllocator, VkDebugUtilsMessengerEXT *pMessenger)
+{
+	auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
 	if (func != NULL)
-		return (func(instance, pCreateInfo, pAllocator, pCallback));
+		return (func(instance, pCreateInfo, pAllocator, pMessenger));
 	return (VK_ERROR_EXTENSION_NOT_PRESENT);
 }
 
-void		DestroyDebugReportCallbackEXT(VkInstance instance, VkDebugReportCallbackEXT callback, const VkAllocationCallbacks* pAllocator)
+void		DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT messenger, const VkAllocationCallbacks* pAllocator)
 {
-	auto func = (PFN_vkDestroyDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugReportCallbackEXT");
+	auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
 	if (func != nullptr)
-		func(instance, callback, pAllocator);
+		func(instance, messenger, pAllocator);
 }
 
 class HelloTriangleApplication
@@ -67,106 +163,389 @@ class HelloTriangleApplication
 public:
 	void run()
 	{
-		initWindow();
+		Profiler::setThreadName("main");
+#ifdef _PROFILE_STARTUP
+		Profiler::start();
+#endif
+		startupNs = JobSystem::clockNs();
+		logger.start();
+		glfwInit();
 		initVulkan();
 		mainLoop();
 		cleanup();
 	}
 
 private:
-	//window (GLFW) variables
-	GLFWwindow					*window;
+	//Windows and everything presenting to them (see View.h)
+	vector<View>				views;
+	size_t						activeViews;
+	bool						allViewsMinimized = false;
+	bool						batchedSubmit = true;
+	FrameSubmission				submission;
+
+	//Render thread, fed by the window thread through renderEvents
+	thread						renderThread;
+	atomic<bool>				renderRunning;
+	exception_ptr				renderError;
+	RenderEventQueue			renderEvents;
+	atomic<uint32_t>			droppedRenderEvents;
+	double						pendingInputTime = -1.0;
+	BenchmarkStats				inputLatency;
+	BenchmarkStats				eventLatency;
+
+	//Render on demand: frames are only produced when frameDirty is set
+	atomic<int>					renderMode;
+	bool						frameDirty = true;
+	atomic<bool>				renderSleeping;
+	mutex						renderWakeMutex;
+	condition_variable			renderWake;
+
+	//Power report (GPU time from timestamps around the render pass)
+	UtilizationMeter			utilization;
+
+	//Resolution of the offscreen targets, driven by the GPU frame time
+	DynamicResolution			resolution{ dynamicResolutionTargetMs, dynamicResolutionMinScale };
+	float						timestampPeriod = 0.0f;
+	uint64_t					timestampMask = 0;
+
+	//Pipeline statistics and occlusion queries around the scene draws (see
+	//readGpuCounters), when enabled and supported by the device
+	GpuCounters					gpuCounters;
+	bool						gpuCountersEnabled = false;
+	bool						preciseOcclusion = false;
+
+	//Startup (see initVulkan): task timings, clock of JobSystem::clockNs()
+	int64_t						startupNs = 0;
+	vector<TaskTiming>			startupTimings;
+	bool						firstFramePresented = false;
+
+	//Profiler captures (see toggleProfileCapture): GPU timestamps plus
+	//gpuClockOffsetNs are on the clock of Profiler::nowNs()
+	int64_t						gpuClockOffsetNs = 0;
+	uint32_t					profiledFrames = 0;
+
+	//Frame pipeline: scene update, culling, draw preparation and command
+	//recording run as frameGraph tasks on the job system (see buildFrameGraph)
+	unique_ptr<JobSystem>		jobs;
+	TaskGraph					frameGraph;
+	vector<FrameChunk>			frameChunks;
+	FrameState					frameStates[2];
+	uint32_t					frameIndex = 0;
+	Scene						scene;
+	vector<SceneObject>			sceneObjects;
+	bool						sceneAnimated = false;
+	bool						lodEnabled = true;
+	float						lodBandWidth = lodHysteresis;
+	float						lodBias = 1.0f;
+	float						lodPixelScale = 0.0f;
+	float						simulationDt = 0.0f;
+	double						lastSimulationTime = 0.0;
+	double						lastGraphMs = 0.0;
+	double						lastAcquireMs = 0.0;
+	double						lastSubmitMs = 0.0;
+	double						lastPresentMs = 0.0;
+	double						lastGpuMs = 0.0;
+	uint64_t					lastTriangles = 0;
+	size_t						lastLodSwitches = 0;
+	size_t						lastBinds = 0;
+	ptrdiff_t					lastBindsAvoided = 0;
+	vector<BenchmarkStats>		stageTimings;
+
+	//Draw submission: the objects use sceneMaterials pipelines, the draws
+	//are recorded in sort key order when drawSortEnabled (see prepareDraws)
+	uint32_t					sceneMaterials = 1;
+	vector<VkPipeline>			materialPipelines;
+	bool						drawSortEnabled = true;
 	
+	//Host memory instrumentation (pAllocator of every Vulkan call)
+	HostAllocator				hostAllocator;
+
+	//Asynchronous logging (validation messages and runtime stats)
+	Logger						logger{ cout, LOG_INFO };
+
 	//Vulkan features
 	VkInstance					instance;
-	VkDebugReportCallbackEXT	callback;
+	VkDebugUtilsMessengerEXT	debugMessenger;
+	PFN_vkSetDebugUtilsObjectNameEXT	setDebugObjectName = NULL;
 
 	//Vulkan devices
 	VkDevice					device;
 	VkPhysicalDevice			physicalDevice = VK_NULL_HANDLE;
 
-	//Vulkan queues
+	//Vulkan queues, families queried once when the device is picked
+	QueueFamilyIndices			queueIndices;
 	VkQueue						graphicsQueue;
 	VkQueue						presentQueue;
+	VkQueue						transferQueue;
 
-	//Vulkan surface
-	VkSurfaceKHR				surface;
-
-	//Vulkan swapchain
-	VkSwapchainKHR				swapChain;
-	vector<VkImage>				swapChainImages;
-	VkFormat					swapChainImageFormat;
-	VkExtent2D					swapChainExtent;
-	vector<VkImageView>			swapChainImageViews;
-	vector<VkFramebuffer>		swapChainFramebuffers;
+	//Queue submissions (see SubmitScheduler): a timeline per queue, the
+	//transfer one is graphicsTimeline without a transfer family. Every batch
+	//of the next frame submission waits for frameDependencies (uploads)
+	SubmitScheduler				scheduler;
+	uint32_t					graphicsTimeline = 0;
+	uint32_t					transferTimeline = 0;
+	SubmitBatch					frameDependencies;
+	SubmitBatch					frameBatch;
 
 	//Vulkan graphics pipeline
 	VkPipeline					graphicsPipeline;
 	VkRenderPass				renderPass;
 	VkPipelineLayout			pipelineLayout;
+	ShaderConstants				shaderConstants;
+	map<string, vector<char>>	shaderFiles;
+	TraceWriter					trace;
+
+	//Post-processing chain (see createRenderPass). In the separate mode
+	//postPasses[0] runs every effect but the last, postPasses[1] the last
+	PostMode					postMode = defaultPostMode;
+	VkRenderPass				postPasses[2] = {};
+	VkPipeline					postPipelines[POST_EFFECT_COUNT] = {};
+	VkPipelineLayout			postPipelineLayout;
+	VkDescriptorSetLayout		postSetLayout;
+	VkDescriptorPool			postDescriptorPool;
+	uint32_t					postBytesPerPixel = 0;
+
+	//Scene MSAA (see createMultisampleTarget): msaaSampleCounts are the
+	//sample counts the device can render color attachments with
+	VkSampleCountFlagBits		msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+	VkSampleCountFlags			msaaSampleCounts = VK_SAMPLE_COUNT_1_BIT;
+	uint32_t					renderPassAttachments = 1;
 
 	//Vulkan commands buffering
 	VkCommandPool				commandPool;
-	vector<VkCommandBuffer>		commandBuffers;
-
-	//Vulkan semaphores
-	VkSemaphore					imageAvailableSemaphore;
-	VkSemaphore					renderFinishedSemaphore;
-
-	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objType, uint64_t obj, size_t location, int32_t code, const char *layerPrefix, const char *msg, void *userDta)
+	VkCommandPool				transferCommandPool;
+
+	//Scene mesh, uploaded from a mapped .vkmesh (see uploadMesh)
+	GpuMesh						sceneMesh;
+	bool						hostPointerImport = false;
+	VkDeviceSize				hostPointerAlignment = 0;
+	PFN_vkGetMemoryHostPointerPropertiesEXT	getMemoryHostPointerProperties = NULL;
+
+	/*
+	** Runs inside the driver call that triggered the message: only format it
+	** into the logger ring, the console write happens on the logger thread.
+	*/
+	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT *callbackData, void *userDta)
 	{
-		cout << "Validation layer: " << msg << endl;
+		Logger		*logger;
+		LogSeverity	severity;
+		char		objects[160];
+		size_t		length;
+
+		logger = reinterpret_cast<Logger *>(userDta);
+		if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+			severity = LOG_ERROR;
+		else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+			severity = LOG_WARNING;
+		else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+			severity = LOG_INFO;
+		else
+			severity = LOG_DEBUG;
+		if (!logger->enabled(severity))
+			return (VK_FALSE);
+
+		objects[0] = '\0';
+		length = 0;
+		for (uint32_t i = 0; i < callbackData->objectCount && length < sizeof(objects); i++)
+		{
+			if (callbackData->pObjects[i].pObjectName == NULL)
+				continue;
+			length += snprintf(objects + length, sizeof(objects) - length, "%s%s", length ? ", " : " (objects: ", callbackData->pObjects[i].pObjectName);
+		}
+		if (length > 0 && length < sizeof(objects) - 1)
+			strcat(objects, ")");
 
+		logger->log(severity, "Validation layer%s [%s]%s: %s",
+			(messageType & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) ? " (performance)" : "",
+			callbackData->pMessageIdName ? callbackData->pMessageIdName : "", objects, callbackData->pMessage);
 		return (VK_FALSE);
 	}
 
-	void	setupDebugCallback()
+	void	populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo)
 	{
-		VkDebugReportCallbackCreateInfoEXT	createInfo = {};
-
-		if (!enableValidationLayers)
-			return;
-
-		createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
-		createInfo.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;// | VK_DEBUG_REPORT_PERFORMANCE_WARNING_BIT_EXT;
-		createInfo.pfnCallback = debugCallback;
+		createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+		createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+		createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+		createInfo.pfnUserCallback = debugCallback;
 
 		/*
 		** make the debug verbose
 		*/
-		//createInfo.flags |= (VK_DEBUG_REPORT_INFORMATION_BIT_EXT | VK_DEBUG_REPORT_DEBUG_BIT_EXT);
+		//createInfo.messageSeverity |= (VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT);
 
 		/*
 		** ce pointeur est envoy dans le void *userDta du callback et permet
 		** de donner acces  nos propres donnes depuis l'intrieur de la fonction de callback.
 		*/
-		createInfo.pUserData = NULL;
+		createInfo.pUserData = &logger;
+	}
+
+	void	setupDebugMessenger()
+	{
+		VkDebugUtilsMessengerCreateInfoEXT	createInfo;
 
-		if (CreateDebugReportCallbackEXT(instance, &createInfo, NULL, &callback) != VK_SUCCESS)
-			throw runtime_error("Failed to set up the callback!");
+		if (!enableValidationLayers)
+			return;
+		populateDebugMessengerCreateInfo(createInfo);
+		if (CreateDebugUtilsMessengerEXT(instance, &createInfo, hostAllocator.callbacks(), &debugMessenger) != VK_SUCCESS)
+			throw runtime_error("Failed to set up the debug messenger!");
 	}
 
-	static void		onWindowResized(GLFWwindow *window, int width, int height)
+	/*
+	** Names show up in the validation messages (and in capture tools), so the
+	** logs identify which resource a message is about.
+	*/
+	template <typename T>
+	void	setObjectName(VkObjectType type, T handle, const string &name)
 	{
-		HelloTriangleApplication	*app;
+		VkDebugUtilsObjectNameInfoEXT	nameInfo = {};
 
-		if (width == 0 || height == 0)
+		if (setDebugObjectName == NULL)
 			return;
-		app = reinterpret_cast<HelloTriangleApplication *>(glfwGetWindowUserPointer(window));
-		app->recreateSwapChain();
+		nameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+		nameInfo.objectType = type;
+		nameInfo.objectHandle = objectHandle(handle);
+		nameInfo.pObjectName = name.c_str();
+		setDebugObjectName(device, &nameInfo);
+	}
+
+	/*
+	** Window thread side: GLFW callbacks only forward events to the render
+	** thread, nothing here may touch Vulkan.
+	*/
+	void	postRenderEvent(GLFWwindow *window, RenderEvent &event)
+	{
+		event.view = 0;
+		for (size_t i = 0; i < views.size(); i++)
+			if (views[i].window == window)
+				event.view = (int32_t)i;
+		event.time = glfwGetTime();
+		if (!renderEvents.tryPush(event))
+			droppedRenderEvents.fetch_add(1, memory_order_relaxed);
+		wakeRenderThread();
+	}
+
+	/*
+	** The fence pairs with the one in waitRenderEvents(): either the render
+	** thread sees the new event before sleeping, or we see it sleeping and
+	** notify it. The common case (render thread busy) takes no lock.
+	*/
+	void	wakeRenderThread()
+	{
+		atomic_thread_fence(memory_order_seq_cst);
+		if (renderSleeping.load(memory_order_relaxed))
+		{
+			{
+				lock_guard<mutex>	lock(renderWakeMutex);
+			}
+			renderWake.notify_one();
+		}
+	}
+
+	static HelloTriangleApplication	*getApp(GLFWwindow *window)
+	{
+		return (reinterpret_cast<HelloTriangleApplication *>(glfwGetWindowUserPointer(window)));
+	}
+
+	static void		onWindowResized(GLFWwindow *window, int width, int height)
+	{
+		RenderEvent		event = {};
+
+		event.type = RENDER_EVENT_RESIZE;
+		event.width = width;
+		event.height = height;
+		getApp(window)->postRenderEvent(window, event);
+	}
+
+	static void		onIconified(GLFWwindow *window, int iconified)
+	{
+		RenderEvent		event = {};
+
+		event.type = RENDER_EVENT_ICONIFY;
+		event.code = iconified;
+		getApp(window)->postRenderEvent(window, event);
+	}
+
+	static void		onKey(GLFWwindow *window, int key, int scancode, int action, int mods)
+	{
+		RenderEvent		event = {};
+
+		(void)scancode;
+		if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+			glfwSetWindowShouldClose(window, GLFW_TRUE);
+		event.type = RENDER_EVENT_KEY;
+		event.code = key;
+		event.action = action;
+		event.mods = mods;
+		getApp(window)->postRenderEvent(window, event);
+	}
+
+	static void		onMouseButton(GLFWwindow *window, int button, int action, int mods)
+	{
+		RenderEvent		event = {};
+
+		event.type = RENDER_EVENT_MOUSE_BUTTON;
+		event.code = button;
+		event.action = action;
+		event.mods = mods;
+		getApp(window)->postRenderEvent(window, event);
+	}
+
+	static void		onCursorMoved(GLFWwindow *window, double x, double y)
+	{
+		RenderEvent		event = {};
+
+		event.type = RENDER_EVENT_CURSOR;
+		event.x = x;
+		event.y = y;
+		getApp(window)->postRenderEvent(window, event);
+	}
+
+	static void		onScroll(GLFWwindow *window, double x, double y)
+	{
+		RenderEvent		event = {};
+
+		event.type = RENDER_EVENT_SCROLL;
+		event.x = x;
+		event.y = y;
+		getApp(window)->postRenderEvent(window, event);
 	}
 
 	void	initWindow()
 	{
-		glfwInit();
+		string		title;
 
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 		glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
-		window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan Test", NULL, NULL);
-		glfwSetWindowSizeLimits(window, 400, 300, 7680, 4320);
-		glfwSetWindowUserPointer(window, this);
-		glfwSetWindowSizeCallback(window, HelloTriangleApplication::onWindowResized);
+		views.resize(viewCount);
+		for (size_t i = 0; i < views.size(); i++)
+		{
+			View	&view = views[i];
+
+			view = View();
+			view.index = (uint32_t)i;
+			view.name = (views.size() > 1) ? "view" + to_string(i) + "." : "";
+			view.profileTrack = Profiler::addTrack((views.size() > 1) ? "GPU (view " + to_string(i) + ")" : "GPU");
+			title = (views.size() > 1) ? "Vulkan Test (view " + to_string(i) + ")" : "Vulkan Test";
+			view.window = glfwCreateWindow(WIDTH, HEIGHT, title.c_str(), NULL, NULL);
+			if (views.size() > 1)
+				glfwSetWindowPos(view.window, 40 + 60 * (int)i, 40 + 40 * (int)i);
+			glfwSetWindowSizeLimits(view.window, 400, 300, 7680, 4320);
+			glfwSetWindowUserPointer(view.window, this);
+			glfwSetWindowSizeCallback(view.window, HelloTriangleApplication::onWindowResized);
+			glfwSetWindowIconifyCallback(view.window, HelloTriangleApplication::onIconified);
+			glfwSetKeyCallback(view.window, HelloTriangleApplication::onKey);
+			glfwSetMouseButtonCallback(view.window, HelloTriangleApplication::onMouseButton);
+			glfwSetCursorPosCallback(view.window, HelloTriangleApplication::onCursorMoved);
+			glfwSetScrollCallback(view.window, HelloTriangleApplication::onScroll);
+			view.windowExtent = { (uint32_t)WIDTH, (uint32_t)HEIGHT };
+		}
+		activeViews = views.size();
+		droppedRenderEvents = 0;
+		renderMode = defaultRenderMode;
+		renderSleeping = false;
 	}
 
 	bool	checkValidationLayerSuport()
@@ -208,7 +587,7 @@ private:
 		for (unsigned int i = 0; i < glfwExtensionCount; i++)
 			extensions.push_back(glfwExtensions[i]);
 		if (enableValidationLayers)
-			extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 		return (extensions);
 	}
 
@@ -219,6 +598,7 @@ private:
 		VkInstanceCreateInfo	createInfo = {};
 		VkApplicationInfo		appInfo = {};
 		VkResult				result;
+		VkDebugUtilsMessengerCreateInfoEXT	debugCreateInfo;
 
 		if (enableValidationLayers && !checkValidationLayerSuport())
 			throw runtime_error("Validation layers requested, but not available!");
@@ -230,7 +610,7 @@ private:
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		appInfo.apiVersion = VK_API_VERSION_1_1;
 
 		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 		createInfo.pApplicationInfo = &appInfo;
@@ -239,13 +619,16 @@ private:
 		{
 			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
 			createInfo.ppEnabledLayerNames = validationLayers.data();
+			// Also reports problems of vkCreateInstance / vkDestroyInstance themselves
+			populateDebugMessengerCreateInfo(debugCreateInfo);
+			createInfo.pNext = &debugCreateInfo;
 		}		
 
 		vector<const char *> extensions = getRequiredExtensions();
 		createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
 		createInfo.ppEnabledExtensionNames = extensions.data();
 
-		if ((result = vkCreateInstance(&createInfo, NULL, &instance)) != VK_SUCCESS)
+		if ((result = vkCreateInstance(&createInfo, hostAllocator.callbacks(), &instance)) != VK_SUCCESS)
 			throw runtime_error("Failed to create vulkan instance!");
 	}
 
@@ -266,7 +649,7 @@ private:
 
 		for (const auto& queueFamily : queueFamilies)
 		{
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSuport);
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, views[0].surface, &presentSuport);
 			if (queueFamily.queueCount > 0)
 			{
 				if (queueFamily.queueFlags && VK_QUEUE_GRAPHICS_BIT)
@@ -278,11 +661,17 @@ private:
 				break;
 			i++;
 		}
+		for (i = 0; i < (int)queueFamilies.size(); i++)
+		{
+			if (queueFamilies[i].queueCount > 0 && (queueFamilies[i].queueFlags & VK_QUEUE_TRANSFER_BIT)
+				&& !(queueFamilies[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+				indices.transferFamily = i;
+		}
 
 		return (indices);
 	}
 
-	SwapChainSupportDetails		querySwapChainSupport(VkPhysicalDevice device)
+	SwapChainSupportDetails		querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface)
 	{
 		uint32_t				formatCount;
 		uint32_t				presentModeCount;
@@ -296,8 +685,6 @@ private:
 			details.formats.resize(formatCount);
 			vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
 		}
-		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
-
 
 		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, NULL);
 
@@ -314,13 +701,6 @@ private:
 	{
 		VkPresentModeKHR	bestMode;
 
-		/*
-		cout << "Imediat    : " << VK_PRESENT_MODE_IMMEDIATE_KHR  << endl;
-		cout << "Mailbox    : " << VK_PRESENT_MODE_MAILBOX_KHR << endl;
-		cout << "fifo       : " << VK_PRESENT_MODE_FIFO_KHR << endl;
-		cout << "fifo relax : " << VK_PRESENT_MODE_FIFO_RELAXED_KHR << endl;
-		*/
-
 		bestMode = VK_PRESENT_MODE_FIFO_KHR;
 		for (const VkPresentModeKHR& availablePresentMode : availablePresentModes)
 		{
@@ -350,14 +730,15 @@ private:
 		return (bestMode);
 	}
 
-	VkExtent2D				chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
+	/*
+	** Runs on the render thread: the window size comes from the last resize
+	** event, GLFW window queries are main thread only.
+	*/
+	VkExtent2D				chooseSwapExtent(const View &view, const VkSurfaceCapabilitiesKHR& capabilities)
 	{
-		int			width;
-		int			height;
 		VkExtent2D	actualExtent;
 
-		glfwGetWindowSize(window, &width, &height);
-		actualExtent = { (uint32_t)width, (uint32_t)height };
+		actualExtent = view.windowExtent;
 		if (capabilities.currentExtent.width != numeric_limits<uint32_t>::max())
 			return (capabilities.currentExtent);
 		actualExtent.width = std::max(capabilities.minImageExtent.width, min(capabilities.maxImageExtent.width, actualExtent.width));
@@ -380,7 +761,7 @@ private:
 		return (availableFormats[0]);
 	}
 
-	bool	checkDeviceExtensionSupport(VkPhysicalDevice device)
+	bool	checkDeviceExtensionSupport(VkPhysicalDevice device, const vector<const char *> &extensions = deviceExtensions)
 	{
 		uint32_t						extensionCount;
 		vector<VkExtensionProperties>	availableExtensions;
@@ -389,7 +770,7 @@ private:
 		vkEnumerateDeviceExtensionProperties(device, NULL, &extensionCount, NULL);
 		availableExtensions.resize(extensionCount);
 		vkEnumerateDeviceExtensionProperties(device, NULL, &extensionCount, availableExtensions.data());
-		requiredExtensions = set<string>(deviceExtensions.begin(), deviceExtensions.end());
+		requiredExtensions = set<string>(extensions.begin(), extensions.end());
 
 		for (const VkExtensionProperties& extension : availableExtensions)
 			requiredExtensions.erase(extension.extensionName);
@@ -411,12 +792,28 @@ private:
 		//vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 		indices = findQueueFamilies(device);
 
-		if (!extensionsSupported)
+		if (!extensionsSupported || !indices.isComplete())
 			return (false);
-		swapChainSupport = querySwapChainSupport(device);
-		swapChainAdequate = (!swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty());
+		/*
+		** Every view must be presentable from the same queue. Formats and
+		** present modes are kept on the view: the device picked is the last
+		** one tested, createSwapChain() doesn't query them again.
+		*/
+		for (View &view : views)
+		{
+			VkBool32	presentSuport;
 
-		return (indices.isComplete() && swapChainAdequate);
+			presentSuport = VK_FALSE;
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, indices.presentFamily, view.surface, &presentSuport);
+			swapChainSupport = querySwapChainSupport(device, view.surface);
+			swapChainAdequate = (!swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty());
+			if (!presentSuport || !swapChainAdequate)
+				return (false);
+			view.surfaceFormats = swapChainSupport.formats;
+			view.presentModes = swapChainSupport.presentModes;
+			view.swapChainImageFormat = chooseSwapSurfaceFormat(view.surfaceFormats).format;
+		}
+		return (true);
 		//cout << "\t" << deviceProperties.deviceName << endl;
 	}
 
@@ -444,6 +841,54 @@ private:
 
 		if (physicalDevice == VK_NULL_HANDLE)
 			throw runtime_error("failed to find a suitable GPU!");
+		queueIndices = findQueueFamilies(physicalDevice);
+		queryTimestampSupport();
+		queryCounterSupport();
+		queryMsaaSupport();
+	}
+
+	void	queryMsaaSupport()
+	{
+		VkPhysicalDeviceProperties	properties;
+
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		msaaSampleCounts = properties.limits.framebufferColorSampleCounts | VK_SAMPLE_COUNT_1_BIT;
+		msaaSamples = usableMsaaSamples(defaultMsaaSamples);
+	}
+
+	/*
+	** The highest sample count up to requested the device supports.
+	*/
+	VkSampleCountFlagBits	usableMsaaSamples(VkSampleCountFlagBits requested) const
+	{
+		uint32_t	samples;
+
+		samples = requested;
+		while (samples > VK_SAMPLE_COUNT_1_BIT && !(msaaSampleCounts & samples))
+			samples >>= 1;
+		return ((VkSampleCountFlagBits)samples);
+	}
+
+	/*
+	** VK_EXT_external_memory_host lets uploadMesh() copy straight from a file
+	** mapping. Optional: without it the mapping goes through a staging buffer.
+	*/
+	void	queryHostPointerImport(vector<const char *> &extensions)
+	{
+		VkPhysicalDeviceProperties							properties;
+		VkPhysicalDeviceProperties2							properties2 = {};
+		VkPhysicalDeviceExternalMemoryHostPropertiesEXT		hostProperties = {};
+
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		hostPointerImport = (properties.apiVersion >= VK_API_VERSION_1_1 && checkDeviceExtensionSupport(physicalDevice, { VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME }));
+		if (!hostPointerImport)
+			return;
+		hostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &hostProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+		hostPointerAlignment = hostProperties.minImportedHostPointerAlignment;
+		extensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
 	}
 
 	void	createLogicalDevice()
@@ -454,11 +899,15 @@ private:
 		VkPhysicalDeviceFeatures		deviceFeatures = {};
 		VkDeviceQueueCreateInfo			queueCreateInfo;
 		vector<VkDeviceQueueCreateInfo>	queueCreateInfos;
+		vector<const char *>			extensions;
 		set<int>						uniqueQueueFamilies;
+		VkPhysicalDeviceTimelineSemaphoreFeatures	timelineFeatures = {};
 
 		queuePriority = 1.0f;
-		indices = findQueueFamilies(physicalDevice);
+		indices = queueIndices;
 		uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+		if (indices.transferFamily >= 0)
+			uniqueQueueFamilies.insert(indices.transferFamily);
 
 		for (int queueFamily : uniqueQueueFamilies)
 		{
@@ -470,12 +919,20 @@ private:
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
+		deviceFeatures.pipelineStatisticsQuery = gpuCountersEnabled;
+		deviceFeatures.occlusionQueryPrecise = preciseOcclusion;
+		timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		timelineFeatures.timelineSemaphore = VK_TRUE;
+
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &timelineFeatures;
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 		createInfo.pEnabledFeatures = &deviceFeatures;
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		extensions = deviceExtensions;
+		queryHostPointerImport(extensions);
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+		createInfo.ppEnabledExtensionNames = extensions.data();
 		createInfo.enabledLayerCount = 0;
 		if (enableValidationLayers)
 		{
@@ -483,23 +940,52 @@ private:
 			createInfo.ppEnabledLayerNames = validationLayers.data();
 		}
 		
-		if (vkCreateDevice(physicalDevice, &createInfo, NULL, &device) != VK_SUCCESS)
+		if (vkCreateDevice(physicalDevice, &createInfo, hostAllocator.callbacks(), &device) != VK_SUCCESS)
 			throw runtime_error("Failed to create logical evice!");
 
 		vkGetDeviceQueue(device, indices.graphicsFamily, 0, &graphicsQueue);
 		vkGetDeviceQueue(device, indices.presentFamily, 0, &presentQueue);
+		if (indices.transferFamily >= 0)
+			vkGetDeviceQueue(device, indices.transferFamily, 0, &transferQueue);
+		else
+			transferQueue = graphicsQueue;
+		scheduler.create(device, hostAllocator.callbacks());
+		graphicsTimeline = scheduler.addQueue(graphicsQueue);
+		transferTimeline = scheduler.addQueue(transferQueue);
+		if (hostPointerImport)
+			getMemoryHostPointerProperties = (PFN_vkGetMemoryHostPointerPropertiesEXT)vkGetDeviceProcAddr(device, "vkGetMemoryHostPointerPropertiesEXT");
+		hostPointerImport = (getMemoryHostPointerProperties != NULL);
+
+		if (enableValidationLayers)
+			setDebugObjectName = (PFN_vkSetDebugUtilsObjectNameEXT)vkGetInstanceProcAddr(instance, "vkSetDebugUtilsObjectNameEXT");
+		setObjectName(VK_OBJECT_TYPE_DEVICE, device, "device");
+		setObjectName(VK_OBJECT_TYPE_QUEUE, graphicsQueue, "graphicsQueue");
+		if (presentQueue != graphicsQueue)
+			setObjectName(VK_OBJECT_TYPE_QUEUE, presentQueue, "presentQueue");
+		setObjectName(VK_OBJECT_TYPE_SEMAPHORE, scheduler.semaphore(graphicsTimeline), "graphicsTimeline");
+		if (transferQueue != graphicsQueue)
+		{
+			setObjectName(VK_OBJECT_TYPE_QUEUE, transferQueue, "transferQueue");
+			setObjectName(VK_OBJECT_TYPE_SEMAPHORE, scheduler.semaphore(transferTimeline), "transferTimeline");
+		}
 	}
 
-	void	createSurface()
+	void	createSurfaces()
 	{
-		if (glfwCreateWindowSurface(instance, window, NULL, &surface) != VK_SUCCESS)
-			throw runtime_error("Failed to create window surface!");
+		for (View &view : views)
+		{
+			if (glfwCreateWindowSurface(instance, view.window, hostAllocator.callbacks(), &view.surface) != VK_SUCCESS)
+				throw runtime_error("Failed to create window surface!");
+		}
 	}
 
-	void	createSwapChain()
+	/*
+	** Only the capabilities are queried again, they follow the window size.
+	*/
+	void	createSwapChain(View &view)
 	{
 		VkSwapchainCreateInfoKHR	createInfo = {};
-		SwapChainSupportDetails		swapChainSupport;
+		VkSurfaceCapabilitiesKHR	capabilities;
 		VkSurfaceFormatKHR			surfaceFormat;
 		QueueFamilyIndices			indices;
 		VkPresentModeKHR			presentMode;
@@ -507,25 +993,28 @@ private:
 		uint32_t					queueFamilyIndices[2];
 		uint32_t					imageCount;
 
-		swapChainSupport = querySwapChainSupport(physicalDevice);
-		surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-		presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
-		extent = chooseSwapExtent(swapChainSupport.capabilities);
+		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, view.surface, &capabilities);
+		surfaceFormat = chooseSwapSurfaceFormat(view.surfaceFormats);
+		presentMode = chooseSwapPresentMode(view.presentModes);
+		extent = chooseSwapExtent(view, capabilities);
 
-		imageCount = swapChainSupport.capabilities.minImageCount + 1;
-		if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
-			imageCount = swapChainSupport.capabilities.maxImageCount;
+		imageCount = capabilities.minImageCount + 1;
+		if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount)
+			imageCount = capabilities.maxImageCount;
 
 		createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-		createInfo.surface = surface;
+		createInfo.surface = view.surface;
 		createInfo.minImageCount = imageCount;
 		createInfo.imageFormat = surfaceFormat.format;
 		createInfo.imageColorSpace = surfaceFormat.colorSpace;
 		createInfo.imageExtent = extent;
 		createInfo.imageArrayLayers = 1;
-		createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		// Only written by the upscaling blit from the offscreen target
+		if (!(capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+			throw runtime_error("Swapchain images can't be blitted to!");
+		createInfo.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
-		indices = findQueueFamilies(physicalDevice);
+		indices = queueIndices;
 		queueFamilyIndices[0] = (uint32_t)indices.graphicsFamily;
 		queueFamilyIndices[1] = (uint32_t)indices.presentFamily;
 
@@ -543,32 +1032,338 @@ private:
 			createInfo.pQueueFamilyIndices = NULL;
 		}
 
-		createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
+		createInfo.preTransform = capabilities.currentTransform;
 		createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 
 		createInfo.presentMode = presentMode;
 		createInfo.clipped = VK_TRUE; // If VK_TRUE, ignore the color of pixels that are obstructed by something else. (for instance, if an other window is in front of it). Don't let like this fi i want to read pixels even in this situation
 		createInfo.oldSwapchain = VK_NULL_HANDLE;
 
-		if (vkCreateSwapchainKHR(device, &createInfo, NULL, &swapChain) != VK_SUCCESS)
+		if (vkCreateSwapchainKHR(device, &createInfo, hostAllocator.callbacks(), &view.swapChain) != VK_SUCCESS)
 			throw runtime_error("Failed to create swap chain!");
 
-		vkGetSwapchainImagesKHR(device, swapChain, &imageCount, NULL);
-		swapChainImages.resize(imageCount);
-		vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
+		vkGetSwapchainImagesKHR(device, view.swapChain, &imageCount, NULL);
+		view.swapChainImages.resize(imageCount);
+		vkGetSwapchainImagesKHR(device, view.swapChain, &imageCount, view.swapChainImages.data());
+		setObjectName(VK_OBJECT_TYPE_SWAPCHAIN_KHR, view.swapChain, view.name + "swapChain");
+		for (uint32_t i = 0; i < imageCount; i++)
+			setObjectName(VK_OBJECT_TYPE_IMAGE, view.swapChainImages[i], view.name + "swapChainImage[" + to_string(i) + "]");
+		logger.log(LOG_DEBUG, "Swapchain %u: %ux%u, %u images, present mode %d", view.index, extent.width, extent.height, imageCount, presentMode);
+
+		// swapChainImageFormat was chosen with the device (the render pass is built concurrently)
+		view.swapChainExtent = extent;
+	}
+
+	/*
+	** -1 when no memory type has the properties.
+	*/
+	int		findOptionalMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		VkPhysicalDeviceMemoryProperties	memProperties;
+
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+				return ((int)i);
+		}
+		return (-1);
+	}
+
+	uint32_t	findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		int		index;
+
+		index = findOptionalMemoryType(typeFilter, properties);
+		if (index < 0)
+			throw runtime_error("Failed to find a suitable memory type!");
+		return ((uint32_t)index);
+	}
+
+	/*
+	** transferShared: written by the transfer queue, read by the graphics
+	** one. Shared by both families when they differ, no ownership transfer.
+	*/
+	void	createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &memory,
+		bool transferShared = false)
+	{
+		VkBufferCreateInfo		bufferInfo = {};
+		VkMemoryRequirements	memRequirements;
+		VkMemoryAllocateInfo	allocInfo = {};
+		uint32_t				families[2];
+
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (transferShared && queueIndices.transferFamily >= 0)
+		{
+			families[0] = (uint32_t)queueIndices.graphicsFamily;
+			families[1] = (uint32_t)queueIndices.transferFamily;
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = 2;
+			bufferInfo.pQueueFamilyIndices = families;
+		}
+		if (vkCreateBuffer(device, &bufferInfo, hostAllocator.callbacks(), &buffer) != VK_SUCCESS)
+			throw runtime_error("Failed to create buffer!");
+
+		vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		if (vkAllocateMemory(device, &allocInfo, hostAllocator.callbacks(), &memory) != VK_SUCCESS)
+			throw runtime_error("Failed to allocate buffer memory!");
+		vkBindBufferMemory(device, buffer, memory, 0);
+	}
+
+	/*
+	** Wraps a whole file mapping in a transfer source buffer, without copying
+	** it. Fails (false) when the mapping doesn't meet the import alignment or
+	** the driver refuses this kind of memory (read only file pages).
+	*/
+	bool	importHostBuffer(const MappedFile &mapping, VkBuffer &buffer, VkDeviceMemory &memory)
+	{
+		const VkExternalMemoryHandleTypeFlagBits	handleTypes[2] = { VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_MAPPED_FOREIGN_MEMORY_BIT_EXT };
+		VkExternalMemoryHandleTypeFlagBits			handleType;
+		VkMemoryHostPointerPropertiesEXT			pointerProperties = {};
+		VkExternalMemoryBufferCreateInfo			externalInfo = {};
+		VkImportMemoryHostPointerInfoEXT			importInfo = {};
+		VkBufferCreateInfo							bufferInfo = {};
+		VkMemoryRequirements						memRequirements;
+		VkMemoryAllocateInfo						allocInfo = {};
+		uint32_t									memoryTypeBits;
+
+		if (!hostPointerImport || (uintptr_t)mapping.data() % hostPointerAlignment || mapping.size() % hostPointerAlignment)
+			return (false);
+		memoryTypeBits = 0;
+		for (VkExternalMemoryHandleTypeFlagBits type : handleTypes)
+		{
+			handleType = type;
+			pointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+			if (getMemoryHostPointerProperties(device, handleType, mapping.data(), &pointerProperties) == VK_SUCCESS && pointerProperties.memoryTypeBits)
+			{
+				memoryTypeBits = pointerProperties.memoryTypeBits;
+				break;
+			}
+		}
+		if (!memoryTypeBits)
+			return (false);
+
+		externalInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+		externalInfo.handleTypes = handleType;
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.pNext = &externalInfo;
+		bufferInfo.size = mapping.size();
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(device, &bufferInfo, hostAllocator.callbacks(), &buffer) != VK_SUCCESS)
+			return (false);
+		vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+		memoryTypeBits &= memRequirements.memoryTypeBits;
+		if (!memoryTypeBits)
+		{
+			vkDestroyBuffer(device, buffer, hostAllocator.callbacks());
+			return (false);
+		}
+
+		importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+		importInfo.handleType = handleType;
+		importInfo.pHostPointer = const_cast<uint8_t *>(mapping.data());
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.pNext = &importInfo;
+		allocInfo.allocationSize = mapping.size();
+		allocInfo.memoryTypeIndex = findMemoryType(memoryTypeBits, 0);
+		if (vkAllocateMemory(device, &allocInfo, hostAllocator.callbacks(), &memory) != VK_SUCCESS)
+		{
+			vkDestroyBuffer(device, buffer, hostAllocator.callbacks());
+			return (false);
+		}
+		vkBindBufferMemory(device, buffer, memory, 0);
+		return (true);
+	}
+
+	VkCommandBuffer		beginSingleTimeCommands(VkCommandPool pool)
+	{
+		VkCommandBufferAllocateInfo		allocInfo = {};
+		VkCommandBufferBeginInfo		beginInfo = {};
+		VkCommandBuffer					commandBuffer;
+
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = pool;
+		allocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+			throw runtime_error("Failed to allocate command buffer!");
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		return (commandBuffer);
+	}
+
+	/*
+	** Submits commandBuffer (from pool) on the timeline of queue and waits
+	** for its point, not for the whole queue to idle.
+	*/
+	SubmitPoint		endSingleTimeCommands(VkCommandBuffer commandBuffer, VkCommandPool pool, uint32_t queue)
+	{
+		SubmitBatch		batch;
+		SubmitPoint		point;
+
+		vkEndCommandBuffer(commandBuffer);
+		batch.commandBuffers.push_back(commandBuffer);
+		point = scheduler.enqueue(queue, batch);
+		scheduler.wait(point);
+		vkFreeCommandBuffers(device, pool, 1, &commandBuffer);
+		return (point);
+	}
+
+	/*
+	** Copies size bytes of source into a new device local buffer usable as
+	** vertex and index buffer, and releases the source. contents are the same
+	** bytes on the host, for the trace (NULL when there is no such copy).
+	** The copy runs on the transfer queue and is waited for on the CPU: the
+	** source, possibly an imported file mapping, must outlive it.
+	*/
+	void	createMeshBuffer(VkBuffer source, VkDeviceMemory sourceMemory, VkDeviceSize sourceOffset, VkDeviceSize size, const void *contents, GpuMesh &mesh)
+	{
+		const VkBufferUsageFlags	usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+		VkCommandBuffer				commandBuffer;
+		VkBufferCopy				copyRegion = {};
+
+		createBuffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.buffer, mesh.memory, true);
+		trace.buffer(objectHandle(mesh.buffer), size, usage, contents, size);
+		commandBuffer = beginSingleTimeCommands(transferCommandPool);
+		copyRegion.srcOffset = sourceOffset;
+		copyRegion.dstOffset = 0;
+		copyRegion.size = size;
+		vkCmdCopyBuffer(commandBuffer, source, mesh.buffer, 1, &copyRegion);
+		endSingleTimeCommands(commandBuffer, transferCommandPool, transferTimeline);
+		vkDestroyBuffer(device, source, hostAllocator.callbacks());
+		vkFreeMemory(device, sourceMemory, hostAllocator.callbacks());
+	}
+
+	/*
+	** The vertex and index sections of a .vkmesh are page aligned and already
+	** in their GPU layout, so the mapping is the transfer source as is: the
+	** whole range is copied with one vkCmdCopyBuffer, nothing is parsed. When
+	** the mapping can be imported the GPU reads the file pages directly (no
+	** CPU copy at all), otherwise they are memcpy'd once into a staging
+	** buffer. Returns true for the zero copy path.
+	*/
+	bool	uploadMesh(const MeshFile &file, GpuMesh &mesh)
+	{
+		const MeshFileHeader	&header = file.header();
+		VkBuffer				source;
+		VkDeviceMemory			sourceMemory;
+		VkDeviceSize			sourceOffset;
+		VkDeviceSize			size;
+		bool					imported;
+		void					*data;
+
+		sourceOffset = file.sectionOffset(MESH_SECTION_VERTICES);
+		size = file.sectionOffset(MESH_SECTION_INDICES) + file.sectionSize(MESH_SECTION_INDICES) - sourceOffset;
+		imported = importHostBuffer(file.mapping(), source, sourceMemory);
+		if (!imported)
+		{
+			createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, source, sourceMemory);
+			vkMapMemory(device, sourceMemory, 0, size, 0, &data);
+			memcpy(data, file.section(MESH_SECTION_VERTICES), (size_t)size);
+			vkUnmapMemory(device, sourceMemory);
+			sourceOffset = 0;
+		}
+		createMeshBuffer(source, sourceMemory, sourceOffset, size, file.section(MESH_SECTION_VERTICES), mesh);
+
+		mesh.indexOffset = file.sectionOffset(MESH_SECTION_INDICES) - file.sectionOffset(MESH_SECTION_VERTICES);
+		mesh.indexType = (header.indexSize == 2) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+		mesh.vertexCount = header.vertexCount;
+		mesh.lods.assign(file.lods(), file.lods() + header.lodCount);
+		setMeshBounds(mesh, header.boundsMin, header.boundsMax);
+		return (imported);
+	}
+
+	void	setMeshBounds(GpuMesh &mesh, const float boundsMin[3], const float boundsMax[3])
+	{
+		float	halfSize;
+
+		mesh.radius = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			mesh.center[axis] = 0.5f * (boundsMin[axis] + boundsMax[axis]);
+			halfSize = 0.5f * (boundsMax[axis] - boundsMin[axis]);
+			mesh.radius += halfSize * halfSize;
+		}
+		mesh.radius = max(sqrt(mesh.radius), 1e-6f);
+	}
+
+	void	destroyMesh(GpuMesh &mesh)
+	{
+		vkDestroyBuffer(device, mesh.buffer, hostAllocator.callbacks());
+		vkFreeMemory(device, mesh.memory, hostAllocator.callbacks());
+		mesh = GpuMesh();
+	}
+
+	/*
+	** The scene draws sceneMeshPath when it exists, the triangle otherwise.
+	*/
+	void	loadSceneMesh()
+	{
+		MeshFile	file;
+		bool		imported;
 
-		swapChainImageFormat = surfaceFormat.format;
-		swapChainExtent = extent;
+		if (!ifstream(sceneMeshPath).good())
+			return;
+		file.open(sceneMeshPath);
+		imported = uploadMesh(file, sceneMesh);
+		logger.log(LOG_INFO, "%s: %u vertices, %u triangles, %s upload", sceneMeshPath, file.header().vertexCount,
+			sceneMesh.lods[0].indexCount / 3, imported ? "zero copy" : "staging");
 	}
 
-	void	createImageViews()
+	/*
+	** Offscreen color target of the view, allocated once per swapchain at its
+	** full size. The dynamic resolution only changes the part of it that is
+	** rendered and blitted (renderExtent): no reallocation, no swapchain
+	** recreation when the scale moves.
+	*/
+	void	createRenderTarget(View &view)
 	{
-		VkImageViewCreateInfo	createInfo = {};
-		swapChainImageViews.resize(swapChainImages.size());
+		VkImageCreateInfo			imageInfo = {};
+		VkMemoryRequirements		memRequirements;
+		VkMemoryAllocateInfo		allocInfo = {};
+		VkImageViewCreateInfo		createInfo = {};
+		VkFormatProperties			formatProperties;
+		const VkFormatFeatureFlags	blitFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, view.swapChainImageFormat, &formatProperties);
+		if ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures)
+			throw runtime_error("Surface format can't be used as a scaled render target!");
+
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = view.swapChainImageFormat;
+		imageInfo.extent = { view.swapChainExtent.width, view.swapChainExtent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkCreateImage(device, &imageInfo, hostAllocator.callbacks(), &view.targetImage) != VK_SUCCESS)
+			throw runtime_error("Failed to create render target!");
+		trace.image(objectHandle(view.targetImage), imageInfo);
+
+		vkGetImageMemoryRequirements(device, view.targetImage, &memRequirements);
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (vkAllocateMemory(device, &allocInfo, hostAllocator.callbacks(), &view.targetMemory) != VK_SUCCESS)
+			throw runtime_error("Failed to allocate render target memory!");
+		vkBindImageMemory(device, view.targetImage, view.targetMemory, 0);
 
 		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		createInfo.image = view.targetImage;
 		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		createInfo.format = swapChainImageFormat;
+		createInfo.format = view.swapChainImageFormat;
 		createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
 		createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
 		createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -578,12 +1373,190 @@ private:
 		createInfo.subresourceRange.levelCount = 1;
 		createInfo.subresourceRange.baseArrayLayer = 0;
 		createInfo.subresourceRange.layerCount = 1;
-		for (size_t i = 0; i < swapChainImages.size(); i++)
+		if (vkCreateImageView(device, &createInfo, hostAllocator.callbacks(), &view.targetImageView) != VK_SUCCESS)
+			throw runtime_error("Failed to create image views!");
+		trace.imageView(objectHandle(view.targetImageView), createInfo);
+
+		setObjectName(VK_OBJECT_TYPE_IMAGE, view.targetImage, view.name + "targetImage");
+		setObjectName(VK_OBJECT_TYPE_DEVICE_MEMORY, view.targetMemory, view.name + "targetMemory");
+		setObjectName(VK_OBJECT_TYPE_IMAGE_VIEW, view.targetImageView, view.name + "targetImageView");
+		view.renderExtent = { resolution.scaled(view.swapChainExtent.width), resolution.scaled(view.swapChainExtent.height) };
+		createPostTargets(view);
+		createMultisampleTarget(view);
+	}
+
+	/*
+	** The two HDR images the post chain ping-pongs between: the scene renders
+	** into the first, effect i reads image i % 2 and writes the other one, the
+	** last effect writes the render target. As subpasses they are transient,
+	** in lazily allocated memory when the device has some: a tiler never
+	** backs them with memory at all.
+	*/
+	void	createPostTargets(View &view)
+	{
+		VkImageCreateInfo			imageInfo = {};
+		VkMemoryRequirements		memRequirements;
+		VkMemoryAllocateInfo		allocInfo = {};
+		VkImageViewCreateInfo		createInfo = {};
+		bool						transient;
+		int							lazyType;
+
+		if (postMode == POST_NONE)
+			return;
+		transient = (postMode == POST_SUBPASSES);
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = postColorFormat;
+		imageInfo.extent = { view.swapChainExtent.width, view.swapChainExtent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | (transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		createInfo.format = postColorFormat;
+		createInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		view.postLazyMemory = false;
+		for (int i = 0; i < 2; i++)
 		{
-			createInfo.image = swapChainImages[i];
-			if (vkCreateImageView(device, &createInfo, NULL, &swapChainImageViews[i]) != VK_SUCCESS)
+			if (vkCreateImage(device, &imageInfo, hostAllocator.callbacks(), &view.postImages[i]) != VK_SUCCESS)
+				throw runtime_error("Failed to create post-processing target!");
+			trace.image(objectHandle(view.postImages[i]), imageInfo);
+			vkGetImageMemoryRequirements(device, view.postImages[i], &memRequirements);
+			lazyType = transient ? findOptionalMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) : -1;
+			view.postLazyMemory = (lazyType >= 0);
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = memRequirements.size;
+			allocInfo.memoryTypeIndex = (lazyType >= 0) ? (uint32_t)lazyType : findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			if (vkAllocateMemory(device, &allocInfo, hostAllocator.callbacks(), &view.postMemory[i]) != VK_SUCCESS)
+				throw runtime_error("Failed to allocate post-processing target memory!");
+			vkBindImageMemory(device, view.postImages[i], view.postMemory[i], 0);
+
+			createInfo.image = view.postImages[i];
+			if (vkCreateImageView(device, &createInfo, hostAllocator.callbacks(), &view.postImageViews[i]) != VK_SUCCESS)
 				throw runtime_error("Failed to create image views!");
+			trace.imageView(objectHandle(view.postImageViews[i]), createInfo);
+			setObjectName(VK_OBJECT_TYPE_IMAGE, view.postImages[i], view.name + "postImage[" + to_string(i) + "]");
+			setObjectName(VK_OBJECT_TYPE_DEVICE_MEMORY, view.postMemory[i], view.name + "postMemory[" + to_string(i) + "]");
+			setObjectName(VK_OBJECT_TYPE_IMAGE_VIEW, view.postImageViews[i], view.name + "postImageView[" + to_string(i) + "]");
+		}
+	}
+
+	void	destroyPostTargets(View &view)
+	{
+		for (VkFramebuffer framebuffer : view.postFramebuffers)
+			vkDestroyFramebuffer(device, framebuffer, hostAllocator.callbacks());
+		view.postFramebuffers.clear();
+		for (int i = 0; i < 2; i++)
+		{
+			vkDestroyImageView(device, view.postImageViews[i], hostAllocator.callbacks());
+			vkDestroyImage(device, view.postImages[i], hostAllocator.callbacks());
+			vkFreeMemory(device, view.postMemory[i], hostAllocator.callbacks());
+			view.postImageViews[i] = VK_NULL_HANDLE;
+			view.postImages[i] = VK_NULL_HANDLE;
+			view.postMemory[i] = VK_NULL_HANDLE;
+		}
+	}
+
+	/*
+	** The scene's color with msaaSamples samples, resolved at the end of its
+	** subpass into the attachment the scene renders to without MSAA (see
+	** multisampleScene). It is never loaded nor stored: transient, in lazily
+	** allocated memory when the device has some, the samples stay in tile
+	** memory on a tiler and only the resolved pixels are written out.
+	*/
+	void	createMultisampleTarget(View &view)
+	{
+		VkImageCreateInfo			imageInfo = {};
+		VkMemoryRequirements		memRequirements;
+		VkMemoryAllocateInfo		allocInfo = {};
+		VkImageViewCreateInfo		createInfo = {};
+		int							lazyType;
+
+		view.msaaMemorySize = 0;
+		view.msaaLazyMemory = false;
+		if (msaaSamples == VK_SAMPLE_COUNT_1_BIT)
+			return;
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = (postMode == POST_NONE) ? view.swapChainImageFormat : postColorFormat;
+		imageInfo.extent = { view.swapChainExtent.width, view.swapChainExtent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = msaaSamples;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkCreateImage(device, &imageInfo, hostAllocator.callbacks(), &view.msaaImage) != VK_SUCCESS)
+			throw runtime_error("Failed to create multisample target!");
+		trace.image(objectHandle(view.msaaImage), imageInfo);
+
+		vkGetImageMemoryRequirements(device, view.msaaImage, &memRequirements);
+		lazyType = findOptionalMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+		view.msaaLazyMemory = (lazyType >= 0);
+		view.msaaMemorySize = memRequirements.size;
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex = (lazyType >= 0) ? (uint32_t)lazyType : findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (vkAllocateMemory(device, &allocInfo, hostAllocator.callbacks(), &view.msaaMemory) != VK_SUCCESS)
+			throw runtime_error("Failed to allocate multisample target memory!");
+		vkBindImageMemory(device, view.msaaImage, view.msaaMemory, 0);
+
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		createInfo.image = view.msaaImage;
+		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		createInfo.format = imageInfo.format;
+		createInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		if (vkCreateImageView(device, &createInfo, hostAllocator.callbacks(), &view.msaaImageView) != VK_SUCCESS)
+			throw runtime_error("Failed to create image views!");
+		trace.imageView(objectHandle(view.msaaImageView), createInfo);
+		setObjectName(VK_OBJECT_TYPE_IMAGE, view.msaaImage, view.name + "msaaImage");
+		setObjectName(VK_OBJECT_TYPE_DEVICE_MEMORY, view.msaaMemory, view.name + "msaaMemory");
+		setObjectName(VK_OBJECT_TYPE_IMAGE_VIEW, view.msaaImageView, view.name + "msaaImageView");
+	}
+
+	void	destroyMultisampleTarget(View &view)
+	{
+		vkDestroyImageView(device, view.msaaImageView, hostAllocator.callbacks());
+		vkDestroyImage(device, view.msaaImage, hostAllocator.callbacks());
+		vkFreeMemory(device, view.msaaMemory, hostAllocator.callbacks());
+		view.msaaImageView = VK_NULL_HANDLE;
+		view.msaaImage = VK_NULL_HANDLE;
+		view.msaaMemory = VK_NULL_HANDLE;
+	}
+
+	/*
+	** SPIR-V of the pipelines, read from disk once: the startup preloads the
+	** ones it needs while the windows are created, pipelines built later
+	** (benchmarks, scene mesh and post mode changes) read theirs on first use.
+	*/
+	const vector<char>	&shaderFile(const string &path)
+	{
+		map<string, vector<char>>::iterator	file;
+
+		file = shaderFiles.find(path);
+		if (file == shaderFiles.end())
+			file = shaderFiles.insert(make_pair(path, readFile(path))).first;
+		return (file->second);
+	}
+
+	void	preloadShaderFiles()
+	{
+		shaderFile("shaders/vert.spv");
+		shaderFile("shaders/frag.spv");
+		if (postMode != POST_NONE)
+		{
+			shaderFile("shaders/post_vert.spv");
+			shaderFile("shaders/post_frag.spv");
 		}
+		if (ifstream(sceneMeshPath).good())
+			shaderFile("shaders/mesh_vert.spv");
 	}
 
 	VkShaderModule		createShaderModule(const vector<char> &code)
@@ -594,22 +1567,134 @@ private:
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 		createInfo.codeSize = code.size();
 		createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
-		if (vkCreateShaderModule(device, &createInfo, NULL, &shaderModule) != VK_SUCCESS)
+		if (vkCreateShaderModule(device, &createInfo, hostAllocator.callbacks(), &shaderModule) != VK_SUCCESS)
 			throw runtime_error("Failed to create shader module!");
+		trace.shader(objectHandle(shaderModule), createInfo);
 		return (shaderModule);
 	}
 
-	void	createGraphicPipeline()
+	void	createPipelineLayout()
+	{
+		VkPushConstantRange				pushConstantRange = {};
+		VkPipelineLayoutCreateInfo		pipelineLayoutInfo = {};
+
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(ShaderPushConstants);
+
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 0; // Optional
+		pipelineLayoutInfo.pSetLayouts = nullptr; // Optional
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, hostAllocator.callbacks(), &pipelineLayout) != VK_SUCCESS)
+			throw runtime_error("Failed to create pipeline layout!");
+		trace.pipelineLayout(objectHandle(pipelineLayout), pipelineLayoutInfo);
+		setObjectName(VK_OBJECT_TYPE_PIPELINE_LAYOUT, pipelineLayout, "pipelineLayout");
+	}
+
+	/*
+	** The post effects read one input attachment: a set per view and post
+	** image (see updatePostInputs), whatever the post mode.
+	*/
+	void	createPostLayout()
+	{
+		VkDescriptorSetLayoutBinding	binding = {};
+		VkDescriptorSetLayoutCreateInfo	setLayoutInfo = {};
+		VkPushConstantRange				pushConstantRange = {};
+		VkPipelineLayoutCreateInfo		pipelineLayoutInfo = {};
+		VkDescriptorPoolSize			poolSize = {};
+		VkDescriptorPoolCreateInfo		poolInfo = {};
+		VkDescriptorSetAllocateInfo		allocInfo = {};
+		VkDescriptorSetLayout			setLayouts[2];
+
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		setLayoutInfo.bindingCount = 1;
+		setLayoutInfo.pBindings = &binding;
+		if (vkCreateDescriptorSetLayout(device, &setLayoutInfo, hostAllocator.callbacks(), &postSetLayout) != VK_SUCCESS)
+			throw runtime_error("Failed to create descriptor set layout!");
+		trace.setLayout(objectHandle(postSetLayout), setLayoutInfo);
+
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(PostPushConstants);
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &postSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, hostAllocator.callbacks(), &postPipelineLayout) != VK_SUCCESS)
+			throw runtime_error("Failed to create pipeline layout!");
+		trace.pipelineLayout(objectHandle(postPipelineLayout), pipelineLayoutInfo);
+
+		poolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		poolSize.descriptorCount = (uint32_t)(2 * views.size());
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = (uint32_t)(2 * views.size());
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		if (vkCreateDescriptorPool(device, &poolInfo, hostAllocator.callbacks(), &postDescriptorPool) != VK_SUCCESS)
+			throw runtime_error("Failed to create descriptor pool!");
+		setLayouts[0] = postSetLayout;
+		setLayouts[1] = postSetLayout;
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = postDescriptorPool;
+		allocInfo.descriptorSetCount = 2;
+		allocInfo.pSetLayouts = setLayouts;
+		for (View &view : views)
+		{
+			if (vkAllocateDescriptorSets(device, &allocInfo, view.postInputs) != VK_SUCCESS)
+				throw runtime_error("Failed to allocate descriptor sets!");
+			trace.descriptorSet(objectHandle(view.postInputs[0]), objectHandle(postSetLayout));
+			trace.descriptorSet(objectHandle(view.postInputs[1]), objectHandle(postSetLayout));
+		}
+		setObjectName(VK_OBJECT_TYPE_PIPELINE_LAYOUT, postPipelineLayout, "postPipelineLayout");
+	}
+
+	/*
+	** Points the input attachment sets of the view at its post images, once
+	** they are (re)created.
+	*/
+	void	updatePostInputs(View &view)
+	{
+		VkDescriptorImageInfo	imageInfos[2] = {};
+		VkWriteDescriptorSet	writes[2] = {};
+
+		for (int i = 0; i < 2; i++)
+		{
+			imageInfos[i].imageView = view.postImageViews[i];
+			imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = view.postInputs[i];
+			writes[i].dstBinding = 0;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			writes[i].pImageInfo = &imageInfos[i];
+		}
+		vkUpdateDescriptorSets(device, 2, writes, 0, NULL);
+		trace.descriptorWrite(writes[0]);
+		trace.descriptorWrite(writes[1]);
+	}
+
+	/*
+	** Builds the triangle pipeline with the given specialization constants, so
+	** each variant is constant-folded by the driver instead of branching. With
+	** a scene mesh, the vertex stage reads the MeshVertex stream instead.
+	*/
+	void	createGraphicPipeline(VkPipeline &pipeline, const ShaderConstants &constants)
 	{
 		VkRect2D								scissor = {};
 		VkViewport								viewport = {};
-		vector<char>							vertShaderCode;
-		vector<char>							fragShaderCode;
 		VkDynamicState							dynamicStates[2];
 		VkShaderModule							vertShaderModule;
 		VkShaderModule							fragShaderModule;
-		VkPipelineLayoutCreateInfo				pipelineLayoutInfo = {};
 		VkGraphicsPipelineCreateInfo			pipelineInfo = {};
+		SpecializationInfo<ShaderConstants>		specializationInfo(constants);
 		VkPipelineShaderStageCreateInfo			shaderStages[2];
 		VkPipelineShaderStageCreateInfo			vertShaderStageInfo = {};
 		VkPipelineShaderStageCreateInfo			fragShaderStageInfo = {};
@@ -618,24 +1703,26 @@ private:
 		VkPipelineColorBlendStateCreateInfo		colorBlendingInfo = {};
 		VkPipelineColorBlendAttachmentState		colorBlendAttach = {};
 		VkPipelineVertexInputStateCreateInfo	vertexInputInfo = {};
+		VkVertexInputBindingDescription			bindingDescription = {};
+		VkVertexInputAttributeDescription		attributeDescriptions[3] = {};
 		VkPipelineMultisampleStateCreateInfo	multisampling = {};
 		VkPipelineInputAssemblyStateCreateInfo	inputAssembly = {};
 		VkPipelineRasterizationStateCreateInfo	rasterizer = {};
 
 		/*Shader initialisation*/
 		{
-			vertShaderCode = readFile("shaders/vert.spv");
 			vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 			vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
 			vertShaderStageInfo.pName = "main";
-			vertShaderModule = createShaderModule(vertShaderCode);
+			vertShaderStageInfo.pSpecializationInfo = specializationInfo.get();
+			vertShaderModule = createShaderModule(shaderFile(sceneMesh.loaded() ? "shaders/mesh_vert.spv" : "shaders/vert.spv"));
 			vertShaderStageInfo.module = vertShaderModule;
 
-			fragShaderCode = readFile("shaders/frag.spv");
 			fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 			fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 			fragShaderStageInfo.pName = "main";
-			fragShaderModule = createShaderModule(fragShaderCode);
+			fragShaderStageInfo.pSpecializationInfo = specializationInfo.get();
+			fragShaderModule = createShaderModule(shaderFile("shaders/frag.spv"));
 			fragShaderStageInfo.module = fragShaderModule;
 
 			shaderStages[0] = vertShaderStageInfo;
@@ -649,6 +1736,20 @@ private:
 			vertexInputInfo.pVertexBindingDescriptions = NULL;
 			vertexInputInfo.vertexAttributeDescriptionCount = 0;
 			vertexInputInfo.pVertexAttributeDescriptions = NULL;
+			if (sceneMesh.loaded())
+			{
+				// Quantized attributes, expanded by the fetch (see MeshVertex)
+				bindingDescription.binding = 0;
+				bindingDescription.stride = sizeof(MeshVertex);
+				bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+				attributeDescriptions[0] = { 0, 0, VK_FORMAT_R16G16B16A16_SFLOAT, (uint32_t)offsetof(MeshVertex, position) };
+				attributeDescriptions[1] = { 1, 0, VK_FORMAT_R8G8B8A8_SNORM, (uint32_t)offsetof(MeshVertex, normal) };
+				attributeDescriptions[2] = { 2, 0, VK_FORMAT_R16G16_SFLOAT, (uint32_t)offsetof(MeshVertex, texCoord) };
+				vertexInputInfo.vertexBindingDescriptionCount = 1;
+				vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+				vertexInputInfo.vertexAttributeDescriptionCount = 3;
+				vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions;
+			}
 		}
 
 		/*Input assembly initialisation*/
@@ -662,8 +1763,8 @@ private:
 		{
 			viewport.x = 0.0f;
 			viewport.y = 0.0f;
-			viewport.width = (float)swapChainExtent.width;
-			viewport.height = (float)swapChainExtent.height;
+			viewport.width = (float)views[0].swapChainExtent.width;
+			viewport.height = (float)views[0].swapChainExtent.height;
 			viewport.minDepth = 0.0f;
 			viewport.maxDepth = 1.0f;
 		}
@@ -671,7 +1772,7 @@ private:
 		/*scissor initialisation*/
 		{
 			scissor.offset = { 0, 0 };
-			scissor.extent = swapChainExtent;
+			scissor.extent = views[0].swapChainExtent;
 		}
 
 		/*Viewport state initialisation*/
@@ -691,7 +1792,8 @@ private:
 			rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
 			rasterizer.lineWidth = 1.0f;
 			rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-			rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+			// Meshes are counter clockwise, mesh.vert flips y to the Vulkan convention
+			rasterizer.frontFace = sceneMesh.loaded() ? VK_FRONT_FACE_COUNTER_CLOCKWISE : VK_FRONT_FACE_CLOCKWISE;
 			rasterizer.depthBiasEnable = VK_FALSE;
 			rasterizer.depthBiasConstantFactor = 0.0f; // Optional
 			rasterizer.depthBiasClamp = 0.0f; // Optional
@@ -702,7 +1804,7 @@ private:
 		{
 			multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 			multisampling.sampleShadingEnable = VK_FALSE;
-			multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+			multisampling.rasterizationSamples = msaaSamples;
 			multisampling.minSampleShading = 1.0f; // Optional
 			multisampling.pSampleMask = NULL; // Optional
 			multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
@@ -740,18 +1842,6 @@ private:
 			dynamicStateInfos.pDynamicStates = dynamicStates;
 		}
 
-		/*Pipeline layout initialisation and creation*/
-		{
-			pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-			pipelineLayoutInfo.setLayoutCount = 0; // Optional
-			pipelineLayoutInfo.pSetLayouts = nullptr; // Optional
-			pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-			pipelineLayoutInfo.pPushConstantRanges = 0; // Optional
-
-			if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
-				throw runtime_error("Failed to create pipeline layout!");
-		}
-
 		/*Pipeline initialisation and creation*/
 		{
 			pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -772,306 +1862,2982 @@ private:
 			pipelineInfo.basePipelineIndex = -1; // Optional
 		}
 
-		if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+		if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, hostAllocator.callbacks(), &pipeline) != VK_SUCCESS)
 			throw runtime_error("Failed to create graphics pipeline!");
+		trace.pipeline(objectHandle(pipeline), pipelineInfo);
+		setObjectName(VK_OBJECT_TYPE_PIPELINE, pipeline, "graphicsPipeline (colorMode " + to_string(constants.colorMode) + (constants.dynamicColorMode ? ", dynamic)" : ")"));
 
-		vkDestroyShaderModule(device, fragShaderModule, NULL);
-		vkDestroyShaderModule(device, vertShaderModule, NULL);
+		vkDestroyShaderModule(device, fragShaderModule, hostAllocator.callbacks());
+		vkDestroyShaderModule(device, vertShaderModule, hostAllocator.callbacks());
 	}
 
-	void	createRenderPass()
+	/*
+	** One pipeline per post effect (the effect is a specialization constant
+	** of post.frag), for its subpass of renderPass or its own render pass:
+	** a fullscreen triangle without vertex input, depth or blending.
+	*/
+	void	createPostPipelines()
 	{
-		VkSubpassDependency			dependency = {};
-		VkSubpassDescription		subpass = {};
-		VkAttachmentReference		colorAttachRef = {};
-		VkRenderPassCreateInfo		renderPassInfo = {};
-		VkAttachmentDescription		colorAttachment = {};
-
-		colorAttachment.format = swapChainImageFormat;
-		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-		colorAttachRef.attachment = 0;
-		colorAttachRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.colorAttachmentCount = 1;
-		subpass.pColorAttachments = &colorAttachRef;
+		VkDynamicState							dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkShaderModule							vertShaderModule;
+		VkShaderModule							fragShaderModule;
+		VkGraphicsPipelineCreateInfo			pipelineInfo = {};
+		VkPipelineShaderStageCreateInfo			shaderStages[2] = {};
+		VkPipelineDynamicStateCreateInfo		dynamicStateInfos = {};
+		VkPipelineViewportStateCreateInfo		viewportStateInfo = {};
+		VkPipelineColorBlendStateCreateInfo		colorBlendingInfo = {};
+		VkPipelineColorBlendAttachmentState		colorBlendAttach = {};
+		VkPipelineVertexInputStateCreateInfo	vertexInputInfo = {};
+		VkPipelineMultisampleStateCreateInfo	multisampling = {};
+		VkPipelineInputAssemblyStateCreateInfo	inputAssembly = {};
+		VkPipelineRasterizationStateCreateInfo	rasterizer = {};
 
-		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependency.dstSubpass = 0;
-		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.srcAccessMask = 0;
-		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		if (postMode == POST_NONE)
+			return;
+		vertShaderModule = createShaderModule(shaderFile("shaders/post_vert.spv"));
+		fragShaderModule = createShaderModule(shaderFile("shaders/post_frag.spv"));
+		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		shaderStages[0].module = vertShaderModule;
+		shaderStages[0].pName = "main";
+		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shaderStages[1].module = fragShaderModule;
+		shaderStages[1].pName = "main";
+
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		viewportStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportStateInfo.viewportCount = 1;
+		viewportStateInfo.scissorCount = 1;
+		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer.cullMode = VK_CULL_MODE_NONE;
+		rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+		rasterizer.lineWidth = 1.0f;
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		colorBlendAttach.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colorBlendingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlendingInfo.attachmentCount = 1;
+		colorBlendingInfo.pAttachments = &colorBlendAttach;
+		dynamicStateInfos.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicStateInfos.dynamicStateCount = 2;
+		dynamicStateInfos.pDynamicStates = dynamicStates;
+
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = shaderStages;
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewportStateInfo;
+		pipelineInfo.pRasterizationState = &rasterizer;
+		pipelineInfo.pMultisampleState = &multisampling;
+		pipelineInfo.pColorBlendState = &colorBlendingInfo;
+		pipelineInfo.pDynamicState = &dynamicStateInfos;
+		pipelineInfo.layout = postPipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		for (uint32_t effect = 0; effect < POST_EFFECT_COUNT; effect++)
+		{
+			PostConstants						constants;
+
+			constants.effect = (int32_t)effect;
+			SpecializationInfo<PostConstants>	specializationInfo(constants);
+
+			shaderStages[1].pSpecializationInfo = specializationInfo.get();
+			pipelineInfo.renderPass = (postMode == POST_SUBPASSES) ? renderPass : postPasses[effect == POST_EFFECT_COUNT - 1];
+			pipelineInfo.subpass = (postMode == POST_SUBPASSES) ? effect + 1 : 0;
+			if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, hostAllocator.callbacks(), &postPipelines[effect]) != VK_SUCCESS)
+				throw runtime_error("Failed to create graphics pipeline!");
+			trace.pipeline(objectHandle(postPipelines[effect]), pipelineInfo);
+			setObjectName(VK_OBJECT_TYPE_PIPELINE, postPipelines[effect], string("postPipeline (") + postEffectNames[effect] + ")");
+		}
 
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		renderPassInfo.attachmentCount = 1;
-		renderPassInfo.pAttachments = &colorAttachment;
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 1;
-		renderPassInfo.pDependencies = &dependency;
-
-		if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
-			throw runtime_error("Failed to create render pass!");
+		vkDestroyShaderModule(device, fragShaderModule, hostAllocator.callbacks());
+		vkDestroyShaderModule(device, vertShaderModule, hostAllocator.callbacks());
 	}
 
-	void createFramebuffers()
+	void	destroyPostPipelines()
 	{
-		VkFramebufferCreateInfo		framebufferInfo = {};
-
-		swapChainFramebuffers.resize(swapChainImageViews.size());
-		for (size_t i = 0; i < swapChainImageViews.size(); i++)
+		for (VkPipeline &pipeline : postPipelines)
 		{
-			VkImageView	attachments[] = { swapChainImageViews[i] };
-			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			framebufferInfo.renderPass = renderPass;
-			framebufferInfo.attachmentCount = 1;
-			framebufferInfo.pAttachments = attachments;
-			framebufferInfo.width = swapChainExtent.width;
-			framebufferInfo.height = swapChainExtent.height;
-			framebufferInfo.layers = 1;
-
-			if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS)
-				throw runtime_error("Failed to create framebuffer!");
+			vkDestroyPipeline(device, pipeline, hostAllocator.callbacks());
+			pipeline = VK_NULL_HANDLE;
 		}
 	}
 
-	void	createCommandPool()
+	static VkAttachmentDescription	attachmentDescription(VkFormat format, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp,
+		VkImageLayout initialLayout, VkImageLayout finalLayout)
 	{
-		QueueFamilyIndices			queueFamilyIndices;
-		VkCommandPoolCreateInfo		poolInfo = {};
+		VkAttachmentDescription		attachment = {};
+
+		attachment.format = format;
+		attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		attachment.loadOp = loadOp;
+		attachment.storeOp = storeOp;
+		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.initialLayout = initialLayout;
+		attachment.finalLayout = finalLayout;
+		return (attachment);
+	}
 
-		queueFamilyIndices = findQueueFamilies(physicalDevice);
+	/*
+	** Dependencies between two subpasses are by region: a fragment only
+	** waits for its own pixel, which lets a tiler keep the chain on chip.
+	*/
+	static VkSubpassDependency	subpassDependency(uint32_t srcSubpass, uint32_t dstSubpass, VkPipelineStageFlags srcStageMask,
+		VkAccessFlags srcAccessMask, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask)
+	{
+		VkSubpassDependency		dependency = {};
+
+		dependency.srcSubpass = srcSubpass;
+		dependency.dstSubpass = dstSubpass;
+		dependency.srcStageMask = srcStageMask;
+		dependency.srcAccessMask = srcAccessMask;
+		dependency.dstStageMask = dstStageMask;
+		dependency.dstAccessMask = dstAccessMask;
+		if (srcSubpass != VK_SUBPASS_EXTERNAL && dstSubpass != VK_SUBPASS_EXTERNAL)
+			dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+		return (dependency);
+	}
+
+	static VkSubpassDescription	subpassDescription(const VkAttachmentReference *inputRef, const VkAttachmentReference *colorRef)
+	{
+		VkSubpassDescription	subpass = {};
+
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.inputAttachmentCount = inputRef ? 1 : 0;
+		subpass.pInputAttachments = inputRef;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = colorRef;
+		return (subpass);
+	}
+
+	/*
+	** Bytes per pixel a render pass reads and writes in memory: what its
+	** attachments load and store, every sample (clears and transient
+	** attachments cost nothing but tile memory).
+	*/
+	static uint32_t	passBytesPerPixel(const vector<VkAttachmentDescription> &attachments)
+	{
+		uint32_t	bytes;
+		uint32_t	pixelBytes;
+
+		bytes = 0;
+		for (const VkAttachmentDescription &attachment : attachments)
+		{
+			pixelBytes = ((attachment.format == postColorFormat) ? 8 : 4) * attachment.samples;
+			bytes += pixelBytes * ((attachment.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) + (attachment.storeOp == VK_ATTACHMENT_STORE_OP_STORE));
+		}
+		return (bytes);
+	}
+
+	VkRenderPass	buildRenderPass(const vector<VkAttachmentDescription> &attachments, const vector<VkSubpassDescription> &subpasses,
+		const vector<VkSubpassDependency> &dependencies, const char *name)
+	{
+		VkRenderPassCreateInfo		renderPassInfo = {};
+		VkRenderPass				pass;
+
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = (uint32_t)attachments.size();
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = (uint32_t)subpasses.size();
+		renderPassInfo.pSubpasses = subpasses.data();
+		renderPassInfo.dependencyCount = (uint32_t)dependencies.size();
+		renderPassInfo.pDependencies = dependencies.data();
+
+		if (vkCreateRenderPass(device, &renderPassInfo, hostAllocator.callbacks(), &pass) != VK_SUCCESS)
+			throw runtime_error("Failed to create render pass!");
+		trace.renderPass(objectHandle(pass), renderPassInfo);
+		setObjectName(VK_OBJECT_TYPE_RENDER_PASS, pass, name);
+		return (pass);
+	}
+
+	/*
+	** With MSAA, subpass 0 (scene) renders into a multisampled attachment
+	** appended to attachments and resolves it into attachment 0, which then
+	** needs no clear. The samples are cleared and thrown away: only the
+	** resolve leaves the subpass.
+	*/
+	void	multisampleScene(vector<VkAttachmentDescription> &attachments, vector<VkSubpassDependency> &dependencies,
+		VkSubpassDescription &scene, VkAttachmentReference &colorRef, VkAttachmentReference &resolveRef)
+	{
+		VkAttachmentDescription		attachment;
+
+		if (msaaSamples == VK_SAMPLE_COUNT_1_BIT)
+			return;
+		attachment = attachmentDescription(attachments[0].format, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		attachment.samples = msaaSamples;
+		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		colorRef = { (uint32_t)attachments.size(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		resolveRef = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		scene.pResolveAttachments = &resolveRef;
+		attachments.push_back(attachment);
+		// The previous frame must be done with the samples before they are cleared
+		dependencies.push_back(subpassDependency(VK_SUBPASS_EXTERNAL, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+	}
+
+	/*
+	** renderPass for the post mode, and postPasses when the effects are
+	** separate passes. The scene is always subpass 0 of renderPass.
+	**   POST_NONE: the scene is rendered straight into the target.
+	**   POST_SUBPASSES: the scene is rendered into post image 0, effect i
+	**     runs in subpass i + 1 reading the previous image as an input
+	**     attachment and the last one writes the target. The post images are
+	**     neither loaded nor stored: only the target leaves the tile.
+	**   POST_SEPARATE: the baseline, the scene pass stores post image 0 and
+	**     each effect is a pass of its own loading its input and storing its
+	**     output.
+	** The scene subpass is multisampled with MSAA (see multisampleScene).
+	** postBytesPerPixel adds up the memory traffic of the chosen passes.
+	*/
+	void	createRenderPass()
+	{
+		vector<VkAttachmentDescription>	attachments;
+		vector<VkSubpassDescription>	subpasses;
+		vector<VkSubpassDependency>		dependencies;
+		VkAttachmentReference			colorRefs[1 + POST_EFFECT_COUNT];
+		VkAttachmentReference			inputRefs[POST_EFFECT_COUNT];
+		VkAttachmentReference			resolveRef;
+		VkFormat						targetFormat;
+		uint32_t						last;
+
+		/*One render pass and pipeline for all the views*/
+		for (const View &view : views)
+			if (view.swapChainImageFormat != views[0].swapChainImageFormat)
+				throw runtime_error("Views with different surface formats are not supported!");
+		targetFormat = views[0].swapChainImageFormat;
+		colorRefs[0] = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		subpasses.push_back(subpassDescription(NULL, &colorRefs[0]));
+		if (postMode == POST_NONE)
+		{
+			attachments.push_back(attachmentDescription(targetFormat, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE,
+				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)); // upscaled into the swapchain
+			// The previous blit must be done reading the target before it is cleared
+			dependencies.push_back(subpassDependency(VK_SUBPASS_EXTERNAL, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+			// and the blit reads what the subpass wrote
+			dependencies.push_back(subpassDependency(0, VK_SUBPASS_EXTERNAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT));
+			multisampleScene(attachments, dependencies, subpasses[0], colorRefs[0], resolveRef);
+			renderPass = buildRenderPass(attachments, subpasses, dependencies, "renderPass");
+			renderPassAttachments = (uint32_t)attachments.size();
+			postBytesPerPixel = passBytesPerPixel(attachments);
+		}
+		else if (postMode == POST_SUBPASSES)
+		{
+			attachments.push_back(attachmentDescription(postColorFormat, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+			attachments.push_back(attachmentDescription(postColorFormat, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+			attachments.push_back(attachmentDescription(targetFormat, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE,
+				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+			last = POST_EFFECT_COUNT;
+			for (uint32_t effect = 0; effect < POST_EFFECT_COUNT; effect++)
+			{
+				inputRefs[effect] = { effect % 2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+				colorRefs[effect + 1] = { (effect + 1 == last) ? 2 : (effect + 1) % 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+				subpasses.push_back(subpassDescription(&inputRefs[effect], &colorRefs[effect + 1]));
+				// Reads what the previous subpass wrote, and overwrites what the one before read
+				dependencies.push_back(subpassDependency(effect, effect + 1,
+					VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+					VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+					VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+			}
+			// The previous frame must be done with the post images and the blit with the target
+			dependencies.push_back(subpassDependency(VK_SUBPASS_EXTERNAL, 0,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+			dependencies.push_back(subpassDependency(VK_SUBPASS_EXTERNAL, last, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+			dependencies.push_back(subpassDependency(last, VK_SUBPASS_EXTERNAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT));
+			multisampleScene(attachments, dependencies, subpasses[0], colorRefs[0], resolveRef);
+			renderPass = buildRenderPass(attachments, subpasses, dependencies, "renderPass");
+			renderPassAttachments = (uint32_t)attachments.size();
+			postBytesPerPixel = passBytesPerPixel(attachments);
+		}
+		else
+		{
+			attachments.push_back(attachmentDescription(postColorFormat, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE,
+				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+			dependencies.push_back(subpassDependency(VK_SUBPASS_EXTERNAL, 0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+			dependencies.push_back(subpassDependency(0, VK_SUBPASS_EXTERNAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT));
+			multisampleScene(attachments, dependencies, subpasses[0], colorRefs[0], resolveRef);
+			renderPass = buildRenderPass(attachments, subpasses, dependencies, "renderPass");
+			renderPassAttachments = (uint32_t)attachments.size();
+			postBytesPerPixel = passBytesPerPixel(attachments);
+
+			// Effect passes: attachment 0 is the input, 1 the output
+			inputRefs[0] = { 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			colorRefs[1] = { 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+			subpasses.assign(1, subpassDescription(&inputRefs[0], &colorRefs[1]));
+			dependencies.clear();
+			dependencies.push_back(subpassDependency(VK_SUBPASS_EXTERNAL, 0,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+			dependencies.push_back(subpassDependency(0, VK_SUBPASS_EXTERNAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT));
+			for (last = 0; last < 2; last++)
+			{
+				attachments.clear();
+				attachments.push_back(attachmentDescription(postColorFormat, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_DONT_CARE,
+					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+				if (last)
+					attachments.push_back(attachmentDescription(targetFormat, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE,
+						VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+				else
+					attachments.push_back(attachmentDescription(postColorFormat, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE,
+						VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+				postPasses[last] = buildRenderPass(attachments, subpasses, dependencies, last ? "postPass (last)" : "postPass");
+				postBytesPerPixel += passBytesPerPixel(attachments) * (last ? 1 : POST_EFFECT_COUNT - 1);
+			}
+		}
+	}
+
+	void	destroyRenderPasses()
+	{
+		vkDestroyRenderPass(device, renderPass, hostAllocator.callbacks());
+		for (VkRenderPass &pass : postPasses)
+		{
+			vkDestroyRenderPass(device, pass, hostAllocator.callbacks());
+			pass = VK_NULL_HANDLE;
+		}
+	}
+
+	/*
+	** targetFramebuffer is the one of renderPass, the multisample target last
+	** with MSAA. With separate post passes
+	** postFramebuffers has one per effect, writing the next post image or,
+	** for the last one, the target.
+	*/
+	void createFramebuffers(View &view)
+	{
+		VkFramebufferCreateInfo		framebufferInfo = {};
+		VkImageView					attachments[4];
+		VkFramebuffer				framebuffer;
+
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = renderPass;
+		framebufferInfo.pAttachments = attachments;
+		framebufferInfo.width = view.swapChainExtent.width;
+		framebufferInfo.height = view.swapChainExtent.height;
+		framebufferInfo.layers = 1;
+		if (postMode == POST_SUBPASSES)
+		{
+			attachments[0] = view.postImageViews[0];
+			attachments[1] = view.postImageViews[1];
+			attachments[2] = view.targetImageView;
+			framebufferInfo.attachmentCount = 3;
+		}
+		else
+		{
+			attachments[0] = (postMode == POST_NONE) ? view.targetImageView : view.postImageViews[0];
+			framebufferInfo.attachmentCount = 1;
+		}
+		if (msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+			attachments[framebufferInfo.attachmentCount++] = view.msaaImageView;
+
+		if (vkCreateFramebuffer(device, &framebufferInfo, hostAllocator.callbacks(), &view.targetFramebuffer) != VK_SUCCESS)
+			throw runtime_error("Failed to create framebuffer!");
+		trace.framebuffer(objectHandle(view.targetFramebuffer), framebufferInfo);
+		setObjectName(VK_OBJECT_TYPE_FRAMEBUFFER, view.targetFramebuffer, view.name + "targetFramebuffer");
+		if (postMode == POST_NONE)
+			return;
+		updatePostInputs(view);
+		if (postMode != POST_SEPARATE)
+			return;
+		framebufferInfo.attachmentCount = 2;
+		for (uint32_t effect = 0; effect < POST_EFFECT_COUNT; effect++)
+		{
+			framebufferInfo.renderPass = postPasses[effect == POST_EFFECT_COUNT - 1];
+			attachments[0] = view.postImageViews[effect % 2];
+			attachments[1] = (effect == POST_EFFECT_COUNT - 1) ? view.targetImageView : view.postImageViews[(effect + 1) % 2];
+			if (vkCreateFramebuffer(device, &framebufferInfo, hostAllocator.callbacks(), &framebuffer) != VK_SUCCESS)
+				throw runtime_error("Failed to create framebuffer!");
+			trace.framebuffer(objectHandle(framebuffer), framebufferInfo);
+			view.postFramebuffers.push_back(framebuffer);
+			setObjectName(VK_OBJECT_TYPE_FRAMEBUFFER, framebuffer, view.name + "postFramebuffer[" + to_string(effect) + "]");
+		}
+	}
+
+	void	createCommandPool()
+	{
+		QueueFamilyIndices			queueFamilyIndices;
+		VkCommandPoolCreateInfo		poolInfo = {};
+
+		queueFamilyIndices = queueIndices;
 		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
-		poolInfo.flags = 0; // Optional
-		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // re-recorded every frame
+		if (vkCreateCommandPool(device, &poolInfo, hostAllocator.callbacks(), &commandPool) != VK_SUCCESS)
 			throw runtime_error("Failed to create command pool!");
+		setObjectName(VK_OBJECT_TYPE_COMMAND_POOL, commandPool, "commandPool");
+		poolInfo.queueFamilyIndex = (queueFamilyIndices.transferFamily >= 0) ? queueFamilyIndices.transferFamily : queueFamilyIndices.graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		if (vkCreateCommandPool(device, &poolInfo, hostAllocator.callbacks(), &transferCommandPool) != VK_SUCCESS)
+			throw runtime_error("Failed to create transfer command pool!");
+		setObjectName(VK_OBJECT_TYPE_COMMAND_POOL, transferCommandPool, "transferCommandPool");
 	}
 
-	void	createCommandBuffers()
+	void	createCommandBuffers(View &view)
 	{
-		VkRect2D						scissor = {};
-		VkViewport						viewport = {};
-		VkClearValue					clearColor;
 		VkCommandBufferAllocateInfo		allocInfo = {};
-		VkCommandBufferBeginInfo		beginInfo = {};
-		VkRenderPassBeginInfo			renderPassInfo = {};
 
-		commandBuffers.resize(swapChainFramebuffers.size());
+		view.commandBuffers.resize(view.swapChainImages.size());
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		allocInfo.commandPool = commandPool;
 		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
+		allocInfo.commandBufferCount = (uint32_t)view.commandBuffers.size();
 
-		if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
+		if (vkAllocateCommandBuffers(device, &allocInfo, view.commandBuffers.data()) != VK_SUCCESS)
 			throw runtime_error("Failed to allocate command buffers!");
+		for (size_t i = 0; i < view.commandBuffers.size(); i++)
+			setObjectName(VK_OBJECT_TYPE_COMMAND_BUFFER, view.commandBuffers[i], view.name + "commandBuffer[" + to_string(i) + "]");
+	}
 
-		for (size_t i = 0; i < commandBuffers.size(); i++)
+	/*
+	** The effects of the post chain on renderExtent pixels, a fullscreen
+	** triangle each: in the next subpasses of renderPass (which must be in
+	** its scene subpass) or in their own render passes after it. Traced into
+	** view.traceCommands during a capture.
+	*/
+	void	recordPostEffects(VkCommandBuffer commandBuffer, View &view)
+	{
+		TraceCommands			*traced;
+		VkRenderPassBeginInfo	renderPassInfo = {};
+		VkViewport				viewport = {};
+		VkRect2D				scissor = {};
+		PostPushConstants		pushConstants;
+
+		viewport.width = (float)view.renderExtent.width;
+		viewport.height = (float)view.renderExtent.height;
+		viewport.maxDepth = 1.0f;
+		scissor.extent = view.renderExtent;
+		pushConstants.inverseExtent[0] = 1.0f / view.renderExtent.width;
+		pushConstants.inverseExtent[1] = 1.0f / view.renderExtent.height;
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderArea = scissor;
+		traced = trace.capturing() ? &view.traceCommands : NULL;
+		for (uint32_t effect = 0; effect < POST_EFFECT_COUNT; effect++)
 		{
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-			beginInfo.pInheritanceInfo = NULL; // Optional
-
-			vkBeginCommandBuffer(commandBuffers[i], &beginInfo);
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassInfo.renderPass = renderPass;
-			renderPassInfo.framebuffer = swapChainFramebuffers[i];
-			renderPassInfo.renderArea.offset = { 0, 0 };
-			renderPassInfo.renderArea.extent = swapChainExtent;
-			clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-			renderPassInfo.clearValueCount = 1;
-			renderPassInfo.pClearValues = &clearColor;
-
+			if (postMode == POST_SUBPASSES)
+				vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+			else
 			{
-				viewport.x = 0.0f;
-				viewport.y = 0.0f;
-				viewport.width = (float)swapChainExtent.width;
-				viewport.height = (float)swapChainExtent.height;
-				viewport.minDepth = 0.0f;
-				viewport.maxDepth = 1.0f;
-				scissor.offset = { 0, 0 };
-				scissor.extent = swapChainExtent;
+				renderPassInfo.renderPass = postPasses[effect == POST_EFFECT_COUNT - 1];
+				renderPassInfo.framebuffer = view.postFramebuffers[effect];
+				vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 			}
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, postPipelines[effect]);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, postPipelineLayout, 0, 1, &view.postInputs[effect % 2], 0, NULL);
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			vkCmdPushConstants(commandBuffer, postPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+			vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+			if (postMode == POST_SEPARATE)
+				vkCmdEndRenderPass(commandBuffer);
+			if (!traced)
+				continue;
+			if (postMode == POST_SUBPASSES)
+				traced->nextSubpass();
+			else
+				traced->beginRenderPass(renderPassInfo);
+			traced->bindPipeline(objectHandle(postPipelines[effect]));
+			traced->bindDescriptorSet(objectHandle(postPipelineLayout), objectHandle(view.postInputs[effect % 2]));
+			traced->setViewport(viewport);
+			traced->setScissor(scissor);
+			traced->pushConstants(objectHandle(postPipelineLayout), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+			traced->draw(3, 1, 0, 0);
+			if (postMode == POST_SEPARATE)
+				traced->endRenderPass();
+		}
+	}
 
-			vkCmdSetViewport(commandBuffers[i], 0, 1, &viewport);
-			vkCmdSetScissor(commandBuffers[i], 0, 1, &scissor);
+	/*
+	** Primary command buffer of a frame: timestamps around a render pass that
+	** executes the secondary command buffers recorded by the tasks, then the
+	** post effects, rendering renderExtent pixels of the offscreen target, and
+	** the blit upscaling them to the whole swapchain image.
+	*/
+	void	recordCommandBuffer(View &view)
+	{
+		VkCommandBuffer					commandBuffer;
+		VkClearValue					clearColors[4];
+		VkCommandBufferBeginInfo		beginInfo = {};
+		VkRenderPassBeginInfo			renderPassInfo = {};
+		VkImageMemoryBarrier			barrier = {};
+		VkImageBlit						blit = {};
+		vector<VkCommandBuffer>			secondaries;
+
+		commandBuffer = view.commandBuffers[view.imageIndex];
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = NULL; // Optional
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+			throw runtime_error("Failed to begin recording command buffer!");
+
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = view.targetFramebuffer;
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = view.renderExtent;
+		for (VkClearValue &clearColor : clearColors)
+			clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
+		renderPassInfo.clearValueCount = renderPassAttachments;
+		renderPassInfo.pClearValues = clearColors;
 
-			vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		for (const FrameChunk &chunk : frameChunks)
+			secondaries.push_back(chunk.commandBuffers[view.index]);
 
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-			vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-			vkCmdEndRenderPass(commandBuffers[i]);
-			if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
-				throw runtime_error("Failed to record command buffer!");
+		if (view.timestampPool != VK_NULL_HANDLE)
+		{
+			vkCmdResetQueryPool(commandBuffer, view.timestampPool, 2 * view.imageIndex, 2);
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, view.timestampPool, 2 * view.imageIndex);
+		}
+		if (view.statisticsPool != VK_NULL_HANDLE)
+		{
+			// Begun and ended by the secondaries, around the scene draws (see recordDraws)
+			vkCmdResetQueryPool(commandBuffer, view.statisticsPool, view.counterSlot * view.counterChunks, (uint32_t)frameChunks.size());
+			vkCmdResetQueryPool(commandBuffer, view.occlusionPool, view.counterSlot * view.counterChunks, (uint32_t)frameChunks.size());
+		}
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		vkCmdExecuteCommands(commandBuffer, (uint32_t)secondaries.size(), secondaries.data());
+		if (trace.capturing())
+		{
+			view.traceCommands.clear();
+			view.traceCommands.beginRenderPass(renderPassInfo);
+			for (const FrameChunk &chunk : frameChunks)
+				view.traceCommands.execute(chunk.traceCommands[view.index]);
+		}
+		if (postMode == POST_SUBPASSES)
+			recordPostEffects(commandBuffer, view);
+		vkCmdEndRenderPass(commandBuffer);
+		if (trace.capturing())
+			view.traceCommands.endRenderPass();
+		if (postMode == POST_SEPARATE)
+			recordPostEffects(commandBuffer, view);
+
+		/*Upscale into the swapchain image*/ {
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = view.swapChainImages[view.imageIndex];
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			// Chained to the acquire semaphore, waited at the transfer stage
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+			blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			blit.srcOffsets[1] = { (int32_t)view.renderExtent.width, (int32_t)view.renderExtent.height, 1 };
+			blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			blit.dstOffsets[1] = { (int32_t)view.swapChainExtent.width, (int32_t)view.swapChainExtent.height, 1 };
+			vkCmdBlitImage(commandBuffer, view.targetImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				view.swapChainImages[view.imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
 		}
+		if (view.timestampPool != VK_NULL_HANDLE)
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, view.timestampPool, 2 * view.imageIndex + 1);
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+			throw runtime_error("Failed to record command buffer!");
 	}
 
-	void	createSemaphores()
+	/*
+	** Timestamp precision of the graphics queue, once for the device.
+	** timestampMask stays 0 (no GPU utilization) if it can't time.
+	*/
+	void	queryTimestampSupport()
 	{
-		VkSemaphoreCreateInfo	semaphoreInfo = {};
+		uint32_t						queueFamilyCount;
+		uint32_t						validBits;
+		vector<VkQueueFamilyProperties>	queueFamilies;
+		VkPhysicalDeviceProperties		properties;
 
-		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS)
-			throw runtime_error("Failed to create semaphores!");
+		queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, NULL);
+		queueFamilies.resize(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		validBits = queueFamilies[queueIndices.graphicsFamily].timestampValidBits;
+		utilization.setGpuTimingSupported(validBits != 0);
+		timestampPeriod = properties.limits.timestampPeriod;
+		timestampMask = (validBits == 0) ? 0 : (validBits >= 64) ? ~0ull : (1ull << validBits) - 1;
 	}
 
-	void cleanupSwapChain()
+	/*
+	** Two timestamps per swapchain image, around its render pass. Left
+	** VK_NULL_HANDLE if the graphics queue can't time.
+	*/
+	void	createTimestampQueries(View &view)
 	{
-		for (size_t i = 0; i < swapChainFramebuffers.size(); i++)
-			vkDestroyFramebuffer(device, swapChainFramebuffers[i], NULL);
-		vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-		//vkDestroyPipeline(device, graphicsPipeline, NULL);
-		//vkDestroyPipelineLayout(device, pipelineLayout, NULL);
-		//vkDestroyRenderPass(device, renderPass, NULL);
-		for (size_t i = 0; i < swapChainImageViews.size(); i++)
-			vkDestroyImageView(device, swapChainImageViews[i], NULL);
-		vkDestroySwapchainKHR(device, swapChain, NULL);
+		VkQueryPoolCreateInfo			queryPoolInfo = {};
+
+		if (timestampMask == 0)
+			return;
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = (uint32_t)(2 * view.swapChainImages.size());
+		if (vkCreateQueryPool(device, &queryPoolInfo, hostAllocator.callbacks(), &view.timestampPool) != VK_SUCCESS)
+			throw runtime_error("Failed to create timestamp query pool!");
+		setObjectName(VK_OBJECT_TYPE_QUERY_POOL, view.timestampPool, view.name + "timestampPool");
 	}
 
-	void recreateSwapChain()
+	/*
+	** The subpass of the draws only executes secondary command buffers, so
+	** each of them runs its own counter queries: a frame's counters are the
+	** sum over the frame chunks. Without precise occlusion queries, samples
+	** passed is only "zero or not".
+	*/
+	void	queryCounterSupport()
 	{
-		//vkDeviceWaitIdle(device);
+		VkPhysicalDeviceFeatures	features;
 
-		cleanupSwapChain();
-		createSwapChain();
-		createImageViews();
-		//createRenderPass();
-		//createGraphicPipeline();
-		createFramebuffers();
-		createCommandBuffers();
+		if (!gpuCountersEnable)
+			return;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+		gpuCountersEnabled = (features.pipelineStatisticsQuery == VK_TRUE);
+		preciseOcclusion = (gpuCountersEnabled && features.occlusionQueryPrecise);
+		if (!gpuCountersEnabled)
+			logger.log(LOG_WARNING, "GPU counters: pipeline statistics queries not supported");
 	}
 
-	void	initVulkan()
+	/*
+	** GPU_COUNTER_FRAMES slots of pipeline statistics and occlusion queries,
+	** a query per frame chunk in each. There are at most as many chunks as
+	** hardware threads (createJobSystem). They don't depend on the swapchain:
+	** they live as long as the view.
+	*/
+	void	createCounterQueries(View &view)
 	{
-		//uint32_t	extensionCount = 0;
-		//vector<VkExtensionProperties> extensions;
+		VkQueryPoolCreateInfo			queryPoolInfo = {};
 
-		createInstance();
-		setupDebugCallback();
-		createSurface();
-		pickPhysicalDevice();
-		createLogicalDevice();
-		createSwapChain();
-		createImageViews();
-		createRenderPass();
-		createGraphicPipeline();
-		createFramebuffers();
-		createCommandPool();
-		createCommandBuffers();
-		createSemaphores();
-		/*
-		vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, NULL);
-		extensions.resize(extensionCount);
-		vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, extensions.data());
-		cout << "Available extensions:" << endl;
-		for (const VkExtensionProperties& extension : extensions)
+		if (!gpuCountersEnabled)
+			return;
+		view.counterChunks = max(1u, thread::hardware_concurrency());
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		queryPoolInfo.queryCount = GPU_COUNTER_FRAMES * view.counterChunks;
+		queryPoolInfo.pipelineStatistics = GPU_PIPELINE_STATISTICS;
+		if (vkCreateQueryPool(device, &queryPoolInfo, hostAllocator.callbacks(), &view.statisticsPool) != VK_SUCCESS)
+			throw runtime_error("Failed to create pipeline statistics query pool!");
+		queryPoolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+		queryPoolInfo.pipelineStatistics = 0;
+		if (vkCreateQueryPool(device, &queryPoolInfo, hostAllocator.callbacks(), &view.occlusionPool) != VK_SUCCESS)
+			throw runtime_error("Failed to create occlusion query pool!");
+		setObjectName(VK_OBJECT_TYPE_QUERY_POOL, view.statisticsPool, view.name + "statisticsPool");
+		setObjectName(VK_OBJECT_TYPE_QUERY_POOL, view.occlusionPool, view.name + "occlusionPool");
+		view.counterFrames = 0;
+	}
+
+	void	destroyCounterQueries(View &view)
+	{
+		if (view.statisticsPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(device, view.statisticsPool, hostAllocator.callbacks());
+		if (view.occlusionPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(device, view.occlusionPool, hostAllocator.callbacks());
+		view.statisticsPool = VK_NULL_HANDLE;
+		view.occlusionPool = VK_NULL_HANDLE;
+	}
+
+	/*
+	** Picks the slot the frame about to be recorded queries into, and
+	** collects what the frame GPU_COUNTER_FRAMES earlier left in it, summed
+	** over its chunks. Called before the frame graph records the draws. No
+	** wait: results that are not available yet are counted as missed.
+	*/
+	void	readGpuCounters(View &view)
+	{
+		uint64_t			values[GPU_COUNTER_COUNT] = {};
+		vector<uint64_t>	statistics;
+		vector<uint64_t>	samples;
+		uint32_t			first;
+		uint32_t			chunks;
+
+		if (view.statisticsPool == VK_NULL_HANDLE)
+			return;
+		view.counterSlot = (uint32_t)(view.counterFrames % GPU_COUNTER_FRAMES);
+		first = view.counterSlot * view.counterChunks;
+		chunks = view.slotChunks[view.counterSlot];
+		view.slotChunks[view.counterSlot] = (uint32_t)frameChunks.size();
+		if (view.counterFrames++ < GPU_COUNTER_FRAMES)
+			return;
+		statistics.resize(chunks * GPU_SAMPLES_PASSED);
+		samples.resize(chunks);
+		if (vkGetQueryPoolResults(device, view.statisticsPool, first, chunks, statistics.size() * sizeof(uint64_t), statistics.data(),
+				GPU_SAMPLES_PASSED * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS ||
+			vkGetQueryPoolResults(device, view.occlusionPool, first, chunks, samples.size() * sizeof(uint64_t), samples.data(),
+				sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
 		{
-			cout << "\t" << extension.extensionName << endl;
-		}*/
+			gpuCounters.missFrame();
+			return;
+		}
+		for (uint32_t chunk = 0; chunk < chunks; chunk++)
+		{
+			for (int counter = 0; counter < GPU_SAMPLES_PASSED; counter++)
+				values[counter] += statistics[chunk * GPU_SAMPLES_PASSED + counter];
+			values[GPU_SAMPLES_PASSED] += samples[chunk];
+		}
+		gpuCounters.addFrame(values);
 	}
 
-	void drawFrame()
+	/*
+	** GPU time of the last frame rendered into the view, 0 if not available.
+	** Recorded on the view's GPU track during a profiler capture.
+	*/
+	uint64_t	readFrameGpuTime(const View &view)
 	{
-		VkResult				result;
-		uint32_t				imageIndex;
-		VkSemaphore				waitSemaphores[1];
-		VkSubmitInfo			submitInfo = {};
-		VkSemaphore				signalSemaphores[1];
-		VkPresentInfoKHR		presentInfo = {};
-		VkPipelineStageFlags	waitStages[1];
-		VkSwapchainKHR			swapChains[1];
-
-		result = vkAcquireNextImageKHR(device, swapChain, numeric_limits<uint64_t>::max(), imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-		if (result == VK_ERROR_OUT_OF_DATE_KHR)
-		{
-			recreateSwapChain();
+		uint64_t	timestamps[2];
+		uint64_t	durationNs;
+		int64_t		startNs;
+
+		if (view.timestampPool == VK_NULL_HANDLE)
+			return (0);
+		if (vkGetQueryPoolResults(device, view.timestampPool, 2 * view.imageIndex, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+			return (0);
+		durationNs = (uint64_t)(((timestamps[1] - timestamps[0]) & timestampMask) * (double)timestampPeriod);
+		if (Profiler::enabled())
+		{
+			startNs = gpuClockOffsetNs + (int64_t)((timestamps[0] & timestampMask) * (double)timestampPeriod);
+			Profiler::record("render pass + upscale", startNs, startNs + (int64_t)durationNs, view.profileTrack);
+		}
+		return (durationNs);
+	}
+
+	/*
+	** gpuClockOffsetNs: a timestamp written at the top of the pipe of an
+	** otherwise empty submission, against the middle of the CPU time spent
+	** submitting and waiting for it. Approximate (within the submission
+	** latency) but enough to line the GPU zones up with the CPU ones.
+	*/
+	void	calibrateGpuClock()
+	{
+		VkQueryPoolCreateInfo	queryPoolInfo = {};
+		VkQueryPool				queryPool;
+		VkCommandBuffer			commandBuffer;
+		uint64_t				timestamp;
+		int64_t					before;
+		int64_t					after;
+
+		if (timestampMask == 0)
+			return;
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = 1;
+		if (vkCreateQueryPool(device, &queryPoolInfo, hostAllocator.callbacks(), &queryPool) != VK_SUCCESS)
+			throw runtime_error("Failed to create timestamp query pool!");
+		commandBuffer = beginSingleTimeCommands(commandPool);
+		vkCmdResetQueryPool(commandBuffer, queryPool, 0, 1);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+		before = Profiler::nowNs();
+		endSingleTimeCommands(commandBuffer, commandPool, graphicsTimeline);
+		after = Profiler::nowNs();
+		if (vkGetQueryPoolResults(device, queryPool, 0, 1, sizeof(timestamp), &timestamp, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS)
+			gpuClockOffsetNs = (before + after) / 2 - (int64_t)((timestamp & timestampMask) * (double)timestampPeriod);
+		vkDestroyQueryPool(device, queryPool, hostAllocator.callbacks());
+	}
+
+	/*
+	** Starts a profiler capture, or stops the current one and writes it to
+	** path (Chrome trace JSON, see Profiler.h).
+	*/
+	void	toggleProfileCapture(const char *path)
+	{
+		size_t	events;
+		size_t	dropped;
+
+		if (!Profiler::enabled())
+		{
+			calibrateGpuClock();
+			Profiler::start();
+			logger.log(LOG_INFO, "Profiler: capture started");
 			return;
 		}
-		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
-			throw runtime_error("Failed to acquire swapchain image!");
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		waitSemaphores[0] = imageAvailableSemaphore;
-		waitStages[0] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = waitSemaphores;
-		submitInfo.pWaitDstStageMask = waitStages;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
-		signalSemaphores[0] = renderFinishedSemaphore;
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = signalSemaphores;
-		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
-			throw runtime_error("Failed to submit draw command buffer!");
-
-		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-		presentInfo.waitSemaphoreCount = 1;
-		presentInfo.pWaitSemaphores = signalSemaphores;
-		swapChains[0] = swapChain;
-		presentInfo.swapchainCount = 1;
-		presentInfo.pSwapchains = swapChains;
-		presentInfo.pImageIndices = &imageIndex;
-		presentInfo.pResults = NULL; // Optional
-
-		result = vkQueuePresentKHR(presentQueue, &presentInfo);
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
-			recreateSwapChain();
-		else if (result != VK_SUCCESS)
-			throw runtime_error("Failed to present swap chain image!");
-		vkQueueWaitIdle(presentQueue);
+		Profiler::stop();
+		events = Profiler::write(path, &dropped);
+		if (events == 0)
+			logger.log(LOG_WARNING, "Profiler: nothing written to %s", path);
+		else
+			logger.log(LOG_INFO, "Profiler: %u events written to %s (%u dropped)", (unsigned)events, path, (unsigned)dropped);
 	}
 
-	void	mainLoop()
+	/*
+	** _CAPTURE_TRACE: records everything created from the device on, and the
+	** frames submitted, until traceCaptureFrames (see Trace.h).
+	*/
+	void	startTraceCapture()
 	{
-		int	fps;
-		double	curentTime;
-		double  lastTime;
+		VkPhysicalDeviceProperties	properties;
+
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		trace.open(traceCapturePath, properties);
+		logger.log(LOG_INFO, "Trace: capturing %u frames to %s", (unsigned)traceCaptureFrames, traceCapturePath);
+	}
+
+	void	stopTraceCapture()
+	{
+		uint64_t	frames;
+
+		frames = trace.frames();
+		if (!trace.close())
+			logger.log(LOG_WARNING, "Trace: failed to write %s", traceCapturePath);
+		else
+			logger.log(LOG_INFO, "Trace: %u frames written to %s (%.1fMB)", (unsigned)frames, traceCapturePath, trace.bytesWritten() / (1024.0 * 1024.0));
+	}
+
+	/*
+	** One worker less than the cores: the render thread runs tasks too while
+	** it waits for the frame graph.
+	*/
+	void	createJobSystem(unsigned threads)
+	{
+		jobs.reset(new JobSystem(max(1u, threads) - 1));
+	}
+
+	/*
+	** The scene is drawn straight in NDC (no camera). An object covers
+	** 0.5 * vertexScale * scale around its position, the triangle as well as
+	** the mesh fitted to it: that's its bounding sphere.
+	*/
+	void	initScene(size_t count, float minScale = 0.03f, float maxScale = 0.1f)
+	{
+		mt19937									random(42);
+		mt19937									materialRandom(7);
+		uniform_int_distribution<uint32_t>		material(0, sceneMaterials - 1);
+		uniform_real_distribution<float>		position(-1.5f, 1.5f);
+		uniform_real_distribution<float>		velocity(-0.5f, 0.5f);
+		uniform_real_distribution<float>		scale(minScale, maxScale);
+		const glm::quat							identity(1.0f, 0.0f, 0.0f, 0.0f);
+
+		scene.resize(count);
+		sceneObjects.resize(count);
+		for (size_t i = 0; i < count; i++)
+			scene.setBounds(i, glm::vec3(0.0f), 0.5f * shaderConstants.vertexScale);
+		if (count == 1)
+		{
+			// The original triangle, drifting once animated
+			scene.setTransform(0, glm::vec3(0.0f), identity, 1.0f);
+			sceneObjects[0] = { { 0.2f, 0.13f }, 0, 0 };
+			return;
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			scene.setTransform(i, glm::vec3(position(random), position(random), 0.0f), identity, scale(random));
+			sceneObjects[i] = { { velocity(random), velocity(random) }, 0, material(materialRandom) };
+		}
+	}
+
+	/*
+	** Material m > 0 is graphicsPipeline with the color mode m steps further:
+	** a pipeline per material, the state the draw sort keys group.
+	*/
+	void	createMaterialPipelines()
+	{
+		ShaderConstants		constants;
+
+		materialPipelines.resize(sceneMaterials - 1);
+		for (uint32_t material = 1; material < sceneMaterials; material++)
+		{
+			constants = shaderConstants;
+			constants.colorMode = (shaderConstants.colorMode + (int32_t)material) % 3;
+			createGraphicPipeline(materialPipelines[material - 1], constants);
+		}
+	}
+
+	void	destroyMaterialPipelines()
+	{
+		for (VkPipeline pipeline : materialPipelines)
+			vkDestroyPipeline(device, pipeline, hostAllocator.callbacks());
+		materialPipelines.clear();
+	}
+
+	VkPipeline	materialPipeline(uint32_t material) const
+	{
+		return (material ? materialPipelines[material - 1] : graphicsPipeline);
+	}
+
+	/*
+	** Spreads the objects over count materials (1 to sceneMaterialMax) and
+	** rebuilds their pipelines. The current frame state is prepared again:
+	** its keys may name a pipeline that's gone.
+	*/
+	void	setSceneMaterials(uint32_t count)
+	{
+		mt19937								random(7);
+		uniform_int_distribution<uint32_t>	material(0, count - 1);
+
+		vkDeviceWaitIdle(device);
+		destroyMaterialPipelines();
+		sceneMaterials = count;
+		createMaterialPipelines();
+		for (SceneObject &object : sceneObjects)
+			object.material = (sceneObjects.size() == 1) ? 0 : material(random);
+		primeFrameState();
+	}
+
+	void	createFrameChunks()
+	{
+		QueueFamilyIndices				indices;
+		VkCommandPoolCreateInfo			poolInfo = {};
+		VkCommandBufferAllocateInfo		allocInfo = {};
+
+		indices = queueIndices;
+		frameChunks.resize(jobs->workerCount() + 1);
+		for (size_t i = 0; i < frameChunks.size(); i++)
+		{
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.queueFamilyIndex = indices.graphicsFamily;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			if (vkCreateCommandPool(device, &poolInfo, hostAllocator.callbacks(), &frameChunks[i].commandPool) != VK_SUCCESS)
+				throw runtime_error("Failed to create frame chunk command pool!");
+			frameChunks[i].commandBuffers.resize(views.size());
+			frameChunks[i].traceCommands.resize(views.size());
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = frameChunks[i].commandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = (uint32_t)views.size();
+			if (vkAllocateCommandBuffers(device, &allocInfo, frameChunks[i].commandBuffers.data()) != VK_SUCCESS)
+				throw runtime_error("Failed to allocate frame chunk command buffer!");
+			setObjectName(VK_OBJECT_TYPE_COMMAND_POOL, frameChunks[i].commandPool, "frameChunkPool[" + to_string(i) + "]");
+			for (const View &view : views)
+				setObjectName(VK_OBJECT_TYPE_COMMAND_BUFFER, frameChunks[i].commandBuffers[view.index], view.name + "frameChunkCommandBuffer[" + to_string(i) + "]");
+		}
+		for (FrameState &state : frameStates)
+		{
+			state.draws.assign(frameChunks.size(), vector<SceneDraw>());
+			state.queues.assign(frameChunks.size(), DrawQueue());
+			state.objectOrderBinds.assign(frameChunks.size(), 0);
+			state.visible = 0;
+			state.triangles = 0;
+			state.lodSwitches = 0;
+		}
+	}
+
+	void	destroyFrameChunks()
+	{
+		for (FrameChunk &chunk : frameChunks)
+			vkDestroyCommandPool(device, chunk.commandPool, hostAllocator.callbacks());
+		frameChunks.clear();
+	}
+
+	void	chunkRange(size_t chunk, size_t &begin, size_t &end) const
+	{
+		scene.chunkRange(chunk, frameChunks.size(), begin, end);
+	}
+
+	FrameState	&currentFrameState()
+	{
+		return (frameStates[frameIndex & 1]);
+	}
+
+	FrameState	&nextFrameState()
+	{
+		return (frameStates[(frameIndex + 1) & 1]);
+	}
 
-		fps = 0;
-		lastTime = glfwGetTime();
-		while (!glfwWindowShouldClose(window))
+	/*
+	** Frame stages, each called on one chunk of the scene from a task.
+	*/
+	void	updateScene(size_t chunk)
+	{
+		float		*position[2];
+		size_t		begin;
+		size_t		end;
+
+		chunkRange(chunk, begin, end);
+		position[0] = scene.field(SCENE_POSITION_X);
+		position[1] = scene.field(SCENE_POSITION_Y);
+		for (size_t i = begin; i < end; i++)
 		{
-			curentTime = glfwGetTime();
-			if (curentTime - lastTime > 1.0)
+			for (int axis = 0; axis < 2; axis++)
 			{
-				lastTime = curentTime;
-				cout << fps << " FPS" << endl;
-				fps = 0;
+				position[axis][i] += sceneObjects[i].velocity[axis] * simulationDt;
+				// Wrap around a region larger than the screen, so culling has work
+				if (position[axis][i] > 1.5f)
+					position[axis][i] -= 3.0f;
+				else if (position[axis][i] < -1.5f)
+					position[axis][i] += 3.0f;
 			}
-			glfwPollEvents();
-			drawFrame();
-			fps++;
 		}
-		vkDeviceWaitIdle(device);
+		scene.updateWorld(begin, end);
 	}
 
-	void	cleanup()
+	void	cullScene(size_t chunk)
 	{
-		vkDestroySemaphore(device, renderFinishedSemaphore, NULL);
-		vkDestroySemaphore(device, imageAvailableSemaphore, NULL);
-		
-		cleanupSwapChain();
+		const SceneFrustum	screen = sceneFrustum(glm::mat4(1.0f));
+		size_t				begin;
+		size_t				end;
 
-		vkDestroyPipeline(device, graphicsPipeline, NULL);
-		vkDestroyPipelineLayout(device, pipelineLayout, NULL);
-		vkDestroyRenderPass(device, renderPass, NULL);
+		chunkRange(chunk, begin, end);
+		frameChunks[chunk].visible.clear();
+		scene.cull(screen, begin, end, &frameChunks[chunk].visible);
+	}
 
-		vkDestroyCommandPool(device, commandPool, NULL);
-		
-		vkDestroyDevice(device, NULL);
-		DestroyDebugReportCallbackEXT(instance, callback, NULL);
-		vkDestroySurfaceKHR(instance, surface, NULL);
-		vkDestroyInstance(instance, NULL);
+	/*
+	** Pixels per object space unit of the scene mesh at object scale 1, for
+	** the LOD selection of the next frame. The bounding sphere is drawn with
+	** a 0.5 * vertexScale radius in NDC, the tallest rendered view maps the
+	** 2 NDC units of the height to its pixels.
+	*/
+	void	updateLodPixelScale()
+	{
+		uint32_t	height;
+
+		height = 0;
+		for (size_t i = 0; i < activeViews; i++)
+			height = max(height, views[i].renderExtent.height);
+		lodPixelScale = sceneMesh.loaded() ? 0.25f * shaderConstants.vertexScale * height * lodBias / sceneMesh.radius : 0.0f;
+	}
+
+	/*
+	** Coarsest LOD of the scene mesh whose error stays under lodPixelError
+	** pixels at pixelsPerUnit. Around each threshold there is a band of
+	** lodBandWidth: an object only moves to a coarser LOD once it is clearly
+	** under it and back once clearly over, so a size hovering on a threshold
+	** (dynamic resolution steps, slow zoom) doesn't pop every frame.
+	*/
+	uint32_t	selectLod(uint32_t current, float pixelsPerUnit) const
+	{
+		const vector<MeshLod>	&lods = sceneMesh.lods;
+		uint32_t				lod;
+
+		lod = min(current, (uint32_t)lods.size() - 1);
+		while (lod > 0 && lods[lod].error * pixelsPerUnit > lodPixelError * (1.0f + lodBandWidth))
+			lod--;
+		while (lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerUnit < lodPixelError * (1.0f - lodBandWidth))
+			lod++;
+		return (lod);
+	}
+
+	/*
+	** A mesh is fitted to the triangle's extent: its bounding sphere is
+	** scaled to a 0.5 radius and centered on the object, folded into the
+	** push constants (mesh.vert applies the y flip). Each object draws the
+	** LOD matching its size on screen.
+	**
+	** Every draw gets a packet in the chunk's queue, keyed on its pipeline
+	** (the object's material) then on the mesh buffers it binds, 0 for the
+	** triangle. The scene has no depth buffer: the depth bits keep the
+	** object order, the order the draws overlap in. The binds the draws take
+	** in that order are counted too: what the sort saves is measured on them.
+	*/
+	void	prepareDraws(size_t chunk, FrameState &state)
+	{
+		vector<SceneDraw>	&draws = state.draws[chunk];
+		DrawQueue			&queue = state.queues[chunk];
+		FrameChunk			&frameChunk = frameChunks[chunk];
+		const float			*scale = scene.field(SCENE_SCALE);
+		const float			*offset[2] = { scene.field(SCENE_WORLD_03), scene.field(SCENE_WORLD_13) };
+		size_t				&objectOrderBinds = state.objectOrderBinds[chunk];
+		SceneDraw			draw;
+		float				meshScale;
+		uint32_t			lod;
+		uint64_t			key;
+		uint32_t			boundPipeline;
+		uint32_t			boundMesh;
+
+		draws.clear();
+		queue.clear();
+		objectOrderBinds = 0;
+		boundPipeline = ~0u;
+		boundMesh = ~0u;
+		frameChunk.triangles = 0;
+		frameChunk.lodSwitches = 0;
+		draw.constants.colorMode = shaderConstants.colorMode;
+		draw.firstIndex = 0;
+		draw.indexCount = 3;
+		meshScale = sceneMesh.loaded() ? 0.5f / sceneMesh.radius : 1.0f;
+		for (uint32_t index : frameChunk.visible)
+		{
+			SceneObject	&object = sceneObjects[index];
+
+			draw.constants.scale = scale[index] * meshScale;
+			draw.constants.offset[0] = offset[0][index];
+			draw.constants.offset[1] = offset[1][index];
+			if (sceneMesh.loaded())
+			{
+				draw.constants.offset[0] -= sceneMesh.center[0] * draw.constants.scale * shaderConstants.vertexScale;
+				draw.constants.offset[1] += sceneMesh.center[1] * draw.constants.scale * shaderConstants.vertexScale;
+				lod = lodEnabled ? selectLod(object.lod, scale[index] * lodPixelScale) : 0;
+				frameChunk.lodSwitches += (lod != object.lod);
+				object.lod = lod;
+				draw.firstIndex = sceneMesh.lods[lod].indexOffset;
+				draw.indexCount = sceneMesh.lods[lod].indexCount;
+			}
+			frameChunk.triangles += draw.indexCount / 3;
+			// A material is a pipeline (materialPipeline), the one mesh is 1
+			key = drawKey(0, object.material, sceneMesh.loaded() ? 1 : 0, index);
+			objectOrderBinds += (drawKeyPipeline(key) != boundPipeline) + ((drawKeyMesh(key) != boundMesh && drawKeyMesh(key)) ? 2 : 0);
+			boundPipeline = drawKeyPipeline(key);
+			boundMesh = drawKeyMesh(key);
+			queue.push(key, (uint32_t)draws.size());
+			draws.push_back(draw);
+		}
+		if (drawSortEnabled)
+			queue.sort();
+	}
+
+	/*
+	** Records the chunk's draws once per acquired view, each view has its
+	** own framebuffer and viewport. The draws come in queue order and a
+	** pipeline or mesh is only bound when it differs from the last one.
+	*/
+	void	recordDraws(size_t chunk, const FrameState &state)
+	{
+		VkCommandBuffer						commandBuffer;
+		VkRect2D							scissor = {};
+		VkViewport							viewport = {};
+		VkCommandBufferBeginInfo			beginInfo = {};
+		VkCommandBufferInheritanceInfo		inheritanceInfo = {};
+		const VkDeviceSize					vertexOffset = 0;
+		FrameChunk							&frameChunk = frameChunks[chunk];
+		uint32_t							boundPipeline;
+		uint32_t							boundMesh;
+		uint32_t							pipeline;
+		uint32_t							mesh;
+		size_t								viewBinds;
+
+		vkResetCommandPool(device, frameChunk.commandPool, 0);
+		frameChunk.binds = 0;
+		frameChunk.bindsAvoided = 0;
+		for (size_t i = 0; i < activeViews; i++)
+		{
+			const View	&view = views[i];
+
+			if (!view.acquired)
+				continue;
+			commandBuffer = frameChunk.commandBuffers[view.index];
+			inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritanceInfo.renderPass = renderPass;
+			inheritanceInfo.subpass = 0;
+			inheritanceInfo.framebuffer = view.targetFramebuffer;
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			beginInfo.pInheritanceInfo = &inheritanceInfo;
+			if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+				throw runtime_error("Failed to begin recording secondary command buffer!");
+
+			{
+				viewport.x = 0.0f;
+				viewport.y = 0.0f;
+				viewport.width = (float)view.renderExtent.width;
+				viewport.height = (float)view.renderExtent.height;
+				viewport.minDepth = 0.0f;
+				viewport.maxDepth = 1.0f;
+				scissor.offset = { 0, 0 };
+				scissor.extent = view.renderExtent;
+			}
+
+			// The counters only see the scene draws, not the post effects (see readGpuCounters)
+			if (view.statisticsPool != VK_NULL_HANDLE)
+			{
+				vkCmdBeginQuery(commandBuffer, view.statisticsPool, view.counterSlot * view.counterChunks + (uint32_t)chunk, 0);
+				vkCmdBeginQuery(commandBuffer, view.occlusionPool, view.counterSlot * view.counterChunks + (uint32_t)chunk, preciseOcclusion ? VK_QUERY_CONTROL_PRECISE_BIT : 0);
+			}
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			boundPipeline = ~0u;
+			boundMesh = ~0u;
+			viewBinds = frameChunk.binds;
+			for (const DrawPacket &packet : state.queues[chunk].packets())
+			{
+				const SceneDraw	&draw = state.draws[chunk][packet.draw];
 
-		glfwDestroyWindow(window);
+				pipeline = drawKeyPipeline(packet.key);
+				mesh = drawKeyMesh(packet.key);
+				if (pipeline != boundPipeline)
+				{
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, materialPipeline(pipeline));
+					boundPipeline = pipeline;
+					frameChunk.binds++;
+				}
+				if (mesh != boundMesh && mesh)
+				{
+					vkCmdBindVertexBuffers(commandBuffer, 0, 1, &sceneMesh.buffer, &vertexOffset);
+					vkCmdBindIndexBuffer(commandBuffer, sceneMesh.buffer, sceneMesh.indexOffset, sceneMesh.indexType);
+					frameChunk.binds += 2;
+				}
+				boundMesh = mesh;
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(draw.constants), &draw.constants);
+				if (sceneMesh.loaded())
+					vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, 0, 0);
+				else
+					vkCmdDraw(commandBuffer, draw.indexCount, 1, 0, 0);
+			}
+			frameChunk.bindsAvoided += (ptrdiff_t)state.objectOrderBinds[chunk] - (ptrdiff_t)(frameChunk.binds - viewBinds);
+			if (view.statisticsPool != VK_NULL_HANDLE)
+			{
+				vkCmdEndQuery(commandBuffer, view.occlusionPool, view.counterSlot * view.counterChunks + (uint32_t)chunk);
+				vkCmdEndQuery(commandBuffer, view.statisticsPool, view.counterSlot * view.counterChunks + (uint32_t)chunk);
+			}
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+				throw runtime_error("Failed to record secondary command buffer!");
+			if (trace.capturing())
+				traceDraws(frameChunk.traceCommands[view.index], state.queues[chunk], state.draws[chunk], viewport, scissor);
+		}
+	}
+
+	/*
+	** The same commands as recordDraws, into the trace.
+	*/
+	void	traceDraws(TraceCommands &traced, const DrawQueue &queue, const vector<SceneDraw> &draws, const VkViewport &viewport, const VkRect2D &scissor)
+	{
+		uint32_t	boundPipeline;
+		uint32_t	boundMesh;
+
+		traced.clear();
+		traced.setViewport(viewport);
+		traced.setScissor(scissor);
+		boundPipeline = ~0u;
+		boundMesh = ~0u;
+		for (const DrawPacket &packet : queue.packets())
+		{
+			const SceneDraw	&draw = draws[packet.draw];
+
+			if (drawKeyPipeline(packet.key) != boundPipeline)
+			{
+				boundPipeline = drawKeyPipeline(packet.key);
+				traced.bindPipeline(objectHandle(materialPipeline(boundPipeline)));
+			}
+			if (drawKeyMesh(packet.key) != boundMesh)
+			{
+				boundMesh = drawKeyMesh(packet.key);
+				if (boundMesh)
+				{
+					traced.bindVertexBuffer(objectHandle(sceneMesh.buffer), 0);
+					traced.bindIndexBuffer(objectHandle(sceneMesh.buffer), sceneMesh.indexOffset, sceneMesh.indexType);
+				}
+			}
+			traced.pushConstants(objectHandle(pipelineLayout), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(draw.constants), &draw.constants);
+			if (sceneMesh.loaded())
+				traced.drawIndexed(draw.indexCount, 1, draw.firstIndex, 0, 0);
+			else
+				traced.draw(draw.indexCount, 1, 0, 0);
+		}
+	}
+
+	/*
+	** Per chunk: update -> cull -> prepare simulates frame N + 1 into the next
+	** frame state while record writes the draws of frame N, prepared during
+	** the previous frame. gather joins the simulation chains.
+	**
+	**   update[i] -> cull[i] -> prepare[i] -+-> gather
+	**   record[i]                           |
+	*/
+	void	buildFrameGraph()
+	{
+		TaskGraph::TaskId	gather;
+		TaskGraph::TaskId	update;
+		TaskGraph::TaskId	cull;
+		TaskGraph::TaskId	prepare;
+
+		frameGraph.clear();
+		gather = frameGraph.add("gather", [this]()
+		{
+			FrameState	&state = nextFrameState();
+
+			state.visible = 0;
+			state.triangles = 0;
+			state.lodSwitches = 0;
+			for (size_t i = 0; i < frameChunks.size(); i++)
+			{
+				state.visible += state.draws[i].size();
+				state.triangles += frameChunks[i].triangles;
+				state.lodSwitches += frameChunks[i].lodSwitches;
+			}
+		});
+		for (size_t i = 0; i < frameChunks.size(); i++)
+		{
+			update = frameGraph.add("update", [this, i]() { updateScene(i); });
+			cull = frameGraph.add("cull", [this, i]() { cullScene(i); });
+			prepare = frameGraph.add("prepare", [this, i]() { prepareDraws(i, nextFrameState()); });
+			frameGraph.add("record", [this, i]() { recordDraws(i, currentFrameState()); });
+			frameGraph.depend(update, cull);
+			frameGraph.depend(cull, prepare);
+			frameGraph.depend(prepare, gather);
+		}
+		stageTimings.clear();
+	}
+
+	/*
+	** Fills the current frame state synchronously, for the first frame after
+	** the scene or the chunks changed.
+	*/
+	void	primeFrameState()
+	{
+		scene.updateWorld(0, scene.size());
+		for (size_t i = 0; i < frameChunks.size(); i++)
+		{
+			cullScene(i);
+			prepareDraws(i, currentFrameState());
+		}
+	}
+
+	/*
+	** Sums the task timings of the last run of frameGraph per stage name.
+	*/
+	void	collectTaskTimings()
+	{
+		size_t			stage;
+
+		for (TaskGraph::TaskId id = 0; id < frameGraph.size(); id++)
+		{
+			const TaskTiming	&timing = frameGraph.timing(id);
+
+			for (stage = 0; stage < stageTimings.size(); stage++)
+				if (stageTimings[stage].name() == timing.name)
+					break;
+			if (stage == stageTimings.size())
+				stageTimings.push_back(BenchmarkStats(timing.name));
+			stageTimings[stage].add(timing.durationNs / 1000000.0);
+		}
+	}
+
+	void	createSemaphores(View &view)
+	{
+		VkSemaphoreCreateInfo	semaphoreInfo = {};
+
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator.callbacks(), &view.imageAvailableSemaphore) != VK_SUCCESS)
+			throw runtime_error("Failed to create semaphores!");
+		setObjectName(VK_OBJECT_TYPE_SEMAPHORE, view.imageAvailableSemaphore, view.name + "imageAvailableSemaphore");
+		createPresentSemaphores(view);
+	}
+
+	/*
+	** Grows renderFinishedSemaphores to one per swapchain image. They are
+	** never destroyed with the swapchain: the last presents of the old one may
+	** still wait on them.
+	*/
+	void	createPresentSemaphores(View &view)
+	{
+		VkSemaphoreCreateInfo	semaphoreInfo = {};
+		VkSemaphore				semaphore;
+
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		while (view.renderFinishedSemaphores.size() < view.swapChainImages.size())
+		{
+			if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator.callbacks(), &semaphore) != VK_SUCCESS)
+				throw runtime_error("Failed to create semaphores!");
+			setObjectName(VK_OBJECT_TYPE_SEMAPHORE, semaphore, view.name + "renderFinishedSemaphore[" + to_string(view.renderFinishedSemaphores.size()) + "]");
+			view.renderFinishedSemaphores.push_back(semaphore);
+		}
+	}
+
+	void cleanupSwapChain(View &view)
+	{
+		if (view.timestampPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(device, view.timestampPool, hostAllocator.callbacks());
+		view.timestampPool = VK_NULL_HANDLE;
+		vkDestroyFramebuffer(device, view.targetFramebuffer, hostAllocator.callbacks());
+		destroyPostTargets(view);
+		destroyMultisampleTarget(view);
+		vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(view.commandBuffers.size()), view.commandBuffers.data());
+		//vkDestroyPipeline(device, graphicsPipeline, hostAllocator.callbacks());
+		//vkDestroyPipelineLayout(device, pipelineLayout, hostAllocator.callbacks());
+		//vkDestroyRenderPass(device, renderPass, hostAllocator.callbacks());
+		vkDestroyImageView(device, view.targetImageView, hostAllocator.callbacks());
+		vkDestroyImage(device, view.targetImage, hostAllocator.callbacks());
+		vkFreeMemory(device, view.targetMemory, hostAllocator.callbacks());
+		vkDestroySwapchainKHR(device, view.swapChain, hostAllocator.callbacks());
+	}
+
+	void recreateSwapChain(View &view)
+	{
+		PROFILE_ZONE("recreateSwapChain");
+		//vkDeviceWaitIdle(device);
+
+		cleanupSwapChain(view);
+		createSwapChain(view);
+		createPresentSemaphores(view);
+		createRenderTarget(view);
+		//createRenderPass();
+		//createGraphicPipeline();
+		createFramebuffers(view);
+		createTimestampQueries(view);
+		createCommandBuffers(view);
+		frameDirty = true;
+	}
+
+	void	recreateSwapChains()
+	{
+		for (View &view : views)
+			recreateSwapChain(view);
+	}
+
+	/*
+	** Startup as task graphs on the job system: the steps only wait for what
+	** they use instead of running one after the other.
+	**
+	**   instance, shaderFiles          (while this thread creates the windows)
+	**   surfaces -> device -> swapChain[i], renderPass, pipelineLayout,
+	**                         commandPool, frameChunks
+	**   commandPool -> sceneMesh
+	**   renderPass, pipelineLayout, sceneMesh -> pipeline
+	**   swapChain[i], renderPass, pipelineLayout -> framebuffers[i]
+	**   every swapChain[i], sceneMesh -> commandBuffers (one pool, one task)
+	**   frameChunks, sceneMesh -> scene
+	**
+	** GLFW windows can only be created on the main thread, surfaces from any.
+	** The render pass only needs the surface format, known once the device is
+	** picked, so the pipeline is built while the swapchains are created.
+	** Every step is timed (reportStartup) and is a zone of the profiler
+	** captures, drawFrame logs the time to the first frame.
+	*/
+	void	initVulkan()
+	{
+		TaskGraph			instanceGraph;
+		TaskGraph			deviceGraph;
+		TaskGraph::TaskId	surfaces;
+		TaskGraph::TaskId	device;
+		TaskGraph::TaskId	swapChain;
+		TaskGraph::TaskId	framebuffers;
+		TaskGraph::TaskId	renderPassTask;
+		TaskGraph::TaskId	layout;
+		TaskGraph::TaskId	pool;
+		TaskGraph::TaskId	mesh;
+		TaskGraph::TaskId	pipeline;
+		TaskGraph::TaskId	commandBuffers;
+		TaskGraph::TaskId	chunks;
+		TaskGraph::TaskId	sceneTask;
+		int64_t				windowsStart;
+		//uint32_t	extensionCount = 0;
+		//vector<VkExtensionProperties> extensions;
+
+		PROFILE_ZONE("initVulkan");
+		createJobSystem(thread::hardware_concurrency());
+		resolution.setEnabled(dynamicResolutionEnable);
+		instanceGraph.add("instance", [this]() { createInstance(); setupDebugMessenger(); });
+		instanceGraph.add("shaderFiles", [this]() { preloadShaderFiles(); });
+		jobs->run(instanceGraph);
+		windowsStart = JobSystem::clockNs();
+		initWindow();
+		startupTimings.push_back({ "windows", -1, windowsStart, JobSystem::clockNs() - windowsStart });
+		Profiler::record("windows", windowsStart, windowsStart + startupTimings.back().durationNs);
+		jobs->wait(instanceGraph);
+		addStartupTimings(instanceGraph);
+
+		surfaces = deviceGraph.add("surfaces", [this]() { createSurfaces(); });
+		device = deviceGraph.add("device", [this]()
+		{
+			pickPhysicalDevice();
+			createLogicalDevice();
+#ifdef _CAPTURE_TRACE
+			startTraceCapture();
+#endif
+		});
+		renderPassTask = deviceGraph.add("renderPass", [this]() { createRenderPass(); });
+		layout = deviceGraph.add("pipelineLayout", [this]() { createPipelineLayout(); createPostLayout(); });
+		pool = deviceGraph.add("commandPool", [this]() { createCommandPool(); });
+		mesh = deviceGraph.add("sceneMesh", [this]() { loadSceneMesh(); });
+		pipeline = deviceGraph.add("pipeline", [this]()
+		{
+			createGraphicPipeline(graphicsPipeline, shaderConstants);
+			createPostPipelines();
+		});
+		commandBuffers = deviceGraph.add("commandBuffers", [this]()
+		{
+			for (View &view : views)
+				createCommandBuffers(view);
+		});
+		chunks = deviceGraph.add("frameChunks", [this]() { createFrameChunks(); });
+		sceneTask = deviceGraph.add("scene", [this]()
+		{
+			initScene(defaultSceneObjects);
+			buildFrameGraph();
+			primeFrameState();
+		});
+		deviceGraph.depend(surfaces, device);
+		for (TaskGraph::TaskId task : { renderPassTask, layout, pool, chunks })
+			deviceGraph.depend(device, task);
+		deviceGraph.depend(pool, mesh);
+		for (TaskGraph::TaskId task : { renderPassTask, layout, mesh })
+			deviceGraph.depend(task, pipeline);
+		deviceGraph.depend(mesh, commandBuffers);
+		deviceGraph.depend(mesh, sceneTask);
+		deviceGraph.depend(chunks, sceneTask);
+		for (View &view : views)
+		{
+			View	*target = &view;
+
+			swapChain = deviceGraph.add("swapChain", [this, target]()
+			{
+				createSwapChain(*target);
+				createRenderTarget(*target);
+				createTimestampQueries(*target);
+				createCounterQueries(*target);
+				createSemaphores(*target);
+			});
+			framebuffers = deviceGraph.add("framebuffers", [this, target]() { createFramebuffers(*target); });
+			deviceGraph.depend(device, swapChain);
+			deviceGraph.depend(swapChain, framebuffers);
+			deviceGraph.depend(renderPassTask, framebuffers);
+			deviceGraph.depend(layout, framebuffers);
+			deviceGraph.depend(swapChain, commandBuffers);
+		}
+		jobs->execute(deviceGraph);
+		addStartupTimings(deviceGraph);
+		calibrateGpuClock();
+		reportStartup();
+		/*
+		vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, NULL);
+		extensions.resize(extensionCount);
+		vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, extensions.data());
+		cout << "Available extensions:" << endl;
+		for (const VkExtensionProperties& extension : extensions)
+		{
+			cout << "\t" << extension.extensionName << endl;
+		}*/
+	}
+
+	void	addStartupTimings(const TaskGraph &graph)
+	{
+		for (TaskGraph::TaskId id = 0; id < graph.size(); id++)
+			startupTimings.push_back(graph.timing(id));
+	}
+
+	/*
+	** Timeline of the startup steps, in start order, from run(). "work" sums
+	** their durations: more than the elapsed time when they overlapped.
+	*/
+	void	reportStartup()
+	{
+		string		threadName;
+		int64_t		work;
+
+		sort(startupTimings.begin(), startupTimings.end(), [](const TaskTiming &a, const TaskTiming &b) { return (a.startNs < b.startNs); });
+		work = 0;
+		for (const TaskTiming &timing : startupTimings)
+		{
+			threadName = (timing.worker < 0) ? "main thread" : "worker " + to_string(timing.worker);
+			logger.log(LOG_INFO, "Startup %-14s %8.2fms +%8.2fms (%s)", timing.name, (timing.startNs - startupNs) / 1000000.0,
+				timing.durationNs / 1000000.0, threadName.c_str());
+			work += timing.durationNs;
+		}
+		logger.log(LOG_INFO, "Startup: initialized in %.2fms (%.2fms of work on %u threads)", (JobSystem::clockNs() - startupNs) / 1000000.0,
+			work / 1000000.0, jobs->workerCount() + 1);
+	}
+
+	/*
+	** Feeds the GPU time of the frame to the resolution controller, the next
+	** frame is recorded with the new render extents. Only the viewport and
+	** the blit source change: nothing is reallocated.
+	*/
+	void	updateRenderExtents(double gpuMs)
+	{
+		resolution.update(gpuMs);
+		for (View &view : views)
+			view.renderExtent = { resolution.scaled(view.swapChainExtent.width), resolution.scaled(view.swapChainExtent.height) };
+	}
+
+	/*
+	** Acquires an image from every visible view, records all of them with a
+	** single run of the frame graph, then submits them with one vkQueueSubmit
+	** (a batch per view, each waiting on its own acquire) and presents them
+	** with one vkQueuePresentKHR. batchedSubmit = false submits and presents
+	** view by view instead, for comparison. The CPU then waits for the
+	** frame's point on the graphics timeline.
+	*/
+	void drawFrame()
+	{
+		VkResult					result;
+		const VkPipelineStageFlags	waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT; // first swapchain image access: the blit
+		SubmitPoint					framePoint = {};
+		VkPresentInfoKHR			presentInfo = {};
+		BenchmarkTimer				timer;
+		uint64_t					gpuNs;
+		size_t						count;
+		vector<const TraceCommands *>	traced;
+
+		/*Acquire*/ {
+			PROFILE_ZONE("acquire");
+			submission.clear();
+			for (size_t i = 0; i < activeViews; i++)
+			{
+				View	&view = views[i];
+
+				view.acquired = false;
+				if (view.minimized)
+					continue;
+				result = vkAcquireNextImageKHR(device, view.swapChain, numeric_limits<uint64_t>::max(), view.imageAvailableSemaphore, VK_NULL_HANDLE, &view.imageIndex);
+				if (result == VK_ERROR_OUT_OF_DATE_KHR)
+				{
+					recreateSwapChain(view);
+					continue;
+				}
+				else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+					throw runtime_error("Failed to acquire swapchain image!");
+				view.acquired = true;
+				submission.views.push_back(&view);
+			}
+		}
+		lastAcquireMs = timer.elapsedMs();
+		if (submission.views.empty())
+			return;
+
+		/*Frame tasks: record frame N, simulate frame N + 1*/ {
+			PROFILE_ZONE("frame tasks");
+			BenchmarkTimer	graphTimer;
+			double			now;
+
+			now = glfwGetTime();
+			simulationDt = sceneAnimated ? (float)min(now - lastSimulationTime, 0.1) : 0.0f;
+			lastSimulationTime = now;
+			updateLodPixelScale();
+			for (View *view : submission.views)
+				readGpuCounters(*view);
+			jobs->execute(frameGraph);
+			lastGraphMs = graphTimer.elapsedMs();
+			collectTaskTimings();
+			for (View *view : submission.views)
+				recordCommandBuffer(*view);
+			lastTriangles = currentFrameState().triangles;
+			lastLodSwitches = currentFrameState().lodSwitches;
+			lastBinds = 0;
+			lastBindsAvoided = 0;
+			for (const FrameChunk &frameChunk : frameChunks)
+			{
+				lastBinds += frameChunk.binds;
+				lastBindsAvoided += frameChunk.bindsAvoided;
+			}
+			frameIndex++;
+		}
+
+		/*Submit*/ {
+			PROFILE_ZONE("submit");
+			timer.reset();
+			count = submission.views.size();
+			for (View *view : submission.views)
+			{
+				frameBatch = frameDependencies;
+				frameBatch.commandBuffers.assign(1, view->commandBuffers[view->imageIndex]);
+				frameBatch.binaryWaits.assign(1, view->imageAvailableSemaphore);
+				frameBatch.binaryWaitStages.assign(1, waitStage);
+				frameBatch.binarySignals.assign(1, view->renderFinishedSemaphores[view->imageIndex]);
+				framePoint = scheduler.enqueue(graphicsTimeline, frameBatch);
+				if (!batchedSubmit)
+					scheduler.flush();
+				frameBatch.clear();
+				submission.renderFinished.push_back(view->renderFinishedSemaphores[view->imageIndex]);
+				submission.swapChains.push_back(view->swapChain);
+				submission.imageIndices.push_back(view->imageIndex);
+			}
+			frameDependencies.clear();
+			submission.results.assign(count, VK_SUCCESS);
+			scheduler.flush();
+		}
+		lastSubmitMs = timer.elapsedMs();
+		if (trace.capturing())
+		{
+			for (View *view : submission.views)
+				traced.push_back(&view->traceCommands);
+			trace.submit(frameIndex, traced);
+			if (trace.frames() >= traceCaptureFrames)
+				stopTraceCapture();
+		}
+
+		/*Present*/ {
+			PROFILE_ZONE("present");
+			timer.reset();
+			for (size_t i = 0; i < count; i += (batchedSubmit ? count : 1))
+			{
+				presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+				presentInfo.waitSemaphoreCount = batchedSubmit ? (uint32_t)count : 1;
+				presentInfo.pWaitSemaphores = &submission.renderFinished[i];
+				presentInfo.swapchainCount = batchedSubmit ? (uint32_t)count : 1;
+				presentInfo.pSwapchains = &submission.swapChains[i];
+				presentInfo.pImageIndices = &submission.imageIndices[i];
+				presentInfo.pResults = &submission.results[i];
+				result = vkQueuePresentKHR(presentQueue, &presentInfo);
+				if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR)
+					throw runtime_error("Failed to present swap chain image!");
+			}
+		}
+		lastPresentMs = timer.elapsedMs();
+
+		/*Wait for the GPU*/ {
+			PROFILE_ZONE("wait GPU");
+			scheduler.wait(framePoint);
+		}
+		if (!firstFramePresented)
+		{
+			firstFramePresented = true;
+			logger.log(LOG_INFO, "Time to first frame: %.2fms", (JobSystem::clockNs() - startupNs) / 1000000.0);
+		}
+		gpuNs = 0;
+		for (View *view : submission.views)
+			gpuNs += readFrameGpuTime(*view);
+		utilization.addFrame(gpuNs);
+		lastGpuMs = gpuNs / 1000000.0;
+		updateRenderExtents(lastGpuMs);
+		for (size_t i = 0; i < count; i++)
+		{
+			result = submission.results[i];
+			if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+				recreateSwapChain(*submission.views[i]);
+			else if (result != VK_SUCCESS)
+				throw runtime_error("Failed to present swap chain image!");
+		}
+		hostAllocator.endFrame();
+	}
+
+#ifdef _SPECIALIZATION_BENCHMARK
+	/*
+	** Renders the same frames with the specialized pipeline (colorMode folded
+	** at pipeline creation) and with the branching one (colorMode read from
+	** push constants), every color mode, and prints the frame time of each.
+	*/
+	void	runSpecializationBenchmark()
+	{
+		const int			warmupFrames = 100;
+		const int			measuredFrames = 2000;
+		const char			*variantNames[2] = { "specialized", "branching" };
+		vector<BenchmarkStats>	results;
+		BenchmarkTimer		timer;
+
+		logger.log(LOG_INFO, "Specialization benchmark (%d frames per variant)", measuredFrames);
+		for (int32_t colorMode = 0; colorMode < 3; colorMode++)
+		{
+			for (int variant = 0; variant < 2; variant++)
+			{
+				vkDeviceWaitIdle(device);
+				vkDestroyPipeline(device, graphicsPipeline, hostAllocator.callbacks());
+				shaderConstants.colorMode = colorMode;
+				shaderConstants.dynamicColorMode = (variant == 1) ? VK_TRUE : VK_FALSE;
+				createGraphicPipeline(graphicsPipeline, shaderConstants);
+				recreateSwapChains();
+
+				results.push_back(BenchmarkStats(string(variantNames[variant]) + " colorMode=" + to_string(colorMode)));
+				for (int frame = 0; frame < warmupFrames + measuredFrames && renderRunning.load(); frame++)
+				{
+					timer.reset();
+					drawFrame();
+					if (frame >= warmupFrames)
+						results.back().add(timer.elapsedMs());
+				}
+			}
+		}
+		for (const BenchmarkStats &stats : results)
+			stats.report();
+		vkDeviceWaitIdle(device);
+	}
+#endif
+
+#ifdef _JOB_BENCHMARK
+	/*
+	** A task that throws must keep its dependents from running: wait()
+	** rethrows its error and the chain after it is skipped, run after run.
+	*/
+	void	checkTaskFailure()
+	{
+		TaskGraph			graph;
+		TaskGraph::TaskId	failing;
+		TaskGraph::TaskId	dependent;
+		TaskGraph::TaskId	last;
+		atomic<int>			dependentsRun(0);
+		bool				rethrown;
+
+		failing = graph.add("failing", []() { throw runtime_error("Task failure check"); });
+		dependent = graph.add("dependent", [&dependentsRun]() { dependentsRun++; });
+		last = graph.add("last", [&dependentsRun]() { dependentsRun++; });
+		graph.depend(failing, dependent);
+		graph.depend(dependent, last);
+		for (int run = 0; run < 2; run++)
+		{
+			rethrown = false;
+			try
+			{
+				jobs->execute(graph);
+			}
+			catch (const runtime_error &)
+			{
+				rethrown = true;
+			}
+			if (!rethrown || dependentsRun.load() != 0 || !graph.done())
+				throw runtime_error("Job system ran the dependents of a failed task!");
+		}
+	}
+
+	/*
+	** Runs the animated frame pipeline on jobBenchmarkObjects objects with 1
+	** to all hardware threads and prints the frame graph time (CPU work of
+	** the frame: update, cull, prepare and record) and the whole frame time.
+	*/
+	void	runJobBenchmark()
+	{
+		const int			warmupFrames = 50;
+		const int			measuredFrames = 500;
+		unsigned			maxThreads;
+		vector<BenchmarkStats>	graphResults;
+		vector<BenchmarkStats>	frameResults;
+		BenchmarkTimer		timer;
+
+		maxThreads = max(1u, thread::hardware_concurrency());
+		logger.log(LOG_INFO, "Job system benchmark (%zu objects, %d frames, 1 to %u threads)", jobBenchmarkObjects, measuredFrames, maxThreads);
+		initScene(jobBenchmarkObjects);
+		sceneAnimated = true;
+		for (unsigned threads = 1; threads <= maxThreads && renderRunning.load(); threads++)
+		{
+			vkDeviceWaitIdle(device);
+			destroyFrameChunks();
+			createJobSystem(threads);
+			checkTaskFailure();
+			createFrameChunks();
+			buildFrameGraph();
+			primeFrameState();
+
+			graphResults.push_back(BenchmarkStats("graph " + to_string(threads) + " threads"));
+			frameResults.push_back(BenchmarkStats("frame " + to_string(threads) + " threads"));
+			for (int frame = 0; frame < warmupFrames + measuredFrames && renderRunning.load(); frame++)
+			{
+				timer.reset();
+				drawFrame();
+				if (frame >= warmupFrames)
+				{
+					frameResults.back().add(timer.elapsedMs());
+					graphResults.back().add(lastGraphMs);
+				}
+			}
+			for (const BenchmarkStats &stage : stageTimings)
+				logger.log(LOG_INFO, "%u threads: %s %.3fms per task", threads, stage.name().c_str(), stage.mean());
+		}
+		vkDeviceWaitIdle(device);
+		for (size_t i = 0; i < graphResults.size(); i++)
+		{
+			graphResults[i].report();
+			frameResults[i].report();
+			cout << "speedup " << fixed << setprecision(2) << graphResults[0].mean() / graphResults[i].mean() << "x (graph), "
+				<< frameResults[0].mean() / frameResults[i].mean() << "x (frame)" << defaultfloat << endl;
+		}
+	}
+#endif
+
+#ifdef _VIEW_BENCHMARK
+	/*
+	** Renders 1 to VIEW_COUNT views, with one batched submit and present per
+	** frame and with a submit and present per view, and prints the frame
+	** time, the cost of each queue operation and what every added view costs.
+	*/
+	void	runViewBenchmark()
+	{
+		const int			warmupFrames = 100;
+		const int			measuredFrames = 1000;
+		const char			*modeNames[2] = { "batched", "per view" };
+		BenchmarkStats		frameResults[2][VIEW_COUNT];
+		BenchmarkStats		acquireResults[2][VIEW_COUNT];
+		BenchmarkStats		submitResults[2][VIEW_COUNT];
+		BenchmarkStats		presentResults[2][VIEW_COUNT];
+		BenchmarkTimer		timer;
+		double				marginal;
+
+		logger.log(LOG_INFO, "View benchmark (%d frames, 1 to %zu views)", measuredFrames, views.size());
+		for (size_t count = 1; count <= views.size() && renderRunning.load(); count++)
+		{
+			for (int mode = 0; mode < 2; mode++)
+			{
+				vkDeviceWaitIdle(device);
+				activeViews = count;
+				batchedSubmit = (mode == 0);
+
+				frameResults[mode][count - 1] = BenchmarkStats(string(modeNames[mode]) + " " + to_string(count) + " views");
+				for (int frame = 0; frame < warmupFrames + measuredFrames && renderRunning.load(); frame++)
+				{
+					timer.reset();
+					drawFrame();
+					if (frame >= warmupFrames)
+					{
+						frameResults[mode][count - 1].add(timer.elapsedMs());
+						acquireResults[mode][count - 1].add(lastAcquireMs);
+						submitResults[mode][count - 1].add(lastSubmitMs);
+						presentResults[mode][count - 1].add(lastPresentMs);
+					}
+				}
+			}
+		}
+		vkDeviceWaitIdle(device);
+		activeViews = views.size();
+		batchedSubmit = true;
+		for (size_t count = 1; count <= views.size(); count++)
+		{
+			for (int mode = 0; mode < 2; mode++)
+			{
+				if (!frameResults[mode][count - 1].count())
+					continue;
+				frameResults[mode][count - 1].report();
+				cout << fixed << setprecision(3) << "  " << frameResults[mode][count - 1].mean() / count << "ms per view, acquire "
+					<< acquireResults[mode][count - 1].mean() << "ms, submit " << submitResults[mode][count - 1].mean()
+					<< "ms, present " << presentResults[mode][count - 1].mean() << "ms";
+				if (count > 1)
+				{
+					marginal = frameResults[mode][count - 1].mean() - frameResults[mode][count - 2].mean();
+					cout << ", +" << marginal << "ms for the last view";
+				}
+				cout << defaultfloat << endl;
+			}
+		}
+	}
+#endif
+
+#ifdef _MESH_BENCHMARK
+	/*
+	** Source format path: what a loader without the preprocessed format does,
+	** parse then quantize, then stage the result for the GPU.
+	*/
+	void	uploadSourceMesh(const string &path, GpuMesh &mesh)
+	{
+		MeshData			data;
+		PackedMesh			packed;
+		VkBuffer			staging;
+		VkDeviceMemory		stagingMemory;
+		VkDeviceSize		vertexSize;
+		VkDeviceSize		indexSize;
+		uint8_t				*mapped;
+
+		data = loadMeshSource(path);
+		if (data.normals.empty())
+			generateNormals(data);
+		packed = packMesh(data);
+		vertexSize = packed.vertices.size() * sizeof(MeshVertex);
+		indexSize = packed.indices.size() * sizeof(uint32_t);
+		createBuffer(meshAlignSection(vertexSize) + indexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging, stagingMemory);
+		vkMapMemory(device, stagingMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&mapped));
+		memcpy(mapped, packed.vertices.data(), (size_t)vertexSize);
+		memcpy(mapped + meshAlignSection(vertexSize), packed.indices.data(), (size_t)indexSize);
+		vkUnmapMemory(device, stagingMemory);
+		createMeshBuffer(staging, stagingMemory, 0, meshAlignSection(vertexSize) + indexSize, NULL, mesh);
+		mesh.indexOffset = meshAlignSection(vertexSize);
+		mesh.indexType = VK_INDEX_TYPE_UINT32;
+		mesh.vertexCount = (uint32_t)packed.vertices.size();
+		mesh.lods = packed.lods;
+		setMeshBounds(mesh, packed.boundsMin, packed.boundsMax);
+	}
+
+	/*
+	** Runs load() while a thread samples the private memory of the process,
+	** returns the peak above the level it started from.
+	*/
+	uint64_t	measurePeakMemory(const function<void()> &load)
+	{
+		atomic<bool>		running;
+		atomic<uint64_t>	peak;
+		uint64_t			baseline;
+		thread				sampler;
+
+		baseline = processPrivateBytes();
+		peak = baseline;
+		running = true;
+		sampler = thread([&]()
+		{
+			while (running.load())
+			{
+				peak = max(peak.load(), processPrivateBytes());
+				this_thread::sleep_for(chrono::milliseconds(1));
+			}
+		});
+		load();
+		running = false;
+		sampler.join();
+		return (max(peak.load(), processPrivateBytes()) - baseline);
+	}
+
+	/*
+	** Loads the same mesh (a generated sphere) from OBJ, glTF and .vkmesh up
+	** to a device local buffer, and prints the load time and the peak private
+	** memory of each path. The memory is taken on each format's first load,
+	** before the allocator has cached anything for it.
+	*/
+	void	runMeshBenchmark()
+	{
+		const int			measuredLoads = 10;
+		const char			*paths[3] = { "mesh_benchmark.vkmesh", "mesh_benchmark.gltf", "mesh_benchmark.obj" };
+		BenchmarkStats		results[3];
+		uint64_t			peakMemory[3];
+		uint64_t			fileSize[3];
+		MeshData			source;
+		PackedMesh			packed;
+		BenchmarkTimer		timer;
+		GpuMesh				mesh;
+		MeshFile			file;
+		bool				imported;
+
+		source = makeSphere(meshBenchmarkRings, meshBenchmarkSegments);
+		saveObj(source, paths[2]);
+		saveGltf(source, paths[1]);
+		packed = packMesh(source);
+		optimizeMesh(packed);
+		writeMeshFile(packed, paths[0]);
+		logger.log(LOG_INFO, "Mesh benchmark (%zu vertices, %zu triangles, %d loads per format)", packed.vertices.size(), packed.indices.size() / 3, measuredLoads);
+		source = MeshData();
+		packed = PackedMesh();
+
+		imported = false;
+		for (int format = 0; format < 3 && renderRunning.load(); format++)
+		{
+			auto	load = [&]()
+			{
+				if (format == 0)
+				{
+					file.open(paths[format]);
+					imported = uploadMesh(file, mesh);
+					fileSize[format] = file.mapping().size();
+					file.close();
+				}
+				else
+					uploadSourceMesh(paths[format], mesh);
+			};
+
+			results[format] = BenchmarkStats(string(paths[format]) + " load");
+			peakMemory[format] = measurePeakMemory(load);
+			destroyMesh(mesh);
+			for (int i = 0; i < measuredLoads && renderRunning.load(); i++)
+			{
+				timer.reset();
+				load();
+				results[format].add(timer.elapsedMs());
+				destroyMesh(mesh);
+			}
+			if (format)
+				fileSize[format] = (uint64_t)ifstream(paths[format], ios::ate | ios::binary).tellg();
+		}
+		for (int format = 0; format < 3; format++)
+		{
+			if (!results[format].count())
+				continue;
+			results[format].report();
+			cout << fixed << setprecision(1) << "  file " << fileSize[format] / 1048576.0 << "MB, peak private memory "
+				<< peakMemory[format] / 1048576.0 << "MB, " << results[format].mean() / results[0].mean() << "x the .vkmesh time";
+			if (format == 0)
+				cout << ", " << (imported ? "zero copy" : "staging") << " upload";
+			cout << defaultfloat << endl;
+		}
+	}
+#endif
+
+#ifdef _LOD_BENCHMARK
+	/*
+	** Draws lodBenchmarkObjects instances of a generated sphere with its LOD
+	** chain, without LODs, with LODs but no hysteresis and with both, and
+	** prints the frame and GPU time, the triangles drawn per frame and the
+	** GPU throughput. lodBias wobbles by 10% every few frames, as the dynamic
+	** resolution steps would, to count the LOD switches each mode makes.
+	*/
+	void	runLodBenchmark()
+	{
+		const int			warmupFrames = 100;
+		const int			measuredFrames = 1000;
+		const char			*path = "lod_benchmark.vkmesh";
+		const char			*modeNames[3] = { "LOD off", "LOD no hysteresis", "LOD" };
+		BenchmarkStats		frameResults[3];
+		BenchmarkStats		gpuResults[3];
+		double				triangles[3] = {};
+		double				switches[3] = {};
+		vector<size_t>		histogram;
+		MeshData			source;
+		PackedMesh			packed;
+		MeshFile			file;
+		BenchmarkTimer		timer;
+
+		source = makeSphere(lodBenchmarkRings, lodBenchmarkSegments);
+		packed = packMesh(source);
+		buildLodChain(source, packed);
+		optimizeMesh(packed);
+		writeMeshFile(packed, path);
+
+		vkDeviceWaitIdle(device);
+		destroyMesh(sceneMesh);
+		file.open(path);
+		uploadMesh(file, sceneMesh);
+		file.close();
+		vkDestroyPipeline(device, graphicsPipeline, hostAllocator.callbacks());
+		createGraphicPipeline(graphicsPipeline, shaderConstants);
+		initScene(lodBenchmarkObjects, 0.02f, 0.4f);
+		sceneAnimated = true;
+		logger.log(LOG_INFO, "LOD benchmark (%zu objects, %u triangles, %zu LODs, %d frames per mode)",
+			sceneObjects.size(), sceneMesh.lods[0].indexCount / 3, sceneMesh.lods.size(), measuredFrames);
+
+		for (int mode = 0; mode < 3 && renderRunning.load(); mode++)
+		{
+			vkDeviceWaitIdle(device);
+			lodEnabled = (mode != 0);
+			lodBandWidth = (mode == 2) ? lodHysteresis : 0.0f;
+			frameResults[mode] = BenchmarkStats(string(modeNames[mode]) + " frame");
+			gpuResults[mode] = BenchmarkStats(string(modeNames[mode]) + " GPU");
+			for (int frame = 0; frame < warmupFrames + measuredFrames && renderRunning.load(); frame++)
+			{
+				lodBias = (frame / 4 % 2) ? 1.1f : 1.0f;
+				timer.reset();
+				drawFrame();
+				if (frame < warmupFrames)
+					continue;
+				frameResults[mode].add(timer.elapsedMs());
+				gpuResults[mode].add(lastGpuMs);
+				triangles[mode] += (double)lastTriangles / measuredFrames;
+				switches[mode] += (double)lastLodSwitches / measuredFrames;
+			}
+		}
+		vkDeviceWaitIdle(device);
+		lodEnabled = true;
+		lodBandWidth = lodHysteresis;
+		lodBias = 1.0f;
+
+		histogram.assign(sceneMesh.lods.size(), 0);
+		for (const SceneObject &object : sceneObjects)
+			histogram[object.lod]++;
+		for (int mode = 0; mode < 3; mode++)
+		{
+			if (!frameResults[mode].count())
+				continue;
+			frameResults[mode].report();
+			gpuResults[mode].report();
+			cout << fixed << setprecision(2) << "  " << triangles[mode] / 1000000.0 << "M triangles per frame, "
+				<< triangles[mode] / max(gpuResults[mode].mean(), 1e-6) / 1000000.0 << "G triangles/s on the GPU, "
+				<< switches[mode] << " LOD switches per frame" << defaultfloat << endl;
+		}
+		cout << "objects per LOD:";
+		for (size_t i = 0; i < histogram.size(); i++)
+			cout << " " << i << ":" << histogram[i] << " (" << sceneMesh.lods[i].indexCount / 3 << " triangles)";
+		cout << endl;
+	}
+#endif
+
+#ifdef _SCENE_BENCHMARK
+	/*
+	** Per object layout of the reference loop: what a scene written with glm
+	** types looks like.
+	*/
+	struct				SceneBenchmarkObject
+	{
+		glm::vec3		position;
+		glm::quat		rotation;
+		float			scale;
+		glm::vec4		bounds;
+		glm::mat4		world;
+		glm::vec4		sphere;
+		bool			visible;
+	};
+
+	/*
+	** World matrices and frustum culling of sceneBenchmarkCounts random
+	** objects (a cloud in front of a perspective camera, a bit more than
+	** half of it in view), CPU only: a per object glm loop over an array of
+	** structs, then the Scene kernels (scalar, SSE, AVX2) on one thread and
+	** AVX2 on every chunk of the job system. Prints the time per pass and per
+	** object.
+	*/
+	void	runSceneBenchmark()
+	{
+		const int				warmupPasses = 3;
+		const int				measuredPasses = 20;
+		const char				*variantNames[5] = { "AoS glm", "SoA scalar", "SoA SSE", "SoA AVX2", "SoA AVX2 jobs" };
+		const glm::mat4			viewProjection = glm::perspective(1.0f, (float)WIDTH / HEIGHT, 0.1f, 200.0f)
+									* glm::lookAt(glm::vec3(0.0f, 0.0f, 60.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const SceneFrustum		frustum = sceneFrustum(viewProjection);
+		mt19937					random(42);
+		uniform_real_distribution<float>	coordinate(-50.0f, 50.0f);
+		uniform_real_distribution<float>	unit(-1.0f, 1.0f);
+		uniform_real_distribution<float>	scale(0.1f, 2.0f);
+		vector<SceneBenchmarkObject>	objects;
+		Scene					soa;
+		TaskGraph				graph;
+		size_t					chunks;
+		size_t					visible[5];
+		BenchmarkStats			results[5];
+		BenchmarkTimer			timer;
+
+		chunks = 4 * (jobs->workerCount() + 1);
+		logger.log(LOG_INFO, "Scene benchmark (%d passes, %zu chunks for the jobs, %s kernels available)",
+			measuredPasses, chunks, sceneSimdName(Scene::supportedSimd()));
+		for (size_t count : sceneBenchmarkCounts)
+		{
+			objects.resize(count);
+			soa.resize(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				SceneBenchmarkObject	&object = objects[i];
+
+				object.position = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+				object.rotation = glm::angleAxis(3.14159265f * unit(random), glm::normalize(glm::vec3(unit(random), unit(random), 1.0f)));
+				object.scale = scale(random);
+				object.bounds = glm::vec4(0.1f * unit(random), 0.1f * unit(random), 0.1f * unit(random), 1.0f);
+				soa.setTransform(i, object.position, object.rotation, object.scale);
+				soa.setBounds(i, glm::vec3(object.bounds), object.bounds.w);
+			}
+			graph.clear();
+			for (size_t chunk = 0; chunk < chunks; chunk++)
+			{
+				graph.add("scene", [&soa, &frustum, chunk, chunks]()
+				{
+					size_t		begin;
+					size_t		end;
+
+					soa.chunkRange(chunk, chunks, begin, end);
+					soa.updateWorld(begin, end);
+					soa.cull(frustum, begin, end);
+				});
+			}
+
+			for (int variant = 0; variant < 5; variant++)
+			{
+				results[variant] = BenchmarkStats(string(variantNames[variant]) + " " + to_string(count));
+				soa.setSimd(variant == 1 ? SCENE_SIMD_SCALAR : variant == 2 ? SCENE_SIMD_SSE : SCENE_SIMD_AVX2);
+				for (int pass = 0; pass < warmupPasses + measuredPasses; pass++)
+				{
+					timer.reset();
+					if (variant == 0)
+					{
+						for (SceneBenchmarkObject &object : objects)
+						{
+							object.world = glm::translate(glm::mat4(1.0f), object.position) * glm::mat4_cast(object.rotation)
+								* glm::scale(glm::mat4(1.0f), glm::vec3(object.scale));
+							object.sphere = object.world * glm::vec4(glm::vec3(object.bounds), 1.0f);
+							object.sphere.w = object.bounds.w * fabs(object.scale);
+							object.visible = true;
+							for (const float *plane : frustum.planes)
+								object.visible &= (glm::dot(glm::vec3(plane[0], plane[1], plane[2]), glm::vec3(object.sphere)) + plane[3] >= -object.sphere.w);
+						}
+					}
+					else if (variant < 4)
+					{
+						soa.updateWorld(0, count);
+						soa.cull(frustum, 0, count);
+					}
+					else
+						jobs->execute(graph);
+					if (pass >= warmupPasses)
+						results[variant].add(timer.elapsedMs());
+				}
+				visible[variant] = 0;
+				for (size_t i = 0; i < count; i++)
+					visible[variant] += (variant == 0) ? objects[i].visible : soa.visibility()[i];
+			}
+			for (int variant = 0; variant < 5; variant++)
+			{
+				results[variant].report();
+				cout << fixed << setprecision(2) << "  " << results[variant].mean() * 1000000.0 / count << "ns per object, "
+					<< results[0].mean() / results[variant].mean() << "x, " << visible[variant] << " visible" << defaultfloat << endl;
+			}
+		}
+	}
+#endif
+
+#ifdef _POST_BENCHMARK
+	/*
+	** Renders postBenchmarkObjects objects with every post mode and prints
+	** the frame and GPU time, and the memory traffic of the render passes:
+	** core Vulkan has no DRAM counters, so it is what their load and store
+	** ops declare (postBytesPerPixel), per frame and per second of GPU time.
+	** Whether the subpass images got lazily allocated memory is reported
+	** too: without it the driver may still back them with memory.
+	*/
+	void	runPostBenchmark()
+	{
+		const int			warmupFrames = 100;
+		const int			measuredFrames = 1000;
+		BenchmarkStats		frameResults[POST_MODE_COUNT];
+		BenchmarkStats		gpuResults[POST_MODE_COUNT];
+		uint32_t			bytesPerPixel[POST_MODE_COUNT] = {};
+		bool				lazyMemory[POST_MODE_COUNT] = {};
+		double				pixels;
+		double				megabytes;
+		BenchmarkTimer		timer;
+
+		initScene(postBenchmarkObjects);
+		sceneAnimated = true;
+		logger.log(LOG_INFO, "Post benchmark (%zu objects, %d effects, %d frames per mode)",
+			sceneObjects.size(), (int)POST_EFFECT_COUNT, measuredFrames);
+		for (int mode = 0; mode < POST_MODE_COUNT && renderRunning.load(); mode++)
+		{
+			setPostMode((PostMode)mode);
+			bytesPerPixel[mode] = postBytesPerPixel;
+			lazyMemory[mode] = views[0].postLazyMemory;
+			frameResults[mode] = BenchmarkStats(string(postModeNames[mode]) + " frame");
+			gpuResults[mode] = BenchmarkStats(string(postModeNames[mode]) + " GPU");
+			for (int frame = 0; frame < warmupFrames + measuredFrames && renderRunning.load(); frame++)
+			{
+				timer.reset();
+				drawFrame();
+				if (frame < warmupFrames)
+					continue;
+				frameResults[mode].add(timer.elapsedMs());
+				gpuResults[mode].add(lastGpuMs);
+			}
+		}
+		setPostMode(defaultPostMode);
+
+		pixels = (double)views[0].renderExtent.width * views[0].renderExtent.height;
+		for (int mode = 0; mode < POST_MODE_COUNT; mode++)
+		{
+			if (!frameResults[mode].count())
+				continue;
+			frameResults[mode].report();
+			gpuResults[mode].report();
+			megabytes = pixels * bytesPerPixel[mode] / 1000000.0;
+			cout << fixed << setprecision(2) << "  " << bytesPerPixel[mode] << " B/pixel, " << megabytes << "MB per frame, "
+				<< megabytes / max(gpuResults[mode].mean(), 1e-6) << "GB/s at the GPU time"
+				<< (lazyMemory[mode] ? ", lazily allocated" : "") << defaultfloat << endl;
+		}
+	}
+#endif
+
+#ifdef _DRAW_SORT_BENCHMARK
+	/*
+	** Draws drawSortBenchmarkObjects objects, all in view, spread over
+	** sceneMaterialMax pipelines, recorded in object order then in sort key
+	** order. Prints the frame time, the CPU time of the prepare tasks (which
+	** sort) and of the record tasks summed over the chunks, and the binds
+	** recorded per frame and how many fewer than the same draws take in
+	** object order (none for the object order itself).
+	*/
+	void	runDrawSortBenchmark()
+	{
+		const int			warmupFrames = 100;
+		const int			measuredFrames = 1000;
+		const char			*orderNames[2] = { "object order", "sorted" };
+		const glm::quat		identity(1.0f, 0.0f, 0.0f, 0.0f);
+		mt19937				random(42);
+		uniform_real_distribution<float>	position(-0.9f, 0.9f);
+		BenchmarkStats		frameResults[2];
+		BenchmarkStats		prepareResults[2];
+		BenchmarkStats		recordResults[2];
+		BenchmarkStats		bindResults[2];
+		BenchmarkStats		avoidedResults[2];
+		double				prepareMs;
+		double				recordMs;
+		BenchmarkTimer		timer;
+
+		initScene(drawSortBenchmarkObjects, 0.005f, 0.01f);
+		for (size_t i = 0; i < scene.size(); i++)
+			scene.setTransform(i, glm::vec3(position(random), position(random), 0.0f), identity, scene.field(SCENE_SCALE)[i]);
+		sceneAnimated = false;
+		setSceneMaterials(sceneMaterialMax);
+		logger.log(LOG_INFO, "Draw sort benchmark (%zu objects, %u pipelines, %d frames per order)",
+			sceneObjects.size(), sceneMaterials, measuredFrames);
+		for (int order = 0; order < 2 && renderRunning.load(); order++)
+		{
+			drawSortEnabled = (order != 0);
+			frameResults[order] = BenchmarkStats(string(orderNames[order]) + " frame");
+			prepareResults[order] = BenchmarkStats(string(orderNames[order]) + " prepare");
+			recordResults[order] = BenchmarkStats(string(orderNames[order]) + " record");
+			bindResults[order] = BenchmarkStats(string(orderNames[order]) + " binds");
+			avoidedResults[order] = BenchmarkStats(string(orderNames[order]) + " binds avoided");
+			for (int frame = 0; frame < warmupFrames + measuredFrames && renderRunning.load(); frame++)
+			{
+				timer.reset();
+				drawFrame();
+				if (frame < warmupFrames)
+					continue;
+				frameResults[order].add(timer.elapsedMs());
+				prepareMs = 0.0;
+				recordMs = 0.0;
+				for (TaskGraph::TaskId id = 0; id < frameGraph.size(); id++)
+				{
+					const TaskTiming	&timing = frameGraph.timing(id);
+
+					if (timing.name == string("prepare"))
+						prepareMs += timing.durationNs / 1000000.0;
+					else if (timing.name == string("record"))
+						recordMs += timing.durationNs / 1000000.0;
+				}
+				prepareResults[order].add(prepareMs);
+				recordResults[order].add(recordMs);
+				bindResults[order].add((double)lastBinds);
+				avoidedResults[order].add((double)lastBindsAvoided);
+			}
+		}
+		drawSortEnabled = true;
+		setSceneMaterials(1);
+
+		for (int order = 0; order < 2; order++)
+		{
+			if (!frameResults[order].count())
+				continue;
+			frameResults[order].report();
+			prepareResults[order].report();
+			recordResults[order].report();
+			cout << fixed << setprecision(0) << "  " << bindResults[order].mean() << " binds, " << avoidedResults[order].mean()
+				<< " avoided per frame, " << currentFrameState().visible << " draws" << defaultfloat << endl;
+		}
+	}
+#endif
+
+#ifdef _MSAA_BENCHMARK
+	/*
+	** Renders msaaBenchmarkObjects objects at every sample count up to 8x
+	** the device supports and prints the frame and GPU time, and the memory
+	** of the multisample targets: allocated, and committed as
+	** vkGetDeviceMemoryCommitment sees it, which stays at 0 for lazily
+	** allocated memory the samples never leave the tiles of.
+	*/
+	void	runMsaaBenchmark()
+	{
+		const int						warmupFrames = 100;
+		const int						measuredFrames = 1000;
+		const VkSampleCountFlagBits		sampleCounts[4] = { VK_SAMPLE_COUNT_1_BIT, VK_SAMPLE_COUNT_2_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_8_BIT };
+		BenchmarkStats					frameResults[4];
+		BenchmarkStats					gpuResults[4];
+		VkDeviceSize					allocated[4] = {};
+		VkDeviceSize					committed[4] = {};
+		VkDeviceSize					bytes;
+		bool							lazyMemory[4] = {};
+		BenchmarkTimer					timer;
+
+		initScene(msaaBenchmarkObjects);
+		sceneAnimated = true;
+		logger.log(LOG_INFO, "MSAA benchmark (%zu objects, %s, %d frames per sample count)",
+			sceneObjects.size(), postModeNames[postMode], measuredFrames);
+		for (int i = 0; i < 4 && renderRunning.load(); i++)
+		{
+			if (!(msaaSampleCounts & sampleCounts[i]))
+				continue;
+			setMsaaSamples(sampleCounts[i]);
+			frameResults[i] = BenchmarkStats(to_string((unsigned)sampleCounts[i]) + "x frame");
+			gpuResults[i] = BenchmarkStats(to_string((unsigned)sampleCounts[i]) + "x GPU");
+			for (int frame = 0; frame < warmupFrames + measuredFrames && renderRunning.load(); frame++)
+			{
+				timer.reset();
+				drawFrame();
+				if (frame < warmupFrames)
+					continue;
+				frameResults[i].add(timer.elapsedMs());
+				gpuResults[i].add(lastGpuMs);
+			}
+			for (const View &view : views)
+			{
+				if (view.msaaMemory == VK_NULL_HANDLE)
+					continue;
+				bytes = view.msaaMemorySize;
+				if (view.msaaLazyMemory)
+					vkGetDeviceMemoryCommitment(device, view.msaaMemory, &bytes);
+				allocated[i] += view.msaaMemorySize;
+				committed[i] += bytes;
+			}
+			lazyMemory[i] = views[0].msaaLazyMemory;
+		}
+		setMsaaSamples(defaultMsaaSamples);
+
+		for (int i = 0; i < 4; i++)
+		{
+			if (!frameResults[i].count())
+				continue;
+			frameResults[i].report();
+			gpuResults[i].report();
+			cout << fixed << setprecision(2) << "  " << allocated[i] / 1000000.0 << "MB multisampled, " << committed[i] / 1000000.0
+				<< "MB committed" << (lazyMemory[i] ? ", lazily allocated" : "") << defaultfloat << endl;
+		}
+	}
+#endif
+
+#ifdef _SUBMIT_BENCHMARK
+	/*
+	** Streams submitBenchmarkUploads copies before every frame, two ways:
+	** each one submitted alone on the graphics queue and waited for with
+	** vkQueueWaitIdle (the single time commands before the timelines), then
+	** all of them as batches of the transfer timeline, one vkQueueSubmit the
+	** frame waits for on the GPU; the CPU only checks the previous frame's
+	** copies are done before submitting them again. Prints the frame time,
+	** the CPU time of the uploads, and the vkQueueSubmit calls and blocking
+	** CPU waits per frame, the frame's own included.
+	*/
+	void	runSubmitBenchmark()
+	{
+		const int					warmupFrames = 100;
+		const int					measuredFrames = 1000;
+		const char					*modeNames[2] = { "queue idle", "timelines" };
+		const VkDeviceSize			size = submitBenchmarkUploads * submitBenchmarkUploadSize;
+		VkBuffer					staging;
+		VkDeviceMemory				stagingMemory;
+		VkBuffer					target;
+		VkDeviceMemory				targetMemory;
+		vector<VkCommandBuffer>		copies[2];
+		VkCommandPool				pools[2] = { commandPool, transferCommandPool };
+		VkCommandBufferAllocateInfo	allocInfo = {};
+		VkCommandBufferBeginInfo	beginInfo = {};
+		VkBufferCopy				region = {};
+		VkSubmitInfo				submitInfo = {};
+		SubmitBatch					batch;
+		SubmitPoint					uploaded = {};
+		SubmitStats					stats;
+		BenchmarkStats				frameResults[2];
+		BenchmarkStats				uploadResults[2];
+		double						submits[2] = {};
+		double						waits[2] = {};
+		double						uploadMs;
+		BenchmarkTimer				timer;
+		BenchmarkTimer				uploadTimer;
+
+		createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging, stagingMemory);
+		createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target, targetMemory, true);
+		for (int mode = 0; mode < 2; mode++)
+		{
+			copies[mode].resize(submitBenchmarkUploads);
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = pools[mode];
+			allocInfo.commandBufferCount = (uint32_t)submitBenchmarkUploads;
+			if (vkAllocateCommandBuffers(device, &allocInfo, copies[mode].data()) != VK_SUCCESS)
+				throw runtime_error("Failed to allocate command buffer!");
+			for (size_t i = 0; i < submitBenchmarkUploads; i++)
+			{
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				vkBeginCommandBuffer(copies[mode][i], &beginInfo);
+				region.srcOffset = i * submitBenchmarkUploadSize;
+				region.dstOffset = i * submitBenchmarkUploadSize;
+				region.size = submitBenchmarkUploadSize;
+				vkCmdCopyBuffer(copies[mode][i], staging, target, 1, &region);
+				vkEndCommandBuffer(copies[mode][i]);
+			}
+		}
+
+		logger.log(LOG_INFO, "Submit benchmark (%zu uploads of %zuKB per frame, %s, %d frames per mode)", submitBenchmarkUploads,
+			(size_t)(submitBenchmarkUploadSize / 1024), (transferQueue != graphicsQueue) ? "transfer queue" : "no transfer queue", measuredFrames);
+		for (int mode = 0; mode < 2 && renderRunning.load(); mode++)
+		{
+			frameResults[mode] = BenchmarkStats(string(modeNames[mode]) + " frame");
+			uploadResults[mode] = BenchmarkStats(string(modeNames[mode]) + " uploads");
+			for (int frame = 0; frame < warmupFrames + measuredFrames && renderRunning.load(); frame++)
+			{
+				timer.reset();
+				scheduler.resetStats();
+				if (mode == 0)
+				{
+					for (VkCommandBuffer copy : copies[0])
+					{
+						submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+						submitInfo.commandBufferCount = 1;
+						submitInfo.pCommandBuffers = &copy;
+						if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+							throw runtime_error("Failed to submit transfer command buffer!");
+						vkQueueWaitIdle(graphicsQueue);
+					}
+				}
+				else
+				{
+					scheduler.wait(uploaded);
+					for (VkCommandBuffer copy : copies[1])
+					{
+						batch.commandBuffers.assign(1, copy);
+						uploaded = scheduler.enqueue(transferTimeline, batch);
+					}
+					scheduler.flush();
+					frameDependencies.wait(uploaded, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+				}
+				uploadMs = timer.elapsedMs();
+				drawFrame();
+				stats = scheduler.stats();
+				if (frame < warmupFrames)
+					continue;
+				frameResults[mode].add(timer.elapsedMs());
+				uploadResults[mode].add(uploadMs);
+				submits[mode] += (double)(stats.submits + (mode == 0 ? submitBenchmarkUploads : 0)) / measuredFrames;
+				waits[mode] += (double)(stats.cpuWaits + (mode == 0 ? submitBenchmarkUploads : 0)) / measuredFrames;
+			}
+		}
+		vkDeviceWaitIdle(device);
+		for (int mode = 0; mode < 2; mode++)
+			vkFreeCommandBuffers(device, pools[mode], (uint32_t)copies[mode].size(), copies[mode].data());
+		vkDestroyBuffer(device, staging, hostAllocator.callbacks());
+		vkFreeMemory(device, stagingMemory, hostAllocator.callbacks());
+		vkDestroyBuffer(device, target, hostAllocator.callbacks());
+		vkFreeMemory(device, targetMemory, hostAllocator.callbacks());
+
+		for (int mode = 0; mode < 2; mode++)
+		{
+			if (!frameResults[mode].count())
+				continue;
+			frameResults[mode].report();
+			uploadResults[mode].report();
+			cout << fixed << setprecision(1) << "  " << submits[mode] << " vkQueueSubmit, " << waits[mode] << " CPU waits per frame" << defaultfloat << endl;
+		}
+	}
+#endif
+
+	/*
+	** Rebuilds what depends on the post mode and the sample count: render
+	** passes, the pipelines made for them, framebuffers, post and multisample
+	** images.
+	*/
+	void	rebuildRenderPasses(PostMode mode, VkSampleCountFlagBits samples)
+	{
+		vkDeviceWaitIdle(device);
+		vkDestroyPipeline(device, graphicsPipeline, hostAllocator.callbacks());
+		destroyMaterialPipelines();
+		destroyPostPipelines();
+		for (View &view : views)
+		{
+			vkDestroyFramebuffer(device, view.targetFramebuffer, hostAllocator.callbacks());
+			destroyPostTargets(view);
+			destroyMultisampleTarget(view);
+		}
+		destroyRenderPasses();
+		postMode = mode;
+		msaaSamples = samples;
+		createRenderPass();
+		createGraphicPipeline(graphicsPipeline, shaderConstants);
+		createMaterialPipelines();
+		createPostPipelines();
+		for (View &view : views)
+		{
+			createPostTargets(view);
+			createMultisampleTarget(view);
+			createFramebuffers(view);
+		}
+		frameDirty = true;
+	}
+
+	void	setPostMode(PostMode mode)
+	{
+		rebuildRenderPasses(mode, msaaSamples);
+	}
+
+	void	setMsaaSamples(VkSampleCountFlagBits samples)
+	{
+		rebuildRenderPasses(postMode, usableMsaaSamples(samples));
+	}
+
+	/*
+	** Render thread side: applies the queued window events. Resizes are
+	** coalesced so a drag recreates the swapchain once per frame at most, and
+	** the oldest input not yet on screen is remembered for the latency stats.
+	** Any event marks the frame dirty. M switches between continuous and
+	** on-demand rendering, C changes the scene (next color mode), A starts or
+	** stops the scene animation, R turns the dynamic resolution on or off, L
+	** the mesh LODs, P starts or stops a profiler capture, F cycles the post
+	** modes, B the number of scene materials, S the MSAA sample counts, D
+	** turns the draw sorting on or off. Window events apply to the view they
+	** come from; rendering is suspended once every view is minimized.
+	*/
+	void	processRenderEvents()
+	{
+		RenderEvent				event;
+		bool					sceneChanged;
+		double					now;
+		VkSampleCountFlagBits	samples;
+
+		sceneChanged = false;
+		now = glfwGetTime();
+		while (renderEvents.tryPop(event))
+		{
+			eventLatency.add((now - event.time) * 1000.0);
+			frameDirty = true;
+			if (event.type == RENDER_EVENT_KEY && event.action == GLFW_PRESS && event.code == GLFW_KEY_M)
+			{
+				renderMode = (renderMode.load() == RENDER_CONTINUOUS) ? RENDER_ON_DEMAND : RENDER_CONTINUOUS;
+				logger.log(LOG_INFO, "Render mode: %s", UtilizationMeter::modeName((RenderMode)renderMode.load()));
+			}
+			if (event.type == RENDER_EVENT_KEY && event.action == GLFW_PRESS && event.code == GLFW_KEY_C)
+				sceneChanged = true;
+			if (event.type == RENDER_EVENT_KEY && event.action == GLFW_PRESS && event.code == GLFW_KEY_A)
+			{
+				sceneAnimated = !sceneAnimated;
+				lastSimulationTime = glfwGetTime();
+			}
+			if (event.type == RENDER_EVENT_KEY && event.action == GLFW_PRESS && event.code == GLFW_KEY_R)
+			{
+				resolution.setEnabled(!resolution.enabled());
+				updateRenderExtents(0.0);
+				logger.log(LOG_INFO, "Dynamic resolution: %s", resolution.enabled() ? "on" : "off");
+			}
+			if (event.type == RENDER_EVENT_KEY && event.action == GLFW_PRESS && event.code == GLFW_KEY_L)
+			{
+				lodEnabled = !lodEnabled;
+				logger.log(LOG_INFO, "Mesh LODs: %s", lodEnabled ? "on" : "off");
+			}
+			if (event.type == RENDER_EVENT_KEY && event.action == GLFW_PRESS && event.code == GLFW_KEY_P)
+				toggleProfileCapture(profileTracePath);
+			if (event.type == RENDER_EVENT_KEY && event.action == GLFW_PRESS && event.code == GLFW_KEY_B)
+			{
+				setSceneMaterials(sceneMaterials % sceneMaterialMax + 1);
+				logger.log(LOG_INFO, "Scene materials: %u", sceneMaterials);
+			}
+			if (event.type == RENDER_EVENT_KEY && event.action == GLFW_PRESS && event.code == GLFW_KEY_S)
+			{
+				samples = (VkSampleCountFlagBits)(msaaSamples << 1);
+				setMsaaSamples((samples > VK_SAMPLE_COUNT_8_BIT || !(msaaSampleCounts & samples)) ? VK_SAMPLE_COUNT_1_BIT : samples);
+				logger.log(LOG_INFO, "MSAA: %ux", (unsigned)msaaSamples);
+			}
+			if (event.type == RENDER_EVENT_KEY && event.action == GLFW_PRESS && event.code == GLFW_KEY_D)
+			{
+				drawSortEnabled = !drawSortEnabled;
+				logger.log(LOG_INFO, "Draw sorting: %s", drawSortEnabled ? "on" : "off");
+			}
+			if (event.type == RENDER_EVENT_KEY && event.action == GLFW_PRESS && event.code == GLFW_KEY_F)
+			{
+				setPostMode((PostMode)((postMode + 1) % POST_MODE_COUNT));
+				logger.log(LOG_INFO, "Post-processing: %s (%u B/pixel)", postModeNames[postMode], postBytesPerPixel);
+			}
+			if (event.type == RENDER_EVENT_RESIZE)
+			{
+				views[event.view].windowExtent = { (uint32_t)event.width, (uint32_t)event.height };
+				views[event.view].resized = true;
+			}
+			else if (event.type == RENDER_EVENT_ICONIFY)
+				views[event.view].iconified = (event.code != 0);
+			else if (pendingInputTime < 0.0)
+				pendingInputTime = event.time;
+		}
+		allViewsMinimized = true;
+		for (size_t i = 0; i < views.size(); i++)
+		{
+			View	&view = views[i];
+
+			view.minimized = (view.iconified || view.windowExtent.width == 0 || view.windowExtent.height == 0);
+			if (!view.minimized && i < activeViews)
+				allViewsMinimized = false;
+		}
+		if (sceneChanged)
+		{
+			vkDeviceWaitIdle(device);
+			vkDestroyPipeline(device, graphicsPipeline, hostAllocator.callbacks());
+			destroyMaterialPipelines();
+			shaderConstants.colorMode = (shaderConstants.colorMode + 1) % 3;
+			createGraphicPipeline(graphicsPipeline, shaderConstants);
+			createMaterialPipelines();
+		}
+		for (View &view : views)
+		{
+			if (!view.resized || view.minimized)
+				continue;
+			vkDeviceWaitIdle(device);
+			recreateSwapChain(view);
+			view.resized = false;
+		}
+	}
+
+	/*
+	** Blocks the render thread until the window thread posts an event, the
+	** timeout (in seconds, none if negative) expires or the application quits.
+	*/
+	void	waitRenderEvents(double timeout)
+	{
+		unique_lock<mutex>	lock(renderWakeMutex);
+		auto				ready = [this]() { return (!renderEvents.empty() || !renderRunning.load()); };
+
+		renderSleeping.store(true, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		if (timeout < 0.0)
+			renderWake.wait(lock, ready);
+		else
+			renderWake.wait_for(lock, chrono::duration<double>(timeout), ready);
+		renderSleeping.store(false, memory_order_relaxed);
+	}
+
+	void	reportRenderStats(int fps)
+	{
+		ostringstream	stats;
+
+		stats << fixed << setprecision(2);
+		if (inputLatency.count())
+			stats << "input to present p50 " << inputLatency.percentile(0.5) << "ms p99 " << inputLatency.percentile(0.99) << "ms, ";
+		if (eventLatency.count())
+			stats << "event queue p50 " << eventLatency.percentile(0.5) << "ms p99 " << eventLatency.percentile(0.99) << "ms, ";
+		if (droppedRenderEvents.load())
+			stats << droppedRenderEvents.exchange(0) << " events dropped, ";
+		stats << "tasks (" << jobs->workerCount() + 1 << " threads, " << currentFrameState().visible << "/" << sceneObjects.size() << " drawn, "
+			<< lastTriangles << " triangles, " << lastBinds << " binds, " << lastBindsAvoided << " avoided)";
+		for (BenchmarkStats &stage : stageTimings)
+		{
+			stats << " " << stage.name() << " " << stage.mean() << "ms";
+			stage.clear();
+		}
+		stats << ", resolution " << 100.0f * resolution.scale() << "% (" << views[0].renderExtent.width << "x" << views[0].renderExtent.height
+			<< ", GPU " << resolution.smoothedMs() << "ms / " << resolution.targetMs() << "ms), ";
+		hostAllocator.reportFrame(stats);
+		if (gpuCounters.frames())
+		{
+			stats << ", GPU " << (uint64_t)gpuCounters.average(GPU_INPUT_PRIMITIVES) << " primitives " << (uint64_t)gpuCounters.average(GPU_FRAGMENT_INVOCATIONS)
+				<< " fragments per frame";
+			if (!gpuCounters.write(gpuCountersPrometheusPath, gpuCountersJsonPath))
+				logger.log(LOG_WARNING, "GPU counters: failed to write %s or %s", gpuCountersPrometheusPath, gpuCountersJsonPath);
+		}
+		logger.log(LOG_INFO, "%d FPS, %s", fps, stats.str().c_str());
+		inputLatency.clear();
+		eventLatency.clear();
+	}
+
+	void	renderLoop()
+	{
+		int		fps;
+		double	curentTime;
+		double	lastTime;
+
+		Profiler::setThreadName("render");
+		try
+		{
+#if defined(_SPECIALIZATION_BENCHMARK)
+			runSpecializationBenchmark();
+#elif defined(_JOB_BENCHMARK)
+			runJobBenchmark();
+#elif defined(_VIEW_BENCHMARK)
+			runViewBenchmark();
+#elif defined(_MESH_BENCHMARK)
+			runMeshBenchmark();
+#elif defined(_LOD_BENCHMARK)
+			runLodBenchmark();
+#elif defined(_SCENE_BENCHMARK)
+			runSceneBenchmark();
+#elif defined(_POST_BENCHMARK)
+			runPostBenchmark();
+#elif defined(_DRAW_SORT_BENCHMARK)
+			runDrawSortBenchmark();
+#elif defined(_MSAA_BENCHMARK)
+			runMsaaBenchmark();
+#elif defined(_SUBMIT_BENCHMARK)
+			runSubmitBenchmark();
+#else
+			fps = 0;
+			lastTime = glfwGetTime();
+			while (renderRunning.load())
+			{
+				curentTime = glfwGetTime();
+				if (curentTime - lastTime > 1.0)
+				{
+					lastTime = curentTime;
+					if (fps)
+						reportRenderStats(fps);
+					fps = 0;
+				}
+				processRenderEvents();
+				/*
+				** Minimized: suspended until the window comes back. Idle in
+				** on-demand mode: sleep until the next event, or until the
+				** pending stats are due.
+				*/
+				if (allViewsMinimized || (renderMode.load() == RENDER_ON_DEMAND && !frameDirty))
+				{
+					waitRenderEvents((fps && !allViewsMinimized) ? max(0.0, 1.0 - (curentTime - lastTime)) : -1.0);
+					continue;
+				}
+				frameDirty = sceneAnimated;
+				drawFrame();
+				// drawFrame waits for the presentation queue: the frame is on screen
+				if (pendingInputTime >= 0.0)
+				{
+					inputLatency.add((glfwGetTime() - pendingInputTime) * 1000.0);
+					pendingInputTime = -1.0;
+				}
+				fps++;
+#ifdef _PROFILE_STARTUP
+				if (++profiledFrames == startupProfileFrames && Profiler::enabled())
+					toggleProfileCapture(startupTracePath);
+#endif
+			}
+#endif
+		}
+		catch (...)
+		{
+			renderError = current_exception();
+		}
+		for (View &view : views)
+			glfwSetWindowShouldClose(view.window, GLFW_TRUE);
+		glfwPostEmptyEvent();
+	}
+
+	void	reportUtilization()
+	{
+		UtilizationSample	sample;
+		ostringstream		stats;
+
+		sample = utilization.sample((RenderMode)renderMode.load());
+		stats << fixed << setprecision(1) << UtilizationMeter::modeName((RenderMode)renderMode.load())
+			<< ": " << sample.frames << " frames, CPU " << sample.cpuPercent << "%, GPU ";
+		if (sample.gpuPercent < 0.0)
+			stats << "n/a";
+		else
+			stats << sample.gpuPercent << "%";
+		logger.log(LOG_INFO, "%s", stats.str().c_str());
+	}
+
+	/*
+	** The main thread only handles OS events: acquire, record, submit and
+	** present all run on renderThread, so a blocked event loop (window drag,
+	** modal resize) never freezes the frames. It sleeps in the OS event wait
+	** and only wakes up on its own to sample the utilization. Closing any of
+	** the windows quits.
+	*/
+	void	mainLoop()
+	{
+		double	lastReport;
+
+		renderRunning = true;
+		renderThread = thread(&HelloTriangleApplication::renderLoop, this);
+		lastReport = glfwGetTime();
+		while (none_of(views.begin(), views.end(), [](const View &view) { return (glfwWindowShouldClose(view.window) != 0); }))
+		{
+			glfwWaitEventsTimeout(max(0.001, lastReport + utilizationReportInterval - glfwGetTime()));
+			if (glfwGetTime() - lastReport >= utilizationReportInterval)
+			{
+				lastReport = glfwGetTime();
+				reportUtilization();
+			}
+		}
+		renderRunning = false;
+		wakeRenderThread();
+		renderThread.join();
+		utilization.sample((RenderMode)renderMode.load());
+		vkDeviceWaitIdle(device);
+		if (renderError)
+			rethrow_exception(renderError);
+	}
+
+	void	cleanup()
+	{
+		if (trace.capturing())
+			stopTraceCapture();
+		for (View &view : views)
+		{
+			for (VkSemaphore semaphore : view.renderFinishedSemaphores)
+				vkDestroySemaphore(device, semaphore, hostAllocator.callbacks());
+			vkDestroySemaphore(device, view.imageAvailableSemaphore, hostAllocator.callbacks());
+			destroyCounterQueries(view);
+			cleanupSwapChain(view);
+		}
+
+		vkDestroyPipeline(device, graphicsPipeline, hostAllocator.callbacks());
+		destroyMaterialPipelines();
+		destroyPostPipelines();
+		vkDestroyPipelineLayout(device, pipelineLayout, hostAllocator.callbacks());
+		vkDestroyPipelineLayout(device, postPipelineLayout, hostAllocator.callbacks());
+		vkDestroyDescriptorPool(device, postDescriptorPool, hostAllocator.callbacks());
+		vkDestroyDescriptorSetLayout(device, postSetLayout, hostAllocator.callbacks());
+		destroyRenderPasses();
+
+		destroyFrameChunks();
+		destroyMesh(sceneMesh);
+		vkDestroyCommandPool(device, commandPool, hostAllocator.callbacks());
+		vkDestroyCommandPool(device, transferCommandPool, hostAllocator.callbacks());
+		scheduler.destroy();
+		
+		vkDestroyDevice(device, hostAllocator.callbacks());
+		if (enableValidationLayers)
+			DestroyDebugUtilsMessengerEXT(instance, debugMessenger, hostAllocator.callbacks());
+		for (View &view : views)
+			vkDestroySurfaceKHR(instance, view.surface, hostAllocator.callbacks());
+		vkDestroyInstance(instance, hostAllocator.callbacks());
+		jobs.reset();
+		logger.stop();
+		hostAllocator.report(cout);
+		utilization.report(cout);
+		resolution.report(cout);
+		gpuCounters.report(cout);
+
+		for (View &view : views)
+			glfwDestroyWindow(view.window);
 		glfwTerminate();
 	}
 };
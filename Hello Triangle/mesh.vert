@@ -0,0 +1,37 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+layout(constant_id = 0) const float	VERTEX_SCALE = 1.0;
+
+/*
+** Same block as shader.frag: one range shared by both stages. The mesh
+** center and size are already folded into offset and scale.
+*/
+layout(push_constant) uniform PushConstants
+{
+	vec2	offset;
+	float	scale;
+	int		colorMode;
+} pushConstants;
+
+/*
+** MeshVertex: half position, snorm normal, half texture coordinates. The
+** formats of the vertex input state expand them to floats.
+*/
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec4 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+
+void main()
+{
+	// Meshes are y up, Vulkan clip space is y down
+	gl_Position = vec4(vec2(inPosition.x, -inPosition.y) * VERTEX_SCALE * pushConstants.scale + pushConstants.offset, 0.5, 1.0);
+	fragColor = normalize(inNormal.xyz) * 0.5 + 0.5;
+}
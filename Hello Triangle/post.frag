@@ -0,0 +1,45 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+/*
+** POST_EFFECT selects the effect at pipeline creation (see PostEffect):
+** 0 = tonemap, 1 = color grade, 2 = vignette. The previous result is read
+** at the same pixel through an input attachment: as subpasses of one render
+** pass, it never has to leave the tile.
+*/
+layout(constant_id = 0) const int	POST_EFFECT = 0;
+
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput inputColor;
+
+layout(push_constant) uniform PostPushConstants
+{
+	vec2	inverseExtent;
+} pushConstants;
+
+layout(location = 0) out vec4 outColor;
+
+void	main()
+{
+	vec3	color;
+	vec2	position;
+	float	luma;
+
+	color = subpassLoad(inputColor).rgb;
+	if (POST_EFFECT == 0)
+	{
+		// Filmic curve (Narkowicz's ACES fit), HDR to [0, 1]
+		color = clamp((color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14), 0.0, 1.0);
+	}
+	else if (POST_EFFECT == 1)
+	{
+		// A bit more saturation, warmer highlights
+		luma = dot(color, vec3(0.2126, 0.7152, 0.0722));
+		color = clamp(mix(vec3(luma), color, 1.15) * vec3(1.04, 1.0, 0.94), 0.0, 1.0);
+	}
+	else
+	{
+		position = gl_FragCoord.xy * pushConstants.inverseExtent - 0.5;
+		color *= 1.0 - 0.5 * smoothstep(0.3, 0.75, length(position));
+	}
+	outColor = vec4(color, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+/*
+** One triangle covering the viewport, without any vertex buffer: the post
+** effects shade every pixel once.
+*/
+void main()
+{
+	vec2	position;
+
+	position = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
\ No newline at end of file
@@ -1,10 +1,34 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+/*
+** COLOR_MODE selects the variant at pipeline creation: 0 = vertex colors,
+** 1 = grayscale, 2 = inverted. With DYNAMIC_COLOR_MODE the mode is read from
+** the push constants instead, which keeps the branch alive at runtime.
+*/
+layout(constant_id = 1) const int	COLOR_MODE = 0;
+layout(constant_id = 2) const bool	DYNAMIC_COLOR_MODE = false;
+
+layout(push_constant) uniform PushConstants
+{
+	vec2	offset;
+	float	scale;
+	int		colorMode;
+} pushConstants;
+
 layout(location = 0) in vec3 fragColor;
 layout(location = 0) out vec4 outColor;
 
 void	main()
 {
-	outColor = vec4(fragColor, 1.0);
+	int		mode;
+	vec3	color;
+
+	mode = DYNAMIC_COLOR_MODE ? pushConstants.colorMode : COLOR_MODE;
+	color = fragColor;
+	if (mode == 1)
+		color = vec3(dot(color, vec3(0.299, 0.587, 0.114)));
+	else if (mode == 2)
+		color = vec3(1.0) - color;
+	outColor = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -6,6 +6,18 @@ out gl_PerVertex
 	vec4 gl_Position;
 };
 
+layout(constant_id = 0) const float	VERTEX_SCALE = 1.0;
+
+/*
+** Same block as shader.frag: one range shared by both stages.
+*/
+layout(push_constant) uniform PushConstants
+{
+	vec2	offset;
+	float	scale;
+	int		colorMode;
+} pushConstants;
+
 layout(location = 0) out vec3 fragColor;
 
 vec2	positions[3] =	vec2[](vec2(0.0, -0.5),		vec2(0.5, 0.5),			vec2(-0.5, 0.5));
@@ -13,6 +25,6 @@ vec3	colors[3] =		vec3[](vec3(1.0, 0.0, 0.0),	vec3(0.0, 1.0, 0.0),	vec3(0.0, 0.0
 
 void main()
 {
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+	gl_Position = vec4(positions[gl_VertexIndex] * VERTEX_SCALE * pushConstants.scale + pushConstants.offset, 0.0, 1.0);
 	fragColor = colors[gl_VertexIndex];
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include <cstdlib>
+#include <iomanip>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "MeshFormat.h"
+#include "MeshSource.h"
+#include "MeshSimplify.h"
+
+using namespace std;
+
+/*
+** Offline side of the .vkmesh format (see MeshFormat.h): reads an OBJ or
+** glTF file, simplifies it into a chain of up to lodCount LODs (default
+** MESH_MAX_LODS, 1 disables them), quantizes and reorders it for the vertex
+** cache and the fetch, and writes the page aligned file the application
+** maps at load time.
+**
+**   MeshConverter <in.obj|in.gltf|in.glb> <out.vkmesh> [lodCount]
+*/
+
+static double	cacheMissRatio(const PackedMesh &mesh, const MeshLod &lod)
+{
+	return (averageCacheMissRatio(mesh.indices, lod.indexOffset, lod.indexCount, mesh.vertices.size()));
+}
+
+static void		convert(const string &input, const string &output, size_t lodCount)
+{
+	MeshData		source;
+	PackedMesh		packed;
+	double			missRatio;
+	uint64_t		outputSize;
+
+	source = loadMeshSource(input);
+	if (source.vertexCount() == 0 || source.indices.empty())
+		throw runtime_error(input + " has no triangles!");
+	if (source.normals.empty())
+		generateNormals(source);
+	packed = packMesh(source);
+	missRatio = cacheMissRatio(packed, packed.lods[0]);
+	buildLodChain(source, packed, lodCount);
+	optimizeMesh(packed);
+	writeMeshFile(packed, output);
+
+	outputSize = (uint64_t)ifstream(output, ios::ate | ios::binary).tellg();
+	cout << fixed << setprecision(3)
+		<< input << " -> " << output << endl
+		<< "  " << packed.vertices.size() << " vertices, " << packed.lods[0].indexCount / 3 << " triangles, "
+		<< packed.lods.size() << " LOD(s)" << endl
+		<< "  ACMR " << missRatio << " -> " << cacheMissRatio(packed, packed.lods[0]) << " (FIFO " << MESH_CACHE_SIZE << ")" << endl;
+	for (size_t i = 1; i < packed.lods.size(); i++)
+		cout << "  LOD " << i << ": " << packed.lods[i].indexCount / 3 << " triangles, error " << defaultfloat << packed.lods[i].error
+			<< fixed << ", ACMR " << cacheMissRatio(packed, packed.lods[i]) << endl;
+	cout << setprecision(1) << "  " << outputSize / 1024.0 << "KB written" << defaultfloat << endl;
+}
+
+int		main(int argc, char **argv)
+{
+	int		lodCount;
+
+	lodCount = (argc == 4) ? atoi(argv[3]) : MESH_MAX_LODS;
+	if ((argc != 3 && argc != 4) || lodCount < 1 || lodCount > MESH_MAX_LODS)
+	{
+		cerr << "usage: " << argv[0] << " <in.obj|in.gltf|in.glb> <out.vkmesh> [lodCount (1-" << MESH_MAX_LODS << ")]" << endl;
+		return (1);
+	}
+	try
+	{
+		convert(argv[1], argv[2], (size_t)lodCount);
+	}
+	catch (const runtime_error &e)
+	{
+		cerr << e.what() << endl;
+		return (1);
+	}
+	return (0);
+}
@@ -0,0 +1,1060 @@
+#include <map>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#include "Trace.h"
+#include "Benchmark.h"
+
+using namespace std;
+
+/*
+** Replays a .vktrace captured with _CAPTURE_TRACE (see Trace.h) on a
+** headless device, as fast as the GPU goes: the objects are created in the
+** order of their records, every submission is recorded again into primary
+** command buffers and submitted with up to replayFramesInFlight of them
+** pending. Reports the CPU recording, submission and GPU times per frame,
+** without the first replayWarmupFrames, and writes them all to a CSV file
+** on request.
+**
+**   TraceReplayer <capture.vktrace> [--csv <frames.csv>]
+*/
+
+static const size_t		replayFramesInFlight = 2;
+static const uint64_t	replayWarmupFrames = 10;
+
+struct					ReplayImage
+{
+	VkImage				image;
+	VkDeviceMemory		memory;
+};
+
+struct					ReplayBuffer
+{
+	VkBuffer			buffer;
+	VkDeviceMemory		memory;
+};
+
+/*
+** A frame in flight: its command buffers (one per command stream of the
+** submission), its fence and timestamps, and the CPU times of the frame.
+*/
+struct					ReplayFrame
+{
+	VkCommandPool			commandPool;
+	vector<VkCommandBuffer>	commandBuffers;
+	VkFence					fence;
+	bool					pending;
+	uint64_t				frame;
+	double					recordMs;
+	double					submitMs;
+};
+
+template <typename T>
+static vector<T>	readArray(TraceCursor &cursor)
+{
+	vector<T>	values;
+
+	values.resize(cursor.get<uint32_t>());
+	if (!values.empty())
+		cursor.bytes(values.data(), values.size() * sizeof(T));
+	return (values);
+}
+
+template <typename T>
+static T			lookup(const map<uint64_t, T> &objects, uint64_t id, const char *what)
+{
+	typename map<uint64_t, T>::const_iterator	found;
+
+	found = objects.find(id);
+	if (found == objects.end())
+		throw runtime_error(string("Trace refers to an undefined ") + what + "!");
+	return (found->second);
+}
+
+class TraceReplayer
+{
+public:
+	TraceReplayer() : instance(VK_NULL_HANDLE), physicalDevice(VK_NULL_HANDLE), device(VK_NULL_HANDLE), queue(VK_NULL_HANDLE),
+		queueFamily(0), timestampPeriod(0.0f), timestampPool(VK_NULL_HANDLE), descriptorPool(VK_NULL_HANDLE), uploadPool(VK_NULL_HANDLE),
+		frames(), nextFrame(0), retired(0), recordStats("record (CPU)"), submitStats("submit (CPU)"), gpuStats("frame (GPU)")
+	{
+	}
+
+	~TraceReplayer()
+	{
+		cleanup();
+	}
+
+	void	run(const string &path, const string &csvPath)
+	{
+		TraceRecordType		type;
+		TraceCursor			payload;
+		BenchmarkTimer		timer;
+		double				totalMs;
+		uint64_t			submitted;
+
+		reader.open(path);
+		createDevice();
+		createFrames();
+		if (!csvPath.empty())
+		{
+			csv.open(csvPath);
+			if (!csv.is_open())
+				throw runtime_error("Failed to open " + csvPath + " for writing!");
+			csv << "frame,record_ms,submit_ms,gpu_ms" << endl;
+		}
+
+		submitted = 0;
+		while (reader.next(type, payload))
+		{
+			if (type == TRACE_SUBMIT)
+			{
+				if (submitted == replayWarmupFrames)
+					timer.reset();
+				replaySubmit(payload);
+				submitted++;
+			}
+			else
+				createObject(type, payload);
+		}
+		for (size_t i = 0; i < replayFramesInFlight; i++)
+			retireFrame(frames[i]);
+		totalMs = timer.elapsedMs();
+
+		report(submitted, totalMs);
+	}
+
+private:
+	TraceReader							reader;
+	VkInstance							instance;
+	VkPhysicalDevice					physicalDevice;
+	VkPhysicalDeviceMemoryProperties	memoryProperties;
+	VkDevice							device;
+	VkQueue								queue;
+	uint32_t							queueFamily;
+	float								timestampPeriod;	// 0: no timestamps on the queue
+	VkQueryPool							timestampPool;
+	VkDescriptorPool					descriptorPool;
+	VkCommandPool						uploadPool;
+	ReplayFrame							frames[replayFramesInFlight];
+	size_t								nextFrame;
+	uint64_t							retired;
+	ofstream							csv;
+	BenchmarkStats						recordStats;
+	BenchmarkStats						submitStats;
+	BenchmarkStats						gpuStats;
+
+	map<uint64_t, VkShaderModule>			shaders;
+	map<uint64_t, ReplayBuffer>				buffers;
+	map<uint64_t, ReplayImage>				images;
+	map<uint64_t, VkImageView>				imageViews;
+	map<uint64_t, VkRenderPass>				renderPasses;
+	map<uint64_t, VkFramebuffer>			framebuffers;
+	map<uint64_t, VkDescriptorSetLayout>	setLayouts;
+	map<uint64_t, VkPipelineLayout>			pipelineLayouts;
+	map<uint64_t, VkPipeline>				pipelines;
+	map<uint64_t, VkDescriptorSet>			descriptorSets;
+
+	/*
+	** The first device with a graphics queue, the one of the capture when
+	** it is there.
+	*/
+	void	createDevice()
+	{
+		VkApplicationInfo				appInfo = {};
+		VkInstanceCreateInfo			instanceInfo = {};
+		VkDeviceQueueCreateInfo			queueInfo = {};
+		VkDeviceCreateInfo				deviceInfo = {};
+		VkPhysicalDeviceProperties		properties;
+		vector<VkPhysicalDevice>		devices;
+		vector<VkQueueFamilyProperties>	families;
+		uint32_t						count;
+		uint32_t						timestampBits;
+		const float						priority = 1.0f;
+		const TraceFileHeader			&header = reader.header();
+
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = "TraceReplayer";
+		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+		appInfo.pEngineName = "No Engine";
+		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+		appInfo.apiVersion = VK_API_VERSION_1_1;
+		instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceInfo.pApplicationInfo = &appInfo;
+		if (vkCreateInstance(&instanceInfo, NULL, &instance) != VK_SUCCESS)
+			throw runtime_error("Failed to create instance!");
+
+		vkEnumeratePhysicalDevices(instance, &count, NULL);
+		devices.resize(count);
+		vkEnumeratePhysicalDevices(instance, &count, devices.data());
+		timestampBits = 0;
+		for (VkPhysicalDevice candidate : devices)
+		{
+			vkGetPhysicalDeviceProperties(candidate, &properties);
+			vkGetPhysicalDeviceQueueFamilyProperties(candidate, &count, NULL);
+			families.resize(count);
+			vkGetPhysicalDeviceQueueFamilyProperties(candidate, &count, families.data());
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (!(families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+					continue;
+				if (physicalDevice == VK_NULL_HANDLE || (properties.vendorID == header.vendorID && properties.deviceID == header.deviceID))
+				{
+					physicalDevice = candidate;
+					queueFamily = i;
+					timestampBits = families[i].timestampValidBits;
+				}
+				break;
+			}
+		}
+		if (physicalDevice == VK_NULL_HANDLE)
+			throw runtime_error("Failed to find a GPU with a graphics queue!");
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		timestampPeriod = timestampBits ? properties.limits.timestampPeriod : 0.0f;
+		cout << "Captured on " << header.deviceName << " (driver " << hex << header.driverVersion << ")" << endl
+			<< "Replayed on " << properties.deviceName << " (driver " << properties.driverVersion << ")" << dec << endl;
+
+		queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueInfo.queueFamilyIndex = queueFamily;
+		queueInfo.queueCount = 1;
+		queueInfo.pQueuePriorities = &priority;
+		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.queueCreateInfoCount = 1;
+		deviceInfo.pQueueCreateInfos = &queueInfo;
+		if (vkCreateDevice(physicalDevice, &deviceInfo, NULL, &device) != VK_SUCCESS)
+			throw runtime_error("Failed to create logical device!");
+		vkGetDeviceQueue(device, queueFamily, 0, &queue);
+	}
+
+	/*
+	** The frames in flight, the timestamp pair of each one, and the pools
+	** the objects of the trace take their descriptor sets and uploads from.
+	*/
+	void	createFrames()
+	{
+		VkCommandPoolCreateInfo		poolInfo = {};
+		VkFenceCreateInfo			fenceInfo = {};
+		VkQueryPoolCreateInfo		queryInfo = {};
+		VkDescriptorPoolSize		poolSize = {};
+		VkDescriptorPoolCreateInfo	descriptorInfo = {};
+
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		for (ReplayFrame &frame : frames)
+		{
+			if (vkCreateCommandPool(device, &poolInfo, NULL, &frame.commandPool) != VK_SUCCESS)
+				throw runtime_error("Failed to create command pool!");
+			if (vkCreateFence(device, &fenceInfo, NULL, &frame.fence) != VK_SUCCESS)
+				throw runtime_error("Failed to create fence!");
+			frame.pending = false;
+		}
+		if (vkCreateCommandPool(device, &poolInfo, NULL, &uploadPool) != VK_SUCCESS)
+			throw runtime_error("Failed to create command pool!");
+
+		if (timestampPeriod > 0.0f)
+		{
+			queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryInfo.queryCount = (uint32_t)(2 * replayFramesInFlight);
+			if (vkCreateQueryPool(device, &queryInfo, NULL, &timestampPool) != VK_SUCCESS)
+				throw runtime_error("Failed to create query pool!");
+		}
+
+		// The application only uses input attachments, a few per window
+		poolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		poolSize.descriptorCount = 256;
+		descriptorInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptorInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+		descriptorInfo.maxSets = 256;
+		descriptorInfo.poolSizeCount = 1;
+		descriptorInfo.pPoolSizes = &poolSize;
+		if (vkCreateDescriptorPool(device, &descriptorInfo, NULL, &descriptorPool) != VK_SUCCESS)
+			throw runtime_error("Failed to create descriptor pool!");
+	}
+
+	int		findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+				return ((int)i);
+		}
+		return (-1);
+	}
+
+	VkDeviceMemory	allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties)
+	{
+		VkMemoryAllocateInfo	allocInfo = {};
+		VkDeviceMemory			memory;
+		int						type;
+
+		type = findMemoryType(requirements.memoryTypeBits, properties);
+		if (type < 0)
+			throw runtime_error("Failed to find suitable memory type!");
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = requirements.size;
+		allocInfo.memoryTypeIndex = (uint32_t)type;
+		if (vkAllocateMemory(device, &allocInfo, NULL, &memory) != VK_SUCCESS)
+			throw runtime_error("Failed to allocate memory!");
+		return (memory);
+	}
+
+	/*
+	** The application reuses a handle only after destroying its object:
+	** the old one goes once the frames that may use it are done. Objects
+	** destroyed without their handle coming back live until the end.
+	*/
+	template <typename T, typename Destroy>
+	void	redefine(map<uint64_t, T> &objects, uint64_t id, Destroy destroy)
+	{
+		typename map<uint64_t, T>::iterator	found;
+
+		found = objects.find(id);
+		if (found == objects.end())
+			return;
+		vkDeviceWaitIdle(device);
+		destroy(found->second);
+		objects.erase(found);
+	}
+
+	void	createObject(TraceRecordType type, TraceCursor &payload)
+	{
+		switch (type)
+		{
+		case TRACE_SHADER: createShader(payload); break;
+		case TRACE_BUFFER: createBuffer(payload); break;
+		case TRACE_IMAGE: createImage(payload); break;
+		case TRACE_IMAGE_VIEW: createImageView(payload); break;
+		case TRACE_RENDER_PASS: createRenderPass(payload); break;
+		case TRACE_FRAMEBUFFER: createFramebuffer(payload); break;
+		case TRACE_SET_LAYOUT: createSetLayout(payload); break;
+		case TRACE_PIPELINE_LAYOUT: createPipelineLayout(payload); break;
+		case TRACE_PIPELINE: createPipeline(payload); break;
+		case TRACE_DESCRIPTOR_SET: createDescriptorSet(payload); break;
+		case TRACE_DESCRIPTOR_WRITE: writeDescriptor(payload); break;
+		default: throw runtime_error("Corrupted trace record!");
+		}
+	}
+
+	void	createShader(TraceCursor &payload)
+	{
+		VkShaderModuleCreateInfo	createInfo = {};
+		VkShaderModule				shader;
+		uint64_t					id;
+		vector<uint32_t>			code;
+
+		id = payload.get<uint64_t>();
+		code.resize((size_t)payload.get<uint64_t>() / sizeof(uint32_t));
+		payload.bytes(code.data(), code.size() * sizeof(uint32_t));
+		redefine(shaders, id, [this](VkShaderModule old) { vkDestroyShaderModule(device, old, NULL); });
+		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		createInfo.codeSize = code.size() * sizeof(uint32_t);
+		createInfo.pCode = code.data();
+		if (vkCreateShaderModule(device, &createInfo, NULL, &shader) != VK_SUCCESS)
+			throw runtime_error("Failed to create shader module!");
+		shaders[id] = shader;
+	}
+
+	/*
+	** Device local, filled through a staging buffer when the trace has its
+	** contents.
+	*/
+	void	createBuffer(TraceCursor &payload)
+	{
+		VkBufferCreateInfo			bufferInfo = {};
+		VkMemoryRequirements		memRequirements;
+		VkCommandBufferAllocateInfo	allocInfo = {};
+		VkCommandBufferBeginInfo	beginInfo = {};
+		VkSubmitInfo				submitInfo = {};
+		VkCommandBuffer				commandBuffer;
+		VkBufferCopy				copyRegion = {};
+		ReplayBuffer				buffer;
+		ReplayBuffer				staging;
+		uint64_t					id;
+		VkDeviceSize				contentsSize;
+		const uint8_t				*contents;
+		void						*data;
+
+		id = payload.get<uint64_t>();
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = payload.get<VkDeviceSize>();
+		bufferInfo.usage = payload.get<VkBufferUsageFlags>() | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		contentsSize = payload.get<VkDeviceSize>();
+		contents = payload.skip((size_t)contentsSize);
+		redefine(buffers, id, [this](const ReplayBuffer &old) { destroyBuffer(old); });
+		if (vkCreateBuffer(device, &bufferInfo, NULL, &buffer.buffer) != VK_SUCCESS)
+			throw runtime_error("Failed to create buffer!");
+		vkGetBufferMemoryRequirements(device, buffer.buffer, &memRequirements);
+		buffer.memory = allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0);
+		buffers[id] = buffer;
+		if (contentsSize == 0)
+			return;
+
+		bufferInfo.size = contentsSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		if (vkCreateBuffer(device, &bufferInfo, NULL, &staging.buffer) != VK_SUCCESS)
+			throw runtime_error("Failed to create buffer!");
+		vkGetBufferMemoryRequirements(device, staging.buffer, &memRequirements);
+		staging.memory = allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		vkBindBufferMemory(device, staging.buffer, staging.memory, 0);
+		vkMapMemory(device, staging.memory, 0, contentsSize, 0, &data);
+		memcpy(data, contents, (size_t)contentsSize);
+		vkUnmapMemory(device, staging.memory);
+
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = uploadPool;
+		allocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+			throw runtime_error("Failed to allocate command buffer!");
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		copyRegion.size = contentsSize;
+		vkCmdCopyBuffer(commandBuffer, staging.buffer, buffer.buffer, 1, &copyRegion);
+		vkEndCommandBuffer(commandBuffer);
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+			throw runtime_error("Failed to submit buffer upload!");
+		vkQueueWaitIdle(queue);
+		vkFreeCommandBuffers(device, uploadPool, 1, &commandBuffer);
+		destroyBuffer(staging);
+	}
+
+	void	destroyBuffer(const ReplayBuffer &buffer)
+	{
+		vkDestroyBuffer(device, buffer.buffer, NULL);
+		vkFreeMemory(device, buffer.memory, NULL);
+	}
+
+	/*
+	** Transient attachments go to lazily allocated memory when the device
+	** has some, as in the application.
+	*/
+	void	createImage(TraceCursor &payload)
+	{
+		VkImageCreateInfo		imageInfo = {};
+		VkMemoryRequirements	memRequirements;
+		ReplayImage				image;
+		uint64_t				id;
+
+		id = payload.get<uint64_t>();
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = payload.get<VkImageType>();
+		imageInfo.format = payload.get<VkFormat>();
+		imageInfo.extent = payload.get<VkExtent3D>();
+		imageInfo.mipLevels = payload.get<uint32_t>();
+		imageInfo.arrayLayers = payload.get<uint32_t>();
+		imageInfo.samples = payload.get<VkSampleCountFlagBits>();
+		imageInfo.tiling = payload.get<VkImageTiling>();
+		imageInfo.usage = payload.get<VkImageUsageFlags>();
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		redefine(images, id, [this](const ReplayImage &old)
+		{
+			vkDestroyImage(device, old.image, NULL);
+			vkFreeMemory(device, old.memory, NULL);
+		});
+		if (vkCreateImage(device, &imageInfo, NULL, &image.image) != VK_SUCCESS)
+			throw runtime_error("Failed to create image!");
+		vkGetImageMemoryRequirements(device, image.image, &memRequirements);
+		if ((imageInfo.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) && findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) >= 0)
+			image.memory = allocate(memRequirements, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+		else
+			image.memory = allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		vkBindImageMemory(device, image.image, image.memory, 0);
+		images[id] = image;
+	}
+
+	void	createImageView(TraceCursor &payload)
+	{
+		VkImageViewCreateInfo	createInfo = {};
+		VkImageView				imageView;
+		uint64_t				id;
+
+		id = payload.get<uint64_t>();
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		createInfo.image = lookup(images, payload.get<uint64_t>(), "image").image;
+		createInfo.viewType = payload.get<VkImageViewType>();
+		createInfo.format = payload.get<VkFormat>();
+		createInfo.components = payload.get<VkComponentMapping>();
+		createInfo.subresourceRange = payload.get<VkImageSubresourceRange>();
+		redefine(imageViews, id, [this](VkImageView old) { vkDestroyImageView(device, old, NULL); });
+		if (vkCreateImageView(device, &createInfo, NULL, &imageView) != VK_SUCCESS)
+			throw runtime_error("Failed to create image view!");
+		imageViews[id] = imageView;
+	}
+
+	void	createRenderPass(TraceCursor &payload)
+	{
+		VkRenderPassCreateInfo					renderPassInfo = {};
+		VkRenderPass							renderPass;
+		uint64_t								id;
+		vector<VkAttachmentDescription>			attachments;
+		vector<VkSubpassDescription>			subpasses;
+		vector<VkSubpassDependency>				dependencies;
+		vector<vector<VkAttachmentReference>>	references;
+		vector<vector<uint32_t>>				preserved;
+
+		id = payload.get<uint64_t>();
+		attachments = readArray<VkAttachmentDescription>(payload);
+		subpasses.resize(payload.get<uint32_t>());
+		// Input, color, resolve and depth references of every subpass
+		references.resize(4 * subpasses.size());
+		preserved.resize(subpasses.size());
+		for (size_t i = 0; i < subpasses.size(); i++)
+		{
+			VkSubpassDescription	&subpass = subpasses[i];
+
+			for (size_t j = 0; j < 4; j++)
+				references[4 * i + j] = readArray<VkAttachmentReference>(payload);
+			preserved[i] = readArray<uint32_t>(payload);
+			subpass = {};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.inputAttachmentCount = (uint32_t)references[4 * i].size();
+			subpass.pInputAttachments = references[4 * i].data();
+			subpass.colorAttachmentCount = (uint32_t)references[4 * i + 1].size();
+			subpass.pColorAttachments = references[4 * i + 1].data();
+			subpass.pResolveAttachments = references[4 * i + 2].empty() ? NULL : references[4 * i + 2].data();
+			subpass.pDepthStencilAttachment = references[4 * i + 3].empty() ? NULL : references[4 * i + 3].data();
+			subpass.preserveAttachmentCount = (uint32_t)preserved[i].size();
+			subpass.pPreserveAttachments = preserved[i].data();
+		}
+		dependencies = readArray<VkSubpassDependency>(payload);
+		redefine(renderPasses, id, [this](VkRenderPass old) { vkDestroyRenderPass(device, old, NULL); });
+
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = (uint32_t)attachments.size();
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = (uint32_t)subpasses.size();
+		renderPassInfo.pSubpasses = subpasses.data();
+		renderPassInfo.dependencyCount = (uint32_t)dependencies.size();
+		renderPassInfo.pDependencies = dependencies.data();
+		if (vkCreateRenderPass(device, &renderPassInfo, NULL, &renderPass) != VK_SUCCESS)
+			throw runtime_error("Failed to create render pass!");
+		renderPasses[id] = renderPass;
+	}
+
+	void	createFramebuffer(TraceCursor &payload)
+	{
+		VkFramebufferCreateInfo		framebufferInfo = {};
+		VkFramebuffer				framebuffer;
+		uint64_t					id;
+		vector<VkImageView>			attachments;
+
+		id = payload.get<uint64_t>();
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = lookup(renderPasses, payload.get<uint64_t>(), "render pass");
+		framebufferInfo.width = payload.get<uint32_t>();
+		framebufferInfo.height = payload.get<uint32_t>();
+		framebufferInfo.layers = payload.get<uint32_t>();
+		attachments.resize(payload.get<uint32_t>());
+		for (VkImageView &attachment : attachments)
+			attachment = lookup(imageViews, payload.get<uint64_t>(), "image view");
+		framebufferInfo.attachmentCount = (uint32_t)attachments.size();
+		framebufferInfo.pAttachments = attachments.data();
+		redefine(framebuffers, id, [this](VkFramebuffer old) { vkDestroyFramebuffer(device, old, NULL); });
+		if (vkCreateFramebuffer(device, &framebufferInfo, NULL, &framebuffer) != VK_SUCCESS)
+			throw runtime_error("Failed to create framebuffer!");
+		framebuffers[id] = framebuffer;
+	}
+
+	void	createSetLayout(TraceCursor &payload)
+	{
+		VkDescriptorSetLayoutCreateInfo			setLayoutInfo = {};
+		VkDescriptorSetLayout					setLayout;
+		uint64_t								id;
+		vector<VkDescriptorSetLayoutBinding>	bindings;
+
+		id = payload.get<uint64_t>();
+		bindings.resize(payload.get<uint32_t>());
+		for (VkDescriptorSetLayoutBinding &binding : bindings)
+		{
+			binding = {};
+			binding.binding = payload.get<uint32_t>();
+			binding.descriptorType = payload.get<VkDescriptorType>();
+			binding.descriptorCount = payload.get<uint32_t>();
+			binding.stageFlags = payload.get<VkShaderStageFlags>();
+		}
+		redefine(setLayouts, id, [this](VkDescriptorSetLayout old) { vkDestroyDescriptorSetLayout(device, old, NULL); });
+		setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		setLayoutInfo.bindingCount = (uint32_t)bindings.size();
+		setLayoutInfo.pBindings = bindings.data();
+		if (vkCreateDescriptorSetLayout(device, &setLayoutInfo, NULL, &setLayout) != VK_SUCCESS)
+			throw runtime_error("Failed to create descriptor set layout!");
+		setLayouts[id] = setLayout;
+	}
+
+	void	createPipelineLayout(TraceCursor &payload)
+	{
+		VkPipelineLayoutCreateInfo		pipelineLayoutInfo = {};
+		VkPipelineLayout				pipelineLayout;
+		uint64_t						id;
+		vector<VkDescriptorSetLayout>	layouts;
+		vector<VkPushConstantRange>		pushConstantRanges;
+
+		id = payload.get<uint64_t>();
+		layouts.resize(payload.get<uint32_t>());
+		for (VkDescriptorSetLayout &layout : layouts)
+			layout = lookup(setLayouts, payload.get<uint64_t>(), "descriptor set layout");
+		pushConstantRanges = readArray<VkPushConstantRange>(payload);
+		redefine(pipelineLayouts, id, [this](VkPipelineLayout old) { vkDestroyPipelineLayout(device, old, NULL); });
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = (uint32_t)layouts.size();
+		pipelineLayoutInfo.pSetLayouts = layouts.data();
+		pipelineLayoutInfo.pushConstantRangeCount = (uint32_t)pushConstantRanges.size();
+		pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, NULL, &pipelineLayout) != VK_SUCCESS)
+			throw runtime_error("Failed to create pipeline layout!");
+		pipelineLayouts[id] = pipelineLayout;
+	}
+
+	/*
+	** Reads the state in the order TraceWriter::pipeline writes it.
+	*/
+	void	createPipeline(TraceCursor &payload)
+	{
+		VkGraphicsPipelineCreateInfo					pipelineInfo = {};
+		VkPipelineVertexInputStateCreateInfo			vertexInputInfo = {};
+		VkPipelineInputAssemblyStateCreateInfo			inputAssembly = {};
+		VkPipelineViewportStateCreateInfo				viewportState = {};
+		VkPipelineRasterizationStateCreateInfo			rasterizer = {};
+		VkPipelineMultisampleStateCreateInfo			multisampling = {};
+		VkPipelineColorBlendStateCreateInfo				colorBlending = {};
+		VkPipelineDynamicStateCreateInfo				dynamicState = {};
+		VkPipeline										pipeline;
+		uint64_t										id;
+		vector<VkPipelineShaderStageCreateInfo>			stages;
+		vector<string>									names;
+		vector<vector<VkSpecializationMapEntry>>		mapEntries;
+		vector<vector<uint8_t>>							specializationData;
+		vector<VkSpecializationInfo>					specializations;
+		vector<VkVertexInputBindingDescription>			bindings;
+		vector<VkVertexInputAttributeDescription>		attributes;
+		vector<VkViewport>								viewports;
+		vector<VkRect2D>								scissors;
+		vector<VkPipelineColorBlendAttachmentState>		blendAttachments;
+		vector<VkDynamicState>							dynamicStates;
+		vector<char>									name;
+
+		id = payload.get<uint64_t>();
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.layout = lookup(pipelineLayouts, payload.get<uint64_t>(), "pipeline layout");
+		pipelineInfo.renderPass = lookup(renderPasses, payload.get<uint64_t>(), "render pass");
+		pipelineInfo.subpass = payload.get<uint32_t>();
+		stages.resize(payload.get<uint32_t>());
+		names.resize(stages.size());
+		mapEntries.resize(stages.size());
+		specializationData.resize(stages.size());
+		specializations.resize(stages.size());
+		for (size_t i = 0; i < stages.size(); i++)
+		{
+			stages[i] = {};
+			stages[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			stages[i].stage = payload.get<VkShaderStageFlagBits>();
+			stages[i].module = lookup(shaders, payload.get<uint64_t>(), "shader module");
+			name = readArray<char>(payload);
+			names[i].assign(name.begin(), name.end());
+			stages[i].pName = names[i].c_str();
+			mapEntries[i].resize(payload.get<uint32_t>());
+			for (VkSpecializationMapEntry &entry : mapEntries[i])
+			{
+				entry.constantID = payload.get<uint32_t>();
+				entry.offset = payload.get<uint32_t>();
+				entry.size = payload.get<uint32_t>();
+			}
+			specializationData[i] = readArray<uint8_t>(payload);
+			if (mapEntries[i].empty())
+				continue;
+			specializations[i].mapEntryCount = (uint32_t)mapEntries[i].size();
+			specializations[i].pMapEntries = mapEntries[i].data();
+			specializations[i].dataSize = specializationData[i].size();
+			specializations[i].pData = specializationData[i].data();
+			stages[i].pSpecializationInfo = &specializations[i];
+		}
+		pipelineInfo.stageCount = (uint32_t)stages.size();
+		pipelineInfo.pStages = stages.data();
+
+		bindings = readArray<VkVertexInputBindingDescription>(payload);
+		attributes = readArray<VkVertexInputAttributeDescription>(payload);
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInputInfo.vertexBindingDescriptionCount = (uint32_t)bindings.size();
+		vertexInputInfo.pVertexBindingDescriptions = bindings.data();
+		vertexInputInfo.vertexAttributeDescriptionCount = (uint32_t)attributes.size();
+		vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = payload.get<VkPrimitiveTopology>();
+		inputAssembly.primitiveRestartEnable = payload.get<VkBool32>();
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.viewportCount = payload.get<uint32_t>();
+		viewportState.scissorCount = payload.get<uint32_t>();
+		viewports = readArray<VkViewport>(payload);
+		scissors = readArray<VkRect2D>(payload);
+		viewportState.pViewports = viewports.empty() ? NULL : viewports.data();
+		viewportState.pScissors = scissors.empty() ? NULL : scissors.data();
+		pipelineInfo.pViewportState = &viewportState;
+
+		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer.depthClampEnable = payload.get<VkBool32>();
+		rasterizer.rasterizerDiscardEnable = payload.get<VkBool32>();
+		rasterizer.polygonMode = payload.get<VkPolygonMode>();
+		rasterizer.cullMode = payload.get<VkCullModeFlags>();
+		rasterizer.frontFace = payload.get<VkFrontFace>();
+		rasterizer.lineWidth = payload.get<float>();
+		pipelineInfo.pRasterizationState = &rasterizer;
+
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.rasterizationSamples = payload.get<VkSampleCountFlagBits>();
+		multisampling.sampleShadingEnable = payload.get<VkBool32>();
+		multisampling.minSampleShading = payload.get<float>();
+		multisampling.alphaToCoverageEnable = payload.get<VkBool32>();
+		pipelineInfo.pMultisampleState = &multisampling;
+
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.logicOpEnable = payload.get<VkBool32>();
+		colorBlending.logicOp = payload.get<VkLogicOp>();
+		blendAttachments = readArray<VkPipelineColorBlendAttachmentState>(payload);
+		colorBlending.attachmentCount = (uint32_t)blendAttachments.size();
+		colorBlending.pAttachments = blendAttachments.data();
+		payload.bytes(colorBlending.blendConstants, sizeof(colorBlending.blendConstants));
+		pipelineInfo.pColorBlendState = &colorBlending;
+
+		dynamicStates = readArray<VkDynamicState>(payload);
+		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicState.dynamicStateCount = (uint32_t)dynamicStates.size();
+		dynamicState.pDynamicStates = dynamicStates.data();
+		pipelineInfo.pDynamicState = dynamicStates.empty() ? NULL : &dynamicState;
+		pipelineInfo.basePipelineIndex = -1;
+
+		redefine(pipelines, id, [this](VkPipeline old) { vkDestroyPipeline(device, old, NULL); });
+		if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &pipeline) != VK_SUCCESS)
+			throw runtime_error("Failed to create graphics pipeline!");
+		pipelines[id] = pipeline;
+	}
+
+	void	createDescriptorSet(TraceCursor &payload)
+	{
+		VkDescriptorSetAllocateInfo		allocInfo = {};
+		VkDescriptorSetLayout			setLayout;
+		VkDescriptorSet					set;
+		uint64_t						id;
+
+		id = payload.get<uint64_t>();
+		setLayout = lookup(setLayouts, payload.get<uint64_t>(), "descriptor set layout");
+		redefine(descriptorSets, id, [this](VkDescriptorSet old) { vkFreeDescriptorSets(device, descriptorPool, 1, &old); });
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &setLayout;
+		if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS)
+			throw runtime_error("Failed to allocate descriptor sets!");
+		descriptorSets[id] = set;
+	}
+
+	/*
+	** A set may be in use by the frames in flight: they are done first.
+	*/
+	void	writeDescriptor(TraceCursor &payload)
+	{
+		VkWriteDescriptorSet			write = {};
+		vector<VkDescriptorImageInfo>	imageInfos;
+
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = lookup(descriptorSets, payload.get<uint64_t>(), "descriptor set");
+		write.dstBinding = payload.get<uint32_t>();
+		write.dstArrayElement = payload.get<uint32_t>();
+		write.descriptorType = payload.get<VkDescriptorType>();
+		imageInfos.resize(payload.get<uint32_t>());
+		for (VkDescriptorImageInfo &imageInfo : imageInfos)
+		{
+			imageInfo = {};
+			imageInfo.imageView = lookup(imageViews, payload.get<uint64_t>(), "image view");
+			imageInfo.imageLayout = payload.get<VkImageLayout>();
+		}
+		write.descriptorCount = (uint32_t)imageInfos.size();
+		write.pImageInfo = imageInfos.data();
+		vkDeviceWaitIdle(device);
+		vkUpdateDescriptorSets(device, 1, &write, 0, NULL);
+	}
+
+	/*
+	** Re-records one command stream of the trace.
+	*/
+	void	recordCommands(VkCommandBuffer commandBuffer, TraceCursor commands)
+	{
+		VkRenderPassBeginInfo	renderPassInfo = {};
+		vector<VkClearValue>	clearValues;
+		VkBuffer				buffer;
+		VkDeviceSize			offset;
+		VkViewport				viewport;
+		VkRect2D				scissor;
+		VkPipelineLayout		layout;
+		VkDescriptorSet			set;
+		VkShaderStageFlags		stages;
+		uint32_t				values[5];
+
+		while (!commands.atEnd())
+		{
+			switch (commands.get<uint8_t>())
+			{
+			case TRACE_CMD_BEGIN_RENDER_PASS:
+				renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+				renderPassInfo.renderPass = lookup(renderPasses, commands.get<uint64_t>(), "render pass");
+				renderPassInfo.framebuffer = lookup(framebuffers, commands.get<uint64_t>(), "framebuffer");
+				renderPassInfo.renderArea = commands.get<VkRect2D>();
+				clearValues = readArray<VkClearValue>(commands);
+				renderPassInfo.clearValueCount = (uint32_t)clearValues.size();
+				renderPassInfo.pClearValues = clearValues.data();
+				vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+				break;
+			case TRACE_CMD_NEXT_SUBPASS:
+				vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+				break;
+			case TRACE_CMD_END_RENDER_PASS:
+				vkCmdEndRenderPass(commandBuffer);
+				break;
+			case TRACE_CMD_BIND_PIPELINE:
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, lookup(pipelines, commands.get<uint64_t>(), "pipeline"));
+				break;
+			case TRACE_CMD_BIND_DESCRIPTOR_SET:
+				layout = lookup(pipelineLayouts, commands.get<uint64_t>(), "pipeline layout");
+				set = lookup(descriptorSets, commands.get<uint64_t>(), "descriptor set");
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &set, 0, NULL);
+				break;
+			case TRACE_CMD_BIND_VERTEX_BUFFER:
+				buffer = lookup(buffers, commands.get<uint64_t>(), "buffer").buffer;
+				offset = commands.get<VkDeviceSize>();
+				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &buffer, &offset);
+				break;
+			case TRACE_CMD_BIND_INDEX_BUFFER:
+				buffer = lookup(buffers, commands.get<uint64_t>(), "buffer").buffer;
+				offset = commands.get<VkDeviceSize>();
+				vkCmdBindIndexBuffer(commandBuffer, buffer, offset, commands.get<VkIndexType>());
+				break;
+			case TRACE_CMD_SET_VIEWPORT:
+				viewport = commands.get<VkViewport>();
+				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+				break;
+			case TRACE_CMD_SET_SCISSOR:
+				scissor = commands.get<VkRect2D>();
+				vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+				break;
+			case TRACE_CMD_PUSH_CONSTANTS:
+				layout = lookup(pipelineLayouts, commands.get<uint64_t>(), "pipeline layout");
+				stages = commands.get<VkShaderStageFlags>();
+				values[0] = commands.get<uint32_t>();
+				values[1] = commands.get<uint32_t>();
+				vkCmdPushConstants(commandBuffer, layout, stages, values[0], values[1], commands.skip(values[1]));
+				break;
+			case TRACE_CMD_DRAW:
+				commands.bytes(values, 4 * sizeof(uint32_t));
+				vkCmdDraw(commandBuffer, values[0], values[1], values[2], values[3]);
+				break;
+			case TRACE_CMD_DRAW_INDEXED:
+				commands.bytes(values, 5 * sizeof(uint32_t));
+				vkCmdDrawIndexed(commandBuffer, values[0], values[1], values[2], (int32_t)values[3], values[4]);
+				break;
+			default:
+				throw runtime_error("Corrupted trace command stream!");
+			}
+		}
+	}
+
+	/*
+	** Records the streams of a submission into the command buffers of the
+	** next frame in flight, between two timestamps, and submits them.
+	*/
+	void	replaySubmit(TraceCursor &payload)
+	{
+		ReplayFrame					&frame = frames[nextFrame];
+		VkCommandBufferAllocateInfo	allocInfo = {};
+		VkCommandBufferBeginInfo	beginInfo = {};
+		VkSubmitInfo				submitInfo = {};
+		BenchmarkTimer				timer;
+		uint32_t					count;
+		uint32_t					query;
+		size_t						size;
+
+		retireFrame(frame);
+		frame.frame = payload.get<uint64_t>();
+		count = payload.get<uint32_t>();
+		if (count == 0)
+			return;
+		timer.reset();
+		vkResetCommandPool(device, frame.commandPool, 0);
+		if (frame.commandBuffers.size() < count)
+		{
+			frame.commandBuffers.resize(count);
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = frame.commandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = count;
+			vkFreeCommandBuffers(device, frame.commandPool, count, frame.commandBuffers.data());
+			if (vkAllocateCommandBuffers(device, &allocInfo, frame.commandBuffers.data()) != VK_SUCCESS)
+				throw runtime_error("Failed to allocate command buffers!");
+		}
+		query = (uint32_t)(2 * nextFrame);
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (vkBeginCommandBuffer(frame.commandBuffers[i], &beginInfo) != VK_SUCCESS)
+				throw runtime_error("Failed to begin recording command buffer!");
+			if (i == 0 && timestampPool != VK_NULL_HANDLE)
+			{
+				vkCmdResetQueryPool(frame.commandBuffers[i], timestampPool, query, 2);
+				vkCmdWriteTimestamp(frame.commandBuffers[i], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, query);
+			}
+			size = (size_t)payload.get<uint64_t>();
+			recordCommands(frame.commandBuffers[i], TraceCursor(payload.skip(size), size));
+			if (i == count - 1 && timestampPool != VK_NULL_HANDLE)
+				vkCmdWriteTimestamp(frame.commandBuffers[i], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, query + 1);
+			if (vkEndCommandBuffer(frame.commandBuffers[i]) != VK_SUCCESS)
+				throw runtime_error("Failed to record command buffer!");
+		}
+		frame.recordMs = timer.elapsedMs();
+
+		timer.reset();
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = count;
+		submitInfo.pCommandBuffers = frame.commandBuffers.data();
+		if (vkQueueSubmit(queue, 1, &submitInfo, frame.fence) != VK_SUCCESS)
+			throw runtime_error("Failed to submit draw command buffer!");
+		frame.submitMs = timer.elapsedMs();
+		frame.pending = true;
+		nextFrame = (nextFrame + 1) % replayFramesInFlight;
+	}
+
+	/*
+	** Waits for the frame that last used these resources and adds its times.
+	*/
+	void	retireFrame(ReplayFrame &frame)
+	{
+		uint64_t	timestamps[2];
+		double		gpuMs;
+
+		if (!frame.pending)
+			return;
+		vkWaitForFences(device, 1, &frame.fence, VK_TRUE, numeric_limits<uint64_t>::max());
+		vkResetFences(device, 1, &frame.fence);
+		frame.pending = false;
+		gpuMs = 0.0;
+		if (timestampPool != VK_NULL_HANDLE)
+		{
+			vkGetQueryPoolResults(device, timestampPool, (uint32_t)(2 * (&frame - frames)), 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+			gpuMs = (timestamps[1] - timestamps[0]) * timestampPeriod / 1000000.0;
+		}
+		if (csv.is_open())
+			csv << frame.frame << "," << frame.recordMs << "," << frame.submitMs << "," << gpuMs << endl;
+		if (retired++ >= replayWarmupFrames)
+		{
+			recordStats.add(frame.recordMs);
+			submitStats.add(frame.submitMs);
+			if (timestampPool != VK_NULL_HANDLE)
+				gpuStats.add(gpuMs);
+		}
+	}
+
+	void	report(uint64_t submitted, double totalMs)
+	{
+		cout << submitted << " frames replayed";
+		if (submitted > replayWarmupFrames)
+			cout << fixed << setprecision(1) << ", " << (submitted - replayWarmupFrames) * 1000.0 / totalMs << " fps after "
+				<< replayWarmupFrames << " warmup frames" << defaultfloat;
+		cout << endl;
+		recordStats.report();
+		submitStats.report();
+		if (timestampPool != VK_NULL_HANDLE)
+			gpuStats.report();
+		else
+			cout << "No timestamps on this queue: no GPU times" << endl;
+	}
+
+	void	cleanup()
+	{
+		if (device == VK_NULL_HANDLE)
+		{
+			if (instance != VK_NULL_HANDLE)
+				vkDestroyInstance(instance, NULL);
+			return;
+		}
+		vkDeviceWaitIdle(device);
+		for (auto &pipeline : pipelines)
+			vkDestroyPipeline(device, pipeline.second, NULL);
+		for (auto &layout : pipelineLayouts)
+			vkDestroyPipelineLayout(device, layout.second, NULL);
+		for (auto &layout : setLayouts)
+			vkDestroyDescriptorSetLayout(device, layout.second, NULL);
+		for (auto &framebuffer : framebuffers)
+			vkDestroyFramebuffer(device, framebuffer.second, NULL);
+		for (auto &renderPass : renderPasses)
+			vkDestroyRenderPass(device, renderPass.second, NULL);
+		for (auto &imageView : imageViews)
+			vkDestroyImageView(device, imageView.second, NULL);
+		for (auto &image : images)
+		{
+			vkDestroyImage(device, image.second.image, NULL);
+			vkFreeMemory(device, image.second.memory, NULL);
+		}
+		for (auto &buffer : buffers)
+			destroyBuffer(buffer.second);
+		for (auto &shader : shaders)
+			vkDestroyShaderModule(device, shader.second, NULL);
+		for (ReplayFrame &frame : frames)
+		{
+			vkDestroyCommandPool(device, frame.commandPool, NULL);
+			vkDestroyFence(device, frame.fence, NULL);
+		}
+		vkDestroyCommandPool(device, uploadPool, NULL);
+		vkDestroyQueryPool(device, timestampPool, NULL);
+		vkDestroyDescriptorPool(device, descriptorPool, NULL);
+		vkDestroyDevice(device, NULL);
+		vkDestroyInstance(instance, NULL);
+	}
+
+	TraceReplayer(const TraceReplayer &);
+	TraceReplayer	&operator=(const TraceReplayer &);
+};
+
+int		main(int argc, char **argv)
+{
+	string	csvPath;
+
+	if (argc == 4 && string(argv[2]) == "--csv")
+		csvPath = argv[3];
+	else if (argc != 2)
+	{
+		cerr << "usage: " << argv[0] << " <capture.vktrace> [--csv <frames.csv>]" << endl;
+		return (1);
+	}
+	try
+	{
+		TraceReplayer	replayer;
+
+		replayer.run(argv[1], csvPath);
+	}
+	catch (const runtime_error &e)
+	{
+		cerr << e.what() << endl;
+		return (1);
+	}
+	return (0);
+}